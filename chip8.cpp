@@ -1,12 +1,25 @@
 #include <iostream>
 #include <fstream>
 #include <chrono>
+#include <algorithm>
+
+#include <cstdio>			// rename()
+#include <cstdlib>			// abs()
 
 #include <arpa/inet.h>		// htons()...
 #include <unistd.h>			// usleep()
+#include <fcntl.h>			// open()
+#include <sys/mman.h>		// mmap()
+#include <sys/stat.h>		// fstat()
 
 #include "chip8.h"
 #include "chip8display.h"
+#include "chip8disassembler.h"
+#include "chip8snapshot.h"
+#include "chip8audio.h"
+#include "chip8probes.h"
+#include "chip8profiler.h"
+#include "chip8metrics.h"
 
 /**
 	Define font for hex characters.
@@ -33,23 +46,30 @@ unsigned char CHIP8::CHAR_f[] = {0xf0, 0x80, 0xf0, 0x80, 0x80};
 	resisters to 0, installs a font for the HEX numbers to memory location
 	\ref MAP_CHAR_TBL_START (currently 0x100).
 
-	\param	[in]	aKeyboard	Pointer to the Chip8 keyboard emulation.
-	\param	[in]	aParent		Pointer to the QtMainwindow.
+	The controls (\ref Clock(), \ref Stop(), ...) are slots, the frontend
+	connects them, so any number of emulators can exist side by side.
+
+	\param	[in]	aKeyboard	Pointer to the Chip8 keyboard emulation (nullptr: no keys, e.g. thumbnails).
+	\param	[in]	aParent		Parent object (not used).
 */
 CHIP8::CHIP8(Chip8Keyboard* aKeyboard, QObject* aParent)
-: log_file(nullptr)
-, ram(nullptr), program_size(0), emuMode(MODE_CLASSIC), execMode(MODE_RUNNING), emulatorRunning(false), PC(0x200)
-, I(0), SP(0x0f), TD(0), TS(0), sleep_time(1000), dsp_width(WIN_COLS), dsp_height(WIN_ROWS)
+: ram(nullptr), program_size(0), programAddress(0x200), programHash(0), emuMode(MODE_CLASSIC), execMode(MODE_RUNNING), emulatorRunning(false), PC(0x200)
+, I(0), SP(0x0f), TD(0), TS(0), sleep_time(1000), frameCount(0), instrCount(0), dsp_width(WIN_COLS), dsp_height(WIN_ROWS)
 , f_trace(false), f_log(false), f_ptrace(false), keyboard(aKeyboard), runMethod(nullptr), do_step(true)
-, exitSignal(0)
+, exitSignal(0), waitForKeys(false), snapshotSerial(0), runAheadFrames(0), aheadActive(false), speculating(false), keyWaiting(false), frameStart(0)
+, mAudio(nullptr), soundFrame(false), rngSeed(RNG_SEED), rng(RNG_SEED), timerTicks(0)
 {
-	Q_UNUSED(aParent)
-
 	ram = new unsigned char[VM_SIZE];
 	memset(ram, 0, VM_SIZE);
 	for(int i = 0; i < 16; ++i){
 		V[i] = 0;
 	}
+	M = 0;
+	memset(Stack, 0, sizeof(Stack));
+	Clock(sleep_time);
+	for(unsigned int page = 0; page < PAGE_COUNT; ++page){
+		pageGen[page].store(0, std::memory_order_relaxed);
+	}
 	int offset = MAP_CHAR_TBL_START;
 	memcpy(ram+offset, CHAR_0,5), offset+=5;
 	memcpy(ram+offset, CHAR_1,5), offset+=5;
@@ -69,13 +89,9 @@ CHIP8::CHIP8(Chip8Keyboard* aKeyboard, QObject* aParent)
 	memcpy(ram+offset, CHAR_f,5), offset+=5;
 
 	mDsp = new Chip8Display();
+	aheadState = new Chip8Snapshot();
 	emuTimer = new QTimer(this);																				// create timer for emulating the sound and delay timers
 	connect(emuTimer, &QTimer::timeout, this, &CHIP8::handle_timers);											// connect callback to timer
-	connect(dynamic_cast<Chip8MainWindow*>(aParent), &Chip8MainWindow::Clock,		this, &CHIP8::Clock);		// Let the user change the emulation speed
-	connect(dynamic_cast<Chip8MainWindow*>(aParent), &Chip8MainWindow::Stop,		this, &CHIP8::Stop);		// Interrupt the current program
-	connect(dynamic_cast<Chip8MainWindow*>(aParent), &Chip8MainWindow::Step,		this, &CHIP8::Step);		// Single-step the current program
-	connect(dynamic_cast<Chip8MainWindow*>(aParent), &Chip8MainWindow::Continue,	this, &CHIP8::Continue);	// Continue current program
-	connect(dynamic_cast<Chip8MainWindow*>(aParent), &Chip8MainWindow::Reset,		this, &CHIP8::Reset);		// Terminate current program
 
 //	exitThread = exitSignal.get_future();
 }
@@ -97,11 +113,9 @@ CHIP8::~CHIP8()
     delete exitSignal;
 	delete emuTimer;
 	delete mDsp;
-	delete [] ram;
-	if(log_file){
-		fclose(log_file);
-	}
+	delete aheadState;
 	trace_msg("-T- CHIP8::~CHIP8() end");
+	delete [] ram;
 }
 //-----------------------------------------------------------------------------
 
@@ -115,16 +129,165 @@ void CHIP8::start_timers(void)
 //-----------------------------------------------------------------------------
 
 /**
-	This is the callback that handles the 60Hz timers (delay and soud).
+	This is the callback that handles the 60Hz timers (delay and soud). The
+	ticks are counted, so \ref run_ahead() can keep the ones that fall into
+	its speculative frames.
 */
 void CHIP8::handle_timers(void)
 {
-	if(TS > 0){
-		--TS;
+	CHIP8_PROFILE("timers");
+	tick_timers();
+	timerTicks.fetch_add(1, std::memory_order_relaxed);
+	CHIP8_PROBE2(timer_tick, TD, TS);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	This method is called from the emulation thread at the end of every 60Hz
+	frame. The completed frame is handed to the display (e.g. for recording).
+*/
+void CHIP8::end_frame(void)
+{
+	int		ahead	= runAheadFrames.load(std::memory_order_relaxed);
+
+	CHIP8_PROFILE("end_frame");
+	mDsp->present(++frameCount);
+	CHIP8_PROBE2(frame, frameCount, instrCount);
+	sound();
+	if((ahead > 0) && (MODE_RUNNING == execMode)){
+		run_ahead(static_cast<unsigned int>(ahead));
+	} else if(aheadActive){
+		ahead_off();
+	}
+	frameStart = instrCount;
+	publish(false);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Renders the sound of the finished frame. The tone is on if the sound
+	timer is running or was set during the frame (a beep of one tick may
+	have run out already). Not called for run-ahead frames.
+*/
+void CHIP8::sound(void)
+{
+	if(mAudio){
+		mAudio->frame((TS > 0) || soundFrame);
+	}
+	soundFrame = false;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Run-ahead: called at the end of every real frame. Saves the state, runs
+	frames more frames with the keys as they are now, shows the resulting
+	display and restores the state. A program that reacts to a key one or
+	two frames late is shown as if it reacted at once.
+
+	Each speculative frame executes as many instructions as the real frame
+	did, without the speed-limiting sleep. The display only sends the
+	speculative frames (\ref Chip8Display::frames_only()), the real draws
+	are not shown. Speculative instructions don't enter the history, the key
+	latency or a key tape and fire no USDT probe (\ref chip8probes.h);
+	speculative timer ticks don't reach the profiler either. The random generator is part of the saved state, so the real
+	frames draw the same numbers with or without run-ahead. Saving and
+	restoring copies about 10 kB.
+
+	The timers are not simply rolled back: the 60Hz timer may tick on its
+	own thread meanwhile and those real ticks would be lost. They are counted
+	(\ref timerTicks) and taken off the restored timers instead.
+
+	\param	[in]	frames	Number of frames to run ahead.
+*/
+void CHIP8::run_ahead(unsigned int frames)
+{
+	unsigned int	perFrame	= static_cast<unsigned int>(std::max<u_int64_t>(instrCount - frameStart, 1));
+	u_int64_t		savedFrame	= frameCount;
+	u_int64_t		savedInstr	= instrCount;
+	bool			savedWait	= waitForKeys;
+	bool			savedSound	= soundFrame;
+	bool			savedKey	= keyWaiting;
+	u_int32_t		gen[PAGE_COUNT];
+	u_int32_t		ticks;
+
+	CHIP8_PROFILE("run_ahead");
+	if(!aheadActive){
+		aheadActive = true;
+		mDsp->frames_only(true);
+	}
+	for(unsigned int page = 0; page < PAGE_COUNT; ++page){
+		gen[page] = pageGen[page].load(std::memory_order_relaxed);
 	}
-	if(TD > 0){
-		--TD;
+	ticks = timerTicks.load(std::memory_order_relaxed);
+	capture(*aheadState);
+	speculating	= true;
+	waitForKeys	= false;								// Fx0A must not block in a speculative frame
+	mDsp->speculate(true);
+	for(unsigned int f = 0; f < frames; ++f){
+		for(unsigned int n = 0; n < perFrame; ++n){
+			execute();
+		}
+		tick_timers();
+	}
+	mDsp->speculate(false);
+	Chip8Frame shown = mDsp->frame();
+
+	apply(*aheadState);								// back to the real state
+	ticks = timerTicks.load(std::memory_order_relaxed) - ticks;	// real ticks during the speculation
+	TD = static_cast<u_int8_t>((TD > ticks) ? TD - ticks : 0);
+	TS = static_cast<u_int8_t>((TS > ticks) ? TS - ticks : 0);
+	mDsp->set_frame(aheadState->frame);
+	frameCount	= savedFrame;
+	instrCount	= savedInstr;
+	waitForKeys	= savedWait;
+	soundFrame	= savedSound;
+	keyWaiting	= savedKey;
+	speculating	= false;
+	for(unsigned int page = 0; page < PAGE_COUNT; ++page){		// memory views may have seen speculative writes
+		if(gen[page] != pageGen[page].load(std::memory_order_relaxed)){
+			written(static_cast<u_int16_t>(page << PAGE_SHIFT), 1);
+		}
 	}
+	mDsp->show(shown);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Switches run-ahead off: the display sends every draw again, starting with
+	the real frame.
+*/
+void CHIP8::ahead_off(void)
+{
+	aheadActive = false;
+	mDsp->frames_only(false);
+	mDsp->show(mDsp->frame());
+}
+//-----------------------------------------------------------------------------
+
+/**
+	This method publishes the CPU state for the user interface. It is called
+	from the emulation thread at the end of every frame and when the program
+	halts, the main window polls it with \ref state(). This replaces a queued
+	signal per instruction, the emulator never waits for a reader.
+
+	\param	[in]	halted	The program is about to halt (single-step mode).
+*/
+void CHIP8::publish(bool halted)
+{
+	Chip8State	s;
+
+	s.serial	= ++snapshotSerial;
+	s.frame		= frameCount;
+	s.PC		= PC;
+	s.I			= I;
+	s.M			= M;
+	s.SP		= SP;
+	s.TD		= TD;
+	s.TS		= TS;
+	s.halted	= halted;
+	memcpy(s.V, V, sizeof(s.V));
+	memcpy(s.Stack, Stack, sizeof(s.Stack));
+	snapshot.store(s);
 }
 //-----------------------------------------------------------------------------
 
@@ -139,13 +302,183 @@ int CHIP8::load(std::string program, u_int16_t address)
 {
 	trace_msg("-T- CHIP8::load() start");
 
-	memcpy(ram+address, program.data(), program.size());
-	program_size = static_cast<u_int16_t>(program.size()/2);
+	size_t length = std::min(program.size(), static_cast<size_t>(VM_SIZE - address));
+	memcpy(ram+address, program.data(), length);
+	program_size = static_cast<u_int16_t>(length);
+	programAddress = address;
+	programHash = program_hash(program);
+	rng = rngSeed;								// the same program runs the same way
+	written(address, length);
+	CHIP8_PROBE3(load, address, program_size, programHash);
 	trace_msg("-T- CHIP8::load() end");
 	return 0;
 }
 //-----------------------------------------------------------------------------
 
+/**
+	Computes the FNV-1a hash of a program. A session snapshot is only restored
+	for the program with the same hash.
+*/
+u_int64_t CHIP8::program_hash(std::string const& program)
+{
+	u_int64_t h = 0xcbf29ce484222325ull;
+
+	for(unsigned char c : program){
+		h = (h ^ c) * 0x100000001b3ull;
+	}
+	return h;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Copies the machine state (without key map and run flag) into a snapshot.
+	Used for the session file and for run-ahead (\ref run_ahead()), it costs
+	little more than copying the memory and the display.
+
+	\param	[out]	snap	The snapshot.
+*/
+void CHIP8::capture(Chip8Snapshot& snap) const
+{
+	snap.magic			= Chip8Snapshot::SNAPSHOT_MAGIC;
+	snap.version		= Chip8Snapshot::SNAPSHOT_VERSION;
+	snap.romHash		= programHash;
+	snap.mode			= static_cast<uint32_t>(emuMode);
+	snap.loadAddress	= programAddress;
+	snap.programSize	= program_size;
+	snap.PC				= PC;
+	snap.I				= I;
+	snap.M				= M;
+	snap.SP				= SP;
+	snap.TD				= TD;
+	snap.TS				= TS;
+	snap.rng			= rng;
+	memcpy(snap.V, V, sizeof(snap.V));
+	memcpy(snap.Stack, Stack, sizeof(snap.Stack));
+	snap.frame			= mDsp->frame();
+	memcpy(snap.ram, ram, sizeof(snap.ram));
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Copies memory, registers, stack and timers back from a snapshot taken by
+	\ref capture(). Mode, display and key map are left to the caller.
+
+	\param	[in]	snap	The snapshot.
+*/
+void CHIP8::apply(Chip8Snapshot const& snap)
+{
+	memcpy(ram, snap.ram, VM_SIZE);
+	memcpy(V, snap.V, sizeof(V));
+	memcpy(Stack, snap.Stack, sizeof(Stack));
+	programAddress	= snap.loadAddress;
+	program_size	= snap.programSize;
+	programHash		= snap.romHash;
+	PC				= snap.PC;
+	I				= snap.I;
+	M				= snap.M;
+	SP				= snap.SP & 0x0f;
+	TD				= snap.TD;
+	TS				= snap.TS;
+	rng				= snap.rng ? snap.rng : rngSeed;		// xorshift must not be 0
+}
+//-----------------------------------------------------------------------------
+
+/**
+	This method writes the complete machine state into a file (see
+	\ref Chip8Snapshot). The emulation must not run, call \ref terminate()
+	first. The snapshot is written to a temporary file that is renamed, so a
+	crash never leaves a half written session behind.
+
+	\param	[in]	filename	Name of the snapshot file.
+	\param	[in]	running		The program should continue when the snapshot is restored.
+	\return true if the snapshot was written.
+*/
+bool CHIP8::save_snapshot(std::string const& filename, bool running) const
+{
+	Chip8Snapshot*	snap	= new Chip8Snapshot();		// zeroed, no stray bytes in the file
+	std::string		tmp		= filename + ".tmp";
+	bool			ok		= false;
+
+	capture(*snap);
+	snap->running		= running ? 1 : 0;
+	if(keyboard){
+		keyboard->GetMap(snap->keyMap);
+	}
+
+	std::ofstream file(tmp, std::ios::out|std::ios::binary|std::ios::trunc);
+	if(file.is_open()){
+		file.write(reinterpret_cast<char const*>(snap), sizeof(Chip8Snapshot));
+		file.close();
+		ok = !file.fail() && (0 == std::rename(tmp.c_str(), filename.c_str()));
+	}
+	if(!ok){
+		std::remove(tmp.c_str());
+	}
+	delete snap;
+	return ok;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	This method restores the machine state written by \ref save_snapshot().
+	The file is mapped into memory and copied into the emulator in one go, there
+	is nothing to parse. The snapshot is rejected if it has another layout
+	version, belongs to another program or holds addresses outside of the
+	memory (\ref Chip8Snapshot::consistent()). The emulation must not run.
+
+	On success the display shows the saved frame, the memory and the state
+	(\ref state()) are up to date and the program can be continued with
+	\ref Run() at the saved PC.
+
+	\param	[in]	filename	Name of the snapshot file.
+	\param	[in]	romHash		\ref program_hash() of the program that is about to be loaded.
+	\param	[out]	running		The program was running when the snapshot was taken.
+	\return true if the snapshot was restored.
+*/
+bool CHIP8::restore_snapshot(std::string const& filename, u_int64_t romHash, bool& running)
+{
+	struct stat	st;
+	int			fd = open(filename.c_str(), O_RDONLY);
+
+	if(fd < 0){
+		return false;
+	}
+	if((0 != fstat(fd, &st)) || (static_cast<size_t>(st.st_size) != sizeof(Chip8Snapshot))){
+		close(fd);
+		return false;
+	}
+	void* addr = mmap(nullptr, sizeof(Chip8Snapshot), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(MAP_FAILED == addr){
+		return false;
+	}
+
+	Chip8Snapshot const*	snap	= static_cast<Chip8Snapshot const*>(addr);
+	bool					ok		= (Chip8Snapshot::SNAPSHOT_MAGIC == snap->magic)
+									&& (Chip8Snapshot::SNAPSHOT_VERSION == snap->version)
+									&& (romHash == snap->romHash)
+									&& (0 != snap->programSize)
+									&& (snap->mode <= MODE_SUPER)
+									&& snap->consistent();
+	if(ok){
+		mode(static_cast<EMULATION_MODE>(snap->mode));
+		apply(*snap);
+		running			= (0 != snap->running);
+		if(keyboard){
+			keyboard->SetMap(snap->keyMap);
+		}
+		Chip8Frame frame = snap->frame;
+		frame.width		= dsp_width;
+		frame.height	= dsp_height;
+		mDsp->restore(frame);
+		written(0, VM_SIZE);
+		publish(!running);
+	}
+	munmap(addr, sizeof(Chip8Snapshot));
+	return ok;
+}
+//-----------------------------------------------------------------------------
+
 /**
 	This method load a program provided as string into memory at address.
 	\param [in]	filename Filename of the progrram to load.
@@ -187,90 +520,82 @@ int CHIP8::load_file(std::string filename, u_int16_t address)
 
 /**
 	This method sets the name of the file that is used to log all
-	debug, trace and program-trace information.
+	debug, trace and program-trace information and opens it (the file is
+	only reopened if the name changed).
 
 	\param	[in]	filename	Name of the logfilen incl. the path.
 	\retirn NONE
 */
 void CHIP8::set_logname(std::string filename)
 {
-	log_filename = filename;
+	if((filename != log_filename) || !mLog.active()){
+		log_filename = filename;
+		open_log();
+	}
 }
 //-----------------------------------------------------------------------------
 
 /**
-
+	Queues a general log message (see \ref Chip8Logger, no I/O in the
+	calling thread).
 */
 void CHIP8::log_msg(char const* msg)
 {
-	if(f_log){
-		open_log();
-		if(log_file){
-			fprintf(log_file, "%s\n", msg), fflush(log_file);
-			close_log();
-		}
+	if(Chip8Logger::compiled(Chip8Logger::LEVEL_INFO) && f_log){
+		mLog.write(Chip8Logger::LEVEL_INFO, msg);
 	}
 }
 //-----------------------------------------------------------------------------
 
 /**
-
+	Queues a function trace message.
 */
 void CHIP8::trace_msg(char const* msg)
 {
-	if(f_trace){
-		open_log();
-		if(log_file){
-			fprintf(log_file, "%s\n", msg), fflush(log_file);
-			close_log();
-		}
+	if(Chip8Logger::compiled(Chip8Logger::LEVEL_TRACE) && f_trace){
+		mLog.write(Chip8Logger::LEVEL_TRACE, msg);
 	}
 }
 //-----------------------------------------------------------------------------
 
 /**
-
+	Queues a program trace message (one per executed instruction).
 */
 void CHIP8::p_trace_msg(char const* msg)
 {
-	if(f_ptrace){
-		open_log();
-		if(log_file){
-			fprintf(log_file, "%s\n", msg), fflush(log_file);
-			close_log();
-		}
+	if(Chip8Logger::compiled(Chip8Logger::LEVEL_PROGRAM) && f_ptrace){
+		mLog.write(Chip8Logger::LEVEL_PROGRAM, msg);
 	}
 }
 //-----------------------------------------------------------------------------
 
 /**
+	Opens the logfile set by \ref set_logname() for appending. The messages
+	are written by the thread of the logger until \ref close_log().
 
+	\return	- 0 on success
+			- 1 no file name or the file couldn't be opened
 */
 int CHIP8::open_log(void)
 {
 	if(log_filename.empty()){
-		std::cerr << "CHIP8::open_log(): no file name" << std::endl;
-		return 0;
+		mLog.close();
+		return 1;
 	}
-	if((log_file = fopen(log_filename.c_str(), "a+"))==NULL){
-		std::cerr << "CHIP8::open_log(): file open..." << std::endl;
+	if(!mLog.open(log_filename)){
+		std::cerr << "-E- CHIP8::open_log(): couldn't open <" << log_filename << ">" << std::endl;
 		return 1;
-	} else {
-		std::cerr << "CHIP8::open_log(): file not open..." << std::endl;
-		return 0;
 	}
+	return 0;
 }
 //-----------------------------------------------------------------------------
 
 /**
-
+	Writes the queued messages and closes the logfile.
 */
 void CHIP8::close_log(void)
 {
-	if(log_file){
-		fclose(log_file);
-	}
-	log_file = NULL;
+	mLog.close();
 }
 //-----------------------------------------------------------------------------
 
@@ -282,6 +607,184 @@ int CHIP8::run(u_int16_t address, std::future<void> exitRequest)
 {
 	trace_msg("-T- CHIP8::run() start");
 
+	const std::chrono::microseconds			frame_time(16667);						// 60Hz
+	std::chrono::steady_clock::time_point	now;
+	std::chrono::steady_clock::time_point	next_frame = std::chrono::steady_clock::now() + frame_time;
+	std::chrono::steady_clock::time_point	last_frame = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point	exec_start;
+	std::chrono::steady_clock::time_point	ips_start	= last_frame;						// start of the IPS measurement
+	uint64_t								ips_instr	= perfCounters.instructions.load(std::memory_order_relaxed);
+	PC 					= address;	// start program at this address
+	waitForKeys			= true;		// we have a thread of our own
+	Chip8Profiler::thread_name("emulator");
+
+	while(emulatorRunning){
+		if(exitRequest.wait_for(std::chrono::microseconds(1)) == std::future_status::ready){
+			break;
+		}
+		now = std::chrono::steady_clock::now();
+		usleep((unsigned int)sleep_time);
+		exec_start = std::chrono::steady_clock::now();
+		Chip8PerfCounters::add(perfCounters.sleepNs, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(exec_start - now).count()));
+		execute();
+		now = std::chrono::steady_clock::now();
+		Chip8PerfCounters::add(perfCounters.execNs, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - exec_start).count()));
+		if(Chip8Profiler::on()){				// the batch is one instruction here, timed above already
+			Chip8Profiler::record("execute", Chip8Profiler::ns(exec_start), Chip8Profiler::ns(now));
+		}
+		Chip8PerfCounters::add(perfCounters.instructions, 1);
+
+		if(MODE_STEP == execMode){
+			if(aheadActive){					// show the real display while halted
+				ahead_off();
+			}
+			std::unique_lock<std::mutex> mlock(mtx);
+			if(!do_step){						// we are going to halt: show where
+				publish(true);
+				emit Stepped();
+			}
+			cond_var.wait(mlock, [this]{return do_step;});
+			do_step=false;
+		}
+
+		now = std::chrono::steady_clock::now();
+		if(now >= next_frame){					// end of a 60Hz frame
+			if((now - next_frame) > frame_time){	// don't catch up after a halt, the frames in between are lost
+				Chip8PerfCounters::add(perfCounters.droppedFrames, static_cast<uint64_t>((now - next_frame) / frame_time));
+				next_frame = now + frame_time;
+			} else {
+				next_frame += frame_time;
+			}
+			long long frame_us = std::min<long long>(std::chrono::duration_cast<std::chrono::microseconds>(now - last_frame).count(), UINT32_MAX);
+			perfCounters.frameTime.add(static_cast<uint32_t>(frame_us));
+			perfCounters.frameJitter.add(static_cast<uint32_t>(std::abs(frame_us - frame_time.count())));
+			Chip8PerfCounters::add(perfCounters.frames, 1);
+			if((now - ips_start) >= std::chrono::seconds(1)){
+				uint64_t instructions = perfCounters.instructions.load(std::memory_order_relaxed);
+				perfCounters.ips.store(static_cast<uint32_t>((instructions - ips_instr) / std::chrono::duration<double>(now - ips_start).count()), std::memory_order_relaxed);
+				ips_start	= now;
+				ips_instr	= instructions;
+			}
+			last_frame = now;
+			end_frame();
+		}
+	}
+	trace_msg("-T- CHIP8::run() end");
+	if(aheadActive){
+		ahead_off();
+	}
+	emulatorRunning=false;
+	publish(false);
+
+	return 0;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Registers the counters of the emulation, the display, the log and the
+	sound (if set) in a metrics registry. The readers are relaxed loads of
+	the counters, scraping never locks the emulation thread.
+
+	\param	[in]	metrics	The registry, must not outlive the emulator.
+*/
+void CHIP8::register_metrics(Chip8Metrics& metrics)
+{
+	static char const* const	stages[4]	= {"total", "queueing", "emulation", "presentation"};
+	Chip8Latency&				latency		= mDsp->latency();
+	Chip8Histogram const*		histograms[4]	= {&latency.total, &latency.queueing, &latency.emulation, &latency.presentation};
+	Chip8PerfCounters const*	perf		= &perfCounters;
+
+	metrics.counter("chip8_instructions_total", "Executed instructions.", [perf]{return perf->instructions.load(std::memory_order_relaxed);});
+	metrics.gauge("chip8_instructions_per_second", "Executed instructions per second, measured once a second.", [perf]{return perf->ips.load(std::memory_order_relaxed);});
+	metrics.gauge("chip8_target_instructions_per_second", "Instructions per second of the speed setting.", [perf]{return perf->targetIps.load(std::memory_order_relaxed);});
+	for(unsigned int op = 0; op < 16; ++op){
+		char label[16];
+		snprintf(label, sizeof(label), "class=\"%X\"", op);
+		metrics.counter("chip8_instructions_by_class_total", "Executed instructions per opcode class (first nibble).", [perf, op]{return perf->opClass[op].load(std::memory_order_relaxed);}, label);
+	}
+	metrics.counter("chip8_exec_seconds_total", "Host time spent executing instructions.", [perf]{return perf->execNs.load(std::memory_order_relaxed) / 1e9;});
+	metrics.counter("chip8_sleep_seconds_total", "Host time spent in the speed-limiting sleep.", [perf]{return perf->sleepNs.load(std::memory_order_relaxed) / 1e9;});
+	metrics.counter("chip8_frames_total", "Emulated 60Hz frames.", [perf]{return perf->frames.load(std::memory_order_relaxed);});
+	metrics.counter("chip8_frames_dropped_total", "60Hz frames skipped because the emulator was late or halted.", [perf]{return perf->droppedFrames.load(std::memory_order_relaxed);});
+	metrics.histogram("chip8_frame_time_seconds", "Host time per 60Hz frame.", &perfCounters.frameTime);
+	metrics.histogram("chip8_frame_jitter_seconds", "Deviation of the frame time from 1/60 s.", &perfCounters.frameJitter);
+
+	Chip8Display* dsp = mDsp;
+	metrics.gauge("chip8_display_backlog", "DrawSprite/Clear signals not yet handled by the view.", [dsp]{return dsp->queued();});
+	for(unsigned int s = 0; s < 4; ++s){
+		metrics.histogram("chip8_key_latency_seconds", "Key press to display, in total and per stage.", histograms[s], std::string("stage=\"") + stages[s] + "\"");
+	}
+
+	Chip8Logger const* log = &mLog;
+	metrics.gauge("chip8_log_queue_depth", "Log messages waiting for the writer thread.", [log]{return log->queued();});
+	metrics.counter("chip8_log_dropped_total", "Log messages lost because a queue was full.", [log]{return log->dropped();});
+
+	if(mAudio){
+		Chip8Audio const* audio = mAudio;
+		metrics.counter("chip8_audio_underruns_total", "Audio reads that had to insert silence.", [audio]{return audio->underruns();});
+		metrics.counter("chip8_audio_dropped_total", "Audio samples lost because the ring was full.", [audio]{return audio->dropped();});
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Tests one key of the key mask (Ex9E/ExA1). A pressed key counts as read
+	by the program for the key latency. A key source that follows the
+	emulated time (\ref Chip8KeyTape) is synchronized first.
+
+	\param	[in]	key	CHIP8 key (values above 0xf are never pressed).
+	\return true if the key is pressed.
+*/
+bool CHIP8::key_down(u_int8_t key)
+{
+	if(!keyboard){
+		return false;
+	}
+	if(!speculating){
+		keyboard->Sync(frameCount, instrCount);		// scripted input follows the emulated time
+	}
+	if((key > Chip8Keyboard::KEY_F) || !keyboard->IsPressed(key)){
+		return false;
+	}
+	key_seen(key);
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Hands the time stamp of a key press to the display the first time the
+	program reads the key (see \ref Chip8Latency).
+
+	\param	[in]	key	CHIP8 key.
+*/
+void CHIP8::key_seen(int key)
+{
+	if(speculating || (key < Chip8Keyboard::KEY_0) || (key > Chip8Keyboard::KEY_F)){
+		return;
+	}
+	int64_t stamp = keyboard->TakePress(key);
+	if(stamp){
+		mDsp->key_observed(stamp);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Executes the instruction at PC. Called from \ref run() and \ref run_frame().
+	In the frame-driven mode Fx0A never blocks: it spins on itself until a key
+	is pressed, so the caller's frame budget keeps running (without a
+	keyboard no key is ever pressed).
+
+	Programs are not trusted (e.g. the thumbnails of the library): PC is
+	wrapped into the 4K address space before the fetch and M only ever
+	holds 12-bit addresses (Annn, Fx1E, Fx29), so the largest access,
+	a 32 byte sprite or Fx55/Fx65 at M=$FFF, stays inside the VM_SIZE byte
+	memory.
+*/
+void CHIP8::execute(void)
+{
+	static_assert(VM_SIZE >= MSK_ADDR + 1 + 32, "memory too small for accesses at the end of the address space");
+
 	u_int8_t 	reg_x	= 0;		// index of register X
 	u_int8_t 	reg_y	= 0;		// index of register Y
 	u_int8_t 	k		= 0;		// 8-bit constant
@@ -292,522 +795,422 @@ int CHIP8::run(u_int16_t address, std::future<void> exitRequest)
 	u_int8_t	ten		= 0;
 	u_int8_t	one		= 0;
 	char		dbg_msg[80];
-	PC 					= address;	// start program at this address
 
-	while(emulatorRunning){
-		if(exitRequest.wait_for(std::chrono::microseconds(1)) == std::future_status::ready){
-			break;
-		}
-		usleep((unsigned int)sleep_time);
-		I = htons(*(u_int16_t*)(ram+PC));		// read next instruction
-		old_pc=PC;								// copy of current PC for disassembler
-		PC+=2;									// increment program counter
-		emit UpdateI(I);
-		emit UpdatePC(PC);
-
-		switch((I & MSK_OP_CODE) >> 12){
-			case 0:	if(OC_CALL == I){
+	PC &= MSK_ADDR;							// a program running off its end wraps around the 4K address space
+	I = static_cast<u_int16_t>((ram[PC] << 8) | ram[PC+1]);	// read next instruction
+	++instrCount;
+	old_pc=PC;								// copy of current PC for disassembler
+	PC+=2;									// increment program counter
+	if(!speculating){						// the probes describe the real execution only
+		CHIP8_PROBE4(instruction, old_pc, I, M, SP);
+	}
+
+	switch((I & MSK_OP_CODE) >> 12){
+		case 0:	if(OC_CALL == I){
 //						thread_active = false;
-						sprintf(dbg_msg, "$%03X:   SYS, addr (not implemented -> HALT)", old_pc);
-						p_trace_msg(dbg_msg);
-					} else if(OC_DSP_CLR == I){
-						mDsp->clear();
-						sprintf(dbg_msg, "$%03X:   CLS             (I=%04X:)", old_pc, I);
-						p_trace_msg(dbg_msg);
-					} else if(OC_RET == I){
-						PC = Stack[++SP];
-						sprintf(dbg_msg, "$%03X:   RET             (I=%04X: PC=$%03X, SP=$%03X)",old_pc, I, PC, SP);
-						p_trace_msg(dbg_msg);
-						emit UpdatePC(PC);
-						emit UpdateSP(SP);
-						emit UpdateStack(Stack);
-					}
-					break;
-			case 1:	PC = (I & MSK_ADDR);		// JMP to address
-					sprintf(dbg_msg, "$%03X:   JMP $%03X        (I=%04X:)", old_pc, PC, I);
+					if(ptracing()) sprintf(dbg_msg, "$%03X:   SYS, addr (not implemented -> HALT)", old_pc);
 					p_trace_msg(dbg_msg);
-					emit UpdatePC(PC);
-					break;
-			case 2:	Stack[SP--] = PC;			// save return address
-					PC = (I & MSK_ADDR);		// JSR
-					sprintf(dbg_msg, "$%03X:   CALL $%03X       (I=%04X:)", old_pc, PC, I);
+				} else if(OC_DSP_CLR == I){
+					mDsp->clear();
+					if(ptracing()) sprintf(dbg_msg, "$%03X:   CLS             (I=%04X:)", old_pc, I);
 					p_trace_msg(dbg_msg);
-					emit UpdatePC(PC);
-					emit UpdateSP(SP);
-					emit UpdateStack(Stack);
-					break;
-			case 3:	reg_x	= (I & MSK_REG_X) >> 8;
-					k		= (I & MSK_CONST);
-					if(V[reg_x] == k){
-						PC += 2;
-						emit UpdatePC(PC);
-					}
-					sprintf(dbg_msg, "$%03X:   SE V%X #$%02X      (I=%04X: V%X=$%02X)", old_pc, reg_x, k, I, reg_x, V[reg_x]);
+				} else if(OC_RET == I){
+					SP = (SP + 1) & 0x0f;
+					PC = Stack[SP];
+					if(ptracing()) sprintf(dbg_msg, "$%03X:   RET             (I=%04X: PC=$%03X, SP=$%03X)",old_pc, I, PC, SP);
 					p_trace_msg(dbg_msg);
-					break;
-			case 4:	reg_x	= (I & MSK_REG_X) >> 8;
-					k		= (I & MSK_CONST);
-					if(V[reg_x] != k){
-						PC += 2;
-						emit UpdatePC(PC);
-					}
-					sprintf(dbg_msg, "$%03X:   SNE V%X, #$%02X    (I=%04X: V%X=$%02X)", old_pc, reg_x, k, I, reg_x, V[reg_x]);
+				}
+				break;
+		case 1:	PC = (I & MSK_ADDR);		// JMP to address
+				if(ptracing()) sprintf(dbg_msg, "$%03X:   JMP $%03X        (I=%04X:)", old_pc, PC, I);
+				p_trace_msg(dbg_msg);
+				break;
+		case 2:	Stack[SP] = PC;				// save return address
+				SP = (SP - 1) & 0x0f;		// the stack wraps instead of overwriting memory
+				PC = (I & MSK_ADDR);		// JSR
+				if(ptracing()) sprintf(dbg_msg, "$%03X:   CALL $%03X       (I=%04X:)", old_pc, PC, I);
+				p_trace_msg(dbg_msg);
+				break;
+		case 3:	reg_x	= (I & MSK_REG_X) >> 8;
+				k		= (I & MSK_CONST);
+				if(V[reg_x] == k){
+					PC += 2;
+				}
+				if(ptracing()) sprintf(dbg_msg, "$%03X:   SE V%X #$%02X      (I=%04X: V%X=$%02X)", old_pc, reg_x, k, I, reg_x, V[reg_x]);
+				p_trace_msg(dbg_msg);
+				break;
+		case 4:	reg_x	= (I & MSK_REG_X) >> 8;
+				k		= (I & MSK_CONST);
+				if(V[reg_x] != k){
+					PC += 2;
+				}
+				if(ptracing()) sprintf(dbg_msg, "$%03X:   SNE V%X, #$%02X    (I=%04X: V%X=$%02X)", old_pc, reg_x, k, I, reg_x, V[reg_x]);
+				p_trace_msg(dbg_msg);
+				break;
+		case 5:	reg_x	= (I & MSK_REG_X) >> 8;
+				reg_y	= (I & MSK_REG_Y) >> 4;
+				if(V[reg_x] == V[reg_y]){
+					PC += 2;
+				}
+				if(ptracing()) sprintf(dbg_msg, "$%03X:   SE V%X, V%X       (I=%04X V%X=$%02X, V%X=$%02X)", old_pc, reg_x, reg_y, I, reg_x, V[reg_x], reg_y, V[reg_y]);
+				p_trace_msg(dbg_msg);
+				break;
+		case 6:	reg_x		= (I & MSK_REG_X) >> 8;
+				k			= (I & MSK_CONST);
+				V[reg_x]	= k;
+				if(ptracing()) sprintf(dbg_msg, "$%03X:   LD V%X, #$%02X     (I=%04X:)", old_pc, reg_x, k, I);
+				p_trace_msg(dbg_msg);
+				break;
+		case 7:	reg_x		= (I & MSK_REG_X) >> 8;
+				k			= (I & MSK_CONST);
+				V[reg_x]	+= k;
+				if(ptracing()) sprintf(dbg_msg, "$%03X:   ADD V%X, #$%02X    (I=%04X:)", old_pc, reg_x, k, I);
+				p_trace_msg(dbg_msg);
+				break;
+		case 8:	switch(I & 0x000f){
+					case 0:	reg_x		= (I & MSK_REG_X) >> 8;
+							reg_y		= (I & MSK_REG_Y) >> 4;
+							if(ptracing()) sprintf(dbg_msg, "$%03X:   LD V%X, V%X       (I=%04X:)", old_pc, reg_x, reg_y, I);
+							p_trace_msg(dbg_msg);
+							V[reg_x]	= V[reg_y];
+							break;
+					case 1:	reg_x		= (I & MSK_REG_X) >> 8;
+							reg_y		= (I & MSK_REG_Y) >> 4;
+							if(ptracing()) sprintf(dbg_msg, "$%03X:   OR V%X, V%X       (I=%04X:)", old_pc, reg_x, reg_y, I);
+							p_trace_msg(dbg_msg);
+							V[reg_x]	|= V[reg_y];
+							break;
+					case 2:	reg_x		= (I & MSK_REG_X) >> 8;
+							reg_y		= (I & MSK_REG_Y) >> 4;
+							if(ptracing()) sprintf(dbg_msg, "$%03X:   AND V%X, V%X      (I=%04X:)", old_pc, reg_x, reg_y, I);
+							p_trace_msg(dbg_msg);
+							V[reg_x]	&= V[reg_y];
+							break;
+					case 3:	reg_x		= (I & MSK_REG_X) >> 8;
+							reg_y		= (I & MSK_REG_Y) >> 4;
+							if(ptracing()) sprintf(dbg_msg, "$%03X:   XOR V%X, V%X      (I=%04X:)", old_pc, reg_x, reg_y, I);
+							p_trace_msg(dbg_msg);
+							V[reg_x]	^= V[reg_y];
+							break;
+					case 4:	reg_x		= (I & MSK_REG_X) >> 8;
+							reg_y		= (I & MSK_REG_Y) >> 4;
+							i_val		= V[reg_x] + V[reg_y];
+							if(i_val > 255){		// set carry
+								V[0xf]	= 1;
+							} else {
+								V[0xf]	= 0;
+							}
+							if(ptracing()) sprintf(dbg_msg, "$%03X:   ADC V%X, V%X      (I=%04X: VF=%02X)", old_pc, reg_x, reg_y, I, V[0xf]);
+							p_trace_msg(dbg_msg);
+							V[reg_x] = (u_int8_t)(i_val & 0x00ff);
+							break;
+					case 5:	reg_x		= (I & MSK_REG_X) >> 8;
+							reg_y		= (I & MSK_REG_Y) >> 4;
+							if(V[reg_x] > V[reg_y]){		// set carry
+								V[0xf]	= 1;
+							} else {
+								V[0xf]	= 0;
+							}
+							if(ptracing()) sprintf(dbg_msg, "$%03X:   SBC V%X, V%X      (I=%04X: VF=%02X)", old_pc, reg_x, reg_y, I, V[0xf]);
+							p_trace_msg(dbg_msg);
+							V[reg_x]	= V[reg_x] - V[reg_y];
+							break;
+					case 6:	reg_x		= (I & MSK_REG_X) >> 8;
+							reg_y		= (I & MSK_REG_Y) >> 4;
+							V[0xf]		= (V[reg_x] & 0x01);
+							if(ptracing()) sprintf(dbg_msg, "$%03X:   SHR V%X{, V%X}    (I=%04X: VF=%02X)", old_pc, reg_x, reg_y, I, V[0xf]);
+							p_trace_msg(dbg_msg);
+							V[reg_x]	= V[reg_x] >> 1;
+							break;
+					case 7:	reg_x		= (I & MSK_REG_X) >> 8;
+							reg_y		= (I & MSK_REG_Y) >> 4;
+							if(V[reg_y] > V[reg_x]){		// set carry
+								V[0xf]	= 1;
+							} else {
+								V[0xf]	= 0;
+							}
+							if(ptracing()) sprintf(dbg_msg, "$%03X:   SUBN V%X, V%X     (I=%04X: VF=%02X)", old_pc, reg_x, reg_y, I, V[0xf]);
+							p_trace_msg(dbg_msg);
+							V[reg_x]	= V[reg_y] - V[reg_x];
+							break;
+					case 0x0e:	reg_x		= (I & MSK_REG_X) >> 8;
+								reg_y		= (I & MSK_REG_Y) >> 4;
+								V[0xf]		= (V[reg_x] & 0x80)? 1:0;
+								if(ptracing()) sprintf(dbg_msg, "$%03X:   SHL V%X{, V%X}  (I=%04X: V%X=$%02X, VF=%02X)", old_pc, reg_x, reg_y, I, reg_x, V[reg_x], V[0xf]);
+								p_trace_msg(dbg_msg);
+								V[reg_x]	= V[reg_x] << 1;
+								break;
+				}
+				break;
+		case 9:	reg_x	= (I & MSK_REG_X) >> 8;
+				reg_y	= (I & MSK_REG_Y) >> 4;
+				if(V[reg_x] != V[reg_y]){
+					PC += 2;
+				}
+				if(ptracing()) sprintf(dbg_msg, "$%03X:   SNE V%X, V%X    (I=%04X: V%X=$%02X, V%X=%02X)", old_pc, reg_x, reg_y, I, reg_x, V[reg_x], reg_y, V[reg_y]);
+				p_trace_msg(dbg_msg);
+				break;
+		case 0xa:	M = (I & MSK_ADDR);		// Load new address
+					if(ptracing()) sprintf(dbg_msg, "$%03X:   LD M, #$%03X     (I=%04X:)", old_pc, M, I);
 					p_trace_msg(dbg_msg);
 					break;
-			case 5:	reg_x	= (I & MSK_REG_X) >> 8;
-					reg_y	= (I & MSK_REG_Y) >> 4;
-					if(V[reg_x] == V[reg_y]){
-						PC += 2;
-						emit UpdatePC(PC);
-					}
-					sprintf(dbg_msg, "$%03X:   SE V%X, V%X       (I=%04X V%X=$%02X, V%X=$%02X)", old_pc, reg_x, reg_y, I, reg_x, V[reg_x], reg_y, V[reg_y]);
+		case 0xb:	PC = (I & MSK_ADDR) + V[0];
+					if(ptracing()) sprintf(dbg_msg, "$%03X:   JMP V0, #$%03X    (I=%04X: PC(new)=%03X, V0=%02X)", old_pc, M, I, PC, V[0]);
 					p_trace_msg(dbg_msg);
 					break;
-			case 6:	reg_x		= (I & MSK_REG_X) >> 8;
+		case 0xc:	reg_x		= (I & MSK_REG_X) >> 8;
 					k			= (I & MSK_CONST);
-					V[reg_x]	= k;
-					sprintf(dbg_msg, "$%03X:   LD V%X, #$%02X     (I=%04X:)", old_pc, reg_x, k, I);
+					vx			= V[reg_x];
+					V[reg_x]	= random_byte() & k;
+					if(ptracing()) sprintf(dbg_msg, "$%03X:   RND V%X, #$%02X    (I=%04X: V%X(old)=$%02X,V%X(new)=$%02X)", old_pc, reg_x, k, I, reg_x, vx, reg_x, V[reg_x]);
 					p_trace_msg(dbg_msg);
-					emit UpdateV(V);
 					break;
-			case 7:	reg_x		= (I & MSK_REG_X) >> 8;
-					k			= (I & MSK_CONST);
-					V[reg_x]	+= k;
-					sprintf(dbg_msg, "$%03X:   ADD V%X, #$%02X    (I=%04X:)", old_pc, reg_x, k, I);
+		case 0xd:	reg_x	= (I & MSK_REG_X) >> 8;
+					reg_y	= (I & MSK_REG_Y) >> 4;
+					i_val	= (I & 0x000f);
+					if(ptracing()) sprintf(dbg_msg, "$%03X:   DRW V%X, V%X, #$%X (I=%04X: M=%03X, V%X=$%02X, V%X=%02X)", old_pc, reg_x, reg_y, i_val, I, M, reg_x, V[reg_x], reg_y, V[reg_y]);
 					p_trace_msg(dbg_msg);
-					emit UpdateV(V);
+					V[0xf]=mDsp->draw_sprite(V[reg_x], V[reg_y], i_val, ram+M);
+					if(!speculating){
+						CHIP8_PROBE5(draw, old_pc, V[reg_x], V[reg_y], i_val, V[0xf]);
+					}
+					if(V[0xf] == 1){
+						log_msg("-D- Draw -> Collision");
+					}
 					break;
-			case 8:	switch(I & 0x000f){
-						case 0:	reg_x		= (I & MSK_REG_X) >> 8;
-								reg_y		= (I & MSK_REG_Y) >> 4;
-								sprintf(dbg_msg, "$%03X:   LD V%X, V%X       (I=%04X:)", old_pc, reg_x, reg_y, I);
-								p_trace_msg(dbg_msg);
-								V[reg_x]	= V[reg_y];
-								emit UpdateV(V);
-								break;
-						case 1:	reg_x		= (I & MSK_REG_X) >> 8;
-								reg_y		= (I & MSK_REG_Y) >> 4;
-								sprintf(dbg_msg, "$%03X:   OR V%X, V%X       (I=%04X:)", old_pc, reg_x, reg_y, I);
-								p_trace_msg(dbg_msg);
-								V[reg_x]	|= V[reg_y];
-								emit UpdateV(V);
-								break;
-						case 2:	reg_x		= (I & MSK_REG_X) >> 8;
-								reg_y		= (I & MSK_REG_Y) >> 4;
-								sprintf(dbg_msg, "$%03X:   AND V%X, V%X      (I=%04X:)", old_pc, reg_x, reg_y, I);
-								p_trace_msg(dbg_msg);
-								V[reg_x]	&= V[reg_y];
-								emit UpdateV(V);
-								break;
-						case 3:	reg_x		= (I & MSK_REG_X) >> 8;
-								reg_y		= (I & MSK_REG_Y) >> 4;
-								sprintf(dbg_msg, "$%03X:   XOR V%X, V%X      (I=%04X:)", old_pc, reg_x, reg_y, I);
-								p_trace_msg(dbg_msg);
-								V[reg_x]	^= V[reg_y];
-								emit UpdateV(V);
-								break;
-						case 4:	reg_x		= (I & MSK_REG_X) >> 8;
-								reg_y		= (I & MSK_REG_Y) >> 4;
-								i_val		= V[reg_x] + V[reg_y];
-								if(i_val > 255){		// set carry
-									V[0xf]	= 1;
-								} else {
-									V[0xf]	= 0;
-								}
-								sprintf(dbg_msg, "$%03X:   ADC V%X, V%X      (I=%04X: VF=%02X)", old_pc, reg_x, reg_y, I, V[0xf]);
-								p_trace_msg(dbg_msg);
-								V[reg_x] = (u_int8_t)(i_val & 0x00ff);
-								emit UpdateV(V);
-								break;
-						case 5:	reg_x		= (I & MSK_REG_X) >> 8;
-								reg_y		= (I & MSK_REG_Y) >> 4;
-								if(V[reg_x] > V[reg_y]){		// set carry
-									V[0xf]	= 1;
-								} else {
-									V[0xf]	= 0;
-								}
-								sprintf(dbg_msg, "$%03X:   SBC V%X, V%X      (I=%04X: VF=%02X)", old_pc, reg_x, reg_y, I, V[0xf]);
-								p_trace_msg(dbg_msg);
-								V[reg_x]	= V[reg_x] - V[reg_y];
-								emit UpdateV(V);
-								break;
-						case 6:	reg_x		= (I & MSK_REG_X) >> 8;
-								reg_y		= (I & MSK_REG_Y) >> 4;
-								V[0xf]		= (V[reg_x] & 0x01);
-								sprintf(dbg_msg, "$%03X:   SHR V%X{, V%X}    (I=%04X: VF=%02X)", old_pc, reg_x, reg_y, I, V[0xf]);
-								p_trace_msg(dbg_msg);
-								V[reg_x]	= V[reg_x] >> 1;
-								emit UpdateV(V);
-								break;
-						case 7:	reg_x		= (I & MSK_REG_X) >> 8;
-								reg_y		= (I & MSK_REG_Y) >> 4;
-								if(V[reg_y] > V[reg_x]){		// set carry
-									V[0xf]	= 1;
-								} else {
-									V[0xf]	= 0;
-								}
-								sprintf(dbg_msg, "$%03X:   SUBN V%X, V%X     (I=%04X: VF=%02X)", old_pc, reg_x, reg_y, I, V[0xf]);
-								p_trace_msg(dbg_msg);
-								V[reg_x]	= V[reg_y] - V[reg_x];
-								emit UpdateV(V);
-								break;
-						case 0x0e:	reg_x		= (I & MSK_REG_X) >> 8;
-									reg_y		= (I & MSK_REG_Y) >> 4;
-									V[0xf]		= (V[reg_x] & 0x80)? 1:0;
-									sprintf(dbg_msg, "$%03X:   SHL V%X{, V%X}  (I=%04X: V%X=$%02X, VF=%02X)", old_pc, reg_x, reg_y, I, reg_x, V[reg_x], V[0xf]);
+		case 0xe: switch(I & 0x00ff){
+						case 0x9e:	reg_x		= (I & MSK_REG_X) >> 8;
+									if(key_down(V[reg_x])){
+										PC += 2;
+									}
+									if(ptracing()) sprintf(dbg_msg, "$%03X:   SKP V%X          (I=%04X: PC=$%03X, V%X=$%02X)", old_pc, reg_x, I, PC, reg_x, V[reg_x]);
+									p_trace_msg(dbg_msg);
+									break;
+						case 0xa1:	reg_x		= (I & MSK_REG_X) >> 8;
+									if(!key_down(V[reg_x])){
+										PC += 2;
+									}
+									if(ptracing()) sprintf(dbg_msg, "$%03X:   SKNP V%X         (I=%04X: PC=$%03X, V%X=$%02X)", old_pc, reg_x, I, PC, reg_x, V[reg_x]);
+									p_trace_msg(dbg_msg);
+									break;
+						default:	sprintf(dbg_msg,"-E- Unknown OP-code %04X",I);
 									p_trace_msg(dbg_msg);
-									V[reg_x]	= V[reg_x] << 1;
-									emit UpdateV(V);
 									break;
 					}
 					break;
-			case 9:	reg_x	= (I & MSK_REG_X) >> 8;
-					reg_y	= (I & MSK_REG_Y) >> 4;
-					if(V[reg_x] != V[reg_y]){
-						PC += 2;
-						emit UpdatePC(PC);
-					}
-					sprintf(dbg_msg, "$%03X:   SNE V%X, V%X    (I=%04X: V%X=$%02X, V%X=%02X)", old_pc, reg_x, reg_y, I, reg_x, V[reg_x], reg_y, V[reg_y]);
-					p_trace_msg(dbg_msg);
-					break;
-			case 0xa:	M = (I & MSK_ADDR);		// Load new address
-						sprintf(dbg_msg, "$%03X:   LD M, #$%03X     (I=%04X:)", old_pc, M, I);
-						p_trace_msg(dbg_msg);
-						emit UpdateM(M);
-						break;
-			case 0xb:	PC = (I & MSK_ADDR) + V[0];
-						sprintf(dbg_msg, "$%03X:   JMP V0, #$%03X    (I=%04X: PC(new)=%03X, V0=%02X)", old_pc, M, I, PC, V[0]);
-						p_trace_msg(dbg_msg);
-						emit UpdatePC(PC);
-						break;
-			case 0xc:	reg_x		= (I & MSK_REG_X) >> 8;
-						k			= (I & MSK_CONST);
-						vx			= V[reg_x];
-						V[reg_x]	= (rand()%256) & k;
-						sprintf(dbg_msg, "$%03X:   RND V%X, #$%02X    (I=%04X: V%X(old)=$%02X,V%X(new)=$%02X)", old_pc, reg_x, k, I, reg_x, vx, reg_x, V[reg_x]);
-						p_trace_msg(dbg_msg);
-						emit UpdateV(V);
-						break;
-			case 0xd:	reg_x	= (I & MSK_REG_X) >> 8;
-						reg_y	= (I & MSK_REG_Y) >> 4;
-						i_val	= (I & 0x000f);
-						sprintf(dbg_msg, "$%03X:   DRW V%X, V%X, #$%X (I=%04X: M=%03X, V%X=$%02X, V%X=%02X)", old_pc, reg_x, reg_y, i_val, I, M, reg_x, V[reg_x], reg_y, V[reg_y]);
-						p_trace_msg(dbg_msg);
-						V[0xf]=mDsp->draw_sprite(V[reg_x], V[reg_y], i_val, ram+M);
-						if(V[0xf] == 1){
-							log_msg("-D- Draw -> Collision");
-						}
-						emit UpdateV(V);
-						break;
-			case 0xe: switch(I & 0x00ff){
-							case 0x9e:	reg_x		= (I & MSK_REG_X) >> 8;
-										if(keyboard->ReadKey(Chip8Keyboard::RD_MODE_NON_BLOCKING) == V[reg_x]){
-											PC += 2;
-											emit UpdatePC(PC);
-										}
-										sprintf(dbg_msg, "$%03X:   SKP V%X          (I=%04X: PC=$%03X, V%X=$%02X)", old_pc, reg_x, I, PC, reg_x, V[reg_x]);
-										p_trace_msg(dbg_msg);
-										break;
-							case 0xa1:	reg_x		= (I & MSK_REG_X) >> 8;
-										if(keyboard->ReadKey(Chip8Keyboard::RD_MODE_NON_BLOCKING) != V[reg_x]){
-											PC += 2;
-											emit UpdatePC(PC);
+		case 0xf:	switch(I & 0x00ff){
+						case 0x07:	reg_x		= (I & MSK_REG_X) >> 8;
+									V[reg_x]	= TD;
+									if(ptracing()) sprintf(dbg_msg, "$%03X:   LD V%X, TD       (I=%04X: V%X=$%02X)", old_pc, reg_x, I, reg_x, V[reg_x]);
+									p_trace_msg(dbg_msg);
+									break;
+						case 0x0a:	reg_x		= (I & MSK_REG_X) >> 8;
+									if(keyboard && !speculating){
+										keyboard->Sync(frameCount, instrCount);
+									}
+									if(!keyWaiting){
+										keyWaiting = true;
+										if(!speculating){
+											CHIP8_PROBE2(key_wait_start, old_pc, reg_x);
 										}
-										sprintf(dbg_msg, "$%03X:   SKNP V%X         (I=%04X: PC=$%03X, V%X=$%02X)", old_pc, reg_x, I, PC, reg_x, V[reg_x]);
-										p_trace_msg(dbg_msg);
-										break;
-							default:	sprintf(dbg_msg,"-E- Unknown OP-code %04X",I);
-										p_trace_msg(dbg_msg);
-										break;
-						}
-						break;
-			case 0xf:	switch(I & 0x00ff){
-							case 0x07:	reg_x		= (I & MSK_REG_X) >> 8;
-										V[reg_x]	= TD;
-										sprintf(dbg_msg, "$%03X:   LD V%X, TD       (I=%04X: V%X=$%02X)", old_pc, reg_x, I, reg_x, V[reg_x]);
-										p_trace_msg(dbg_msg);
-										emit UpdateV(V);
-										break;
-							case 0x0a:	reg_x		= (I & MSK_REG_X) >> 8;
-										V[reg_x]	= keyboard->ReadKey(Chip8Keyboard::RD_MODE_BLOCKING);
-										sprintf(dbg_msg, "$%03X:   LD V%X, K        (I=%04X: V%X=$%02X)", old_pc, reg_x, I, reg_x, V[reg_x]);
-										p_trace_msg(dbg_msg);
-										emit UpdateV(V);
-										break;
-							case 0x15:	reg_x		= (I & MSK_REG_X) >> 8;
-										TD			= V[reg_x];
-										sprintf(dbg_msg, "$%03X:   LD TD, V%X       (I=%04X: V%X=$%02X)", old_pc, reg_x, I, reg_x, V[reg_x]);
-										p_trace_msg(dbg_msg);
-										emit UpdateTd(TD);
-										break;
-							case 0x18:	reg_x		= (I & MSK_REG_X) >> 8;
-										TS			= V[reg_x];
-										sprintf(dbg_msg, "$%03X:   LD TS, V%X       (I=%04X: V%X=$%02X)", old_pc, reg_x, I, reg_x, V[reg_x]);
-										emit UpdateTs(TS);
-										p_trace_msg(dbg_msg);
-										break;
-							case 0x1e:	reg_x		= (I & MSK_REG_X) >> 8;
-										vx			= M;						// mis-use vx to store old M
-										M 			+= V[reg_x];
-										sprintf(dbg_msg, "$%03X:   ADD M, V%X       (I=%04X: M(old)=$%03X, V%X=$%02X)", old_pc, reg_x, I, vx, reg_x, V[reg_x]);
-										p_trace_msg(dbg_msg);
-										emit UpdateM(M);
-										break;
-							case 0x29:	reg_x		= (I & MSK_REG_X) >> 8;
-										M			= MAP_CHAR_TBL_START + (V[reg_x] * CHAR_SIZE);
-										sprintf(dbg_msg, "$%03X:   LD F, V%X        (I=%04X: M=$%03X, V%X=$%02X)", old_pc, reg_x, I, M, reg_x, V[reg_x]);
-										p_trace_msg(dbg_msg);
-										emit UpdateM(M);
-										break;
-							case 0x33:	reg_x		= (I & MSK_REG_X) >> 8;			// store BCD representation of VX at memory loc. M
-										hun			= V[reg_x]/100;
-										ten			= (V[reg_x]-(hun*100))/10;
-										one			= V[reg_x] % 10;
-										ram[M]		= hun;
-										ram[M+1]	= ten;
-										ram[M+2]	= one;
-										sprintf(dbg_msg, "$%03X:   STO B, V%X       (I=%04X: M=$%03X, V%X=$%03i)", old_pc, reg_x, I, M, reg_x, V[reg_x]);
-										p_trace_msg(dbg_msg);
-										emit UpdateM(M);
-										break;
-							case 0x55:	reg_x		= (I & MSK_REG_X) >> 8;
-										for(int offset = 0; offset <= reg_x; ++offset){
-											ram[M+offset] = V[offset];
+									}
+									if(waitForKeys){
+										int key		= keyboard->ReadKey(Chip8Keyboard::RD_MODE_BLOCKING);
+										if(Chip8Keyboard::NO_KEY == key){
+											PC			= old_pc;		// source closed or tape at its end: keep waiting (run() sees a stop request)
+										} else {
+											V[reg_x]	= static_cast<u_int8_t>(key);
+											key_seen(key);
+											keyWaiting	= false;
+											CHIP8_PROBE3(key_wait_end, old_pc, reg_x, V[reg_x]);
 										}
-										sprintf(dbg_msg, "$%03X:   STO [M], V%X     (I=%04X: M=$%03X)", old_pc, reg_x, I, M);
-										p_trace_msg(dbg_msg);
-										emit UpdateM(M);
-										break;
-							case 0x65:	reg_x		= (I & MSK_REG_X) >> 8;
-										for(int offset = 0; offset <= reg_x; ++offset){
-											V[offset] = ram[M+offset];
+									} else {
+										int key		= read_key();
+										if(Chip8Keyboard::NO_KEY == key){
+											PC			= old_pc;		// no key yet: execute Fx0A again (frame-driven, see run_frame())
+										} else {
+											V[reg_x]	= static_cast<u_int8_t>(key);
+											key_seen(key);
+											keyWaiting	= false;
+											if(!speculating){
+												CHIP8_PROBE3(key_wait_end, old_pc, reg_x, V[reg_x]);
+											}
 										}
-										sprintf(dbg_msg, "$%03X:   RSTO [M], V%X    (I=%04X: M=$%03X)", old_pc, reg_x, I, M);
-										p_trace_msg(dbg_msg);
-										emit UpdateV(V);
-										break;
-							case 0x75:
+									}
+									if(ptracing()) sprintf(dbg_msg, "$%03X:   LD V%X, K        (I=%04X: V%X=$%02X)", old_pc, reg_x, I, reg_x, V[reg_x]);
+									p_trace_msg(dbg_msg);
+									break;
+						case 0x15:	reg_x		= (I & MSK_REG_X) >> 8;
+									TD			= V[reg_x];
+									if(ptracing()) sprintf(dbg_msg, "$%03X:   LD TD, V%X       (I=%04X: V%X=$%02X)", old_pc, reg_x, I, reg_x, V[reg_x]);
+									p_trace_msg(dbg_msg);
+									break;
+						case 0x18:	reg_x		= (I & MSK_REG_X) >> 8;
+									TS			= V[reg_x];
+									soundFrame	= soundFrame || (TS > 0);
+									if(ptracing()) sprintf(dbg_msg, "$%03X:   LD TS, V%X       (I=%04X: V%X=$%02X)", old_pc, reg_x, I, reg_x, V[reg_x]);
+									p_trace_msg(dbg_msg);
+									break;
+						case 0x1e:	reg_x		= (I & MSK_REG_X) >> 8;
+									vx			= M;						// mis-use vx to store old M
+									M			= (M + V[reg_x]) & MSK_ADDR;	// stay inside the 4K address space
+									if(ptracing()) sprintf(dbg_msg, "$%03X:   ADD M, V%X       (I=%04X: M(old)=$%03X, V%X=$%02X)", old_pc, reg_x, I, vx, reg_x, V[reg_x]);
+									p_trace_msg(dbg_msg);
+									break;
+						case 0x29:	reg_x		= (I & MSK_REG_X) >> 8;
+									M			= MAP_CHAR_TBL_START + (V[reg_x] * CHAR_SIZE);
+									if(ptracing()) sprintf(dbg_msg, "$%03X:   LD F, V%X        (I=%04X: M=$%03X, V%X=$%02X)", old_pc, reg_x, I, M, reg_x, V[reg_x]);
+									p_trace_msg(dbg_msg);
+									break;
+						case 0x33:	reg_x		= (I & MSK_REG_X) >> 8;			// store BCD representation of VX at memory loc. M
+									hun			= V[reg_x]/100;
+									ten			= (V[reg_x]-(hun*100))/10;
+									one			= V[reg_x] % 10;
+									ram[M]		= hun;
+									ram[M+1]	= ten;
+									ram[M+2]	= one;
+									written(M, 3);
+									if(ptracing()) sprintf(dbg_msg, "$%03X:   STO B, V%X       (I=%04X: M=$%03X, V%X=$%03i)", old_pc, reg_x, I, M, reg_x, V[reg_x]);
+									p_trace_msg(dbg_msg);
+									break;
+						case 0x55:	reg_x		= (I & MSK_REG_X) >> 8;
+									for(int offset = 0; offset <= reg_x; ++offset){
+										ram[M+offset] = V[offset];
+									}
+									written(M, reg_x+1);
+									if(ptracing()) sprintf(dbg_msg, "$%03X:   STO [M], V%X     (I=%04X: M=$%03X)", old_pc, reg_x, I, M);
+									p_trace_msg(dbg_msg);
+									break;
+						case 0x65:	reg_x		= (I & MSK_REG_X) >> 8;
+									for(int offset = 0; offset <= reg_x; ++offset){
+										V[offset] = ram[M+offset];
+									}
+									if(ptracing()) sprintf(dbg_msg, "$%03X:   RSTO [M], V%X    (I=%04X: M=$%03X)", old_pc, reg_x, I, M);
+									p_trace_msg(dbg_msg);
 									break;
-						}
-						break;
-			default:	std::cerr << "-W- Invalid OP-Code <" << I << ">" << std::endl;
-						break;
+						case 0x75:
+								break;
+					}
+					break;
+		default:	std::cerr << "-W- Invalid OP-Code <" << I << ">" << std::endl;
+					break;
+	}
+	if(!speculating){
+		instrHistory.record(old_pc, I, V);	// a few stores, always on
+		Chip8PerfCounters::add(perfCounters.opClass[I >> 12], 1);
+		if(mTrace.active()){
+			trace_record(old_pc);
 		}
+	}
+}
+//-----------------------------------------------------------------------------
 
-		if(MODE_STEP == execMode){
-			std::unique_lock<std::mutex> mlock(mtx);
-			cond_var.wait(mlock, [this]{return do_step;});
-			do_step=false;
+/**
+	Appends the instruction that was just executed and the registers after
+	it to the binary trace (see \ref Chip8Trace).
+
+	\param	[in]	pc	Address of the instruction.
+*/
+void CHIP8::trace_record(u_int16_t pc)
+{
+	Chip8TraceState s;
+
+	memcpy(s.V, V, sizeof(s.V));
+	s.M		= M;
+	s.SP	= static_cast<uint8_t>(SP);
+	s.TD	= TD;
+	s.TS	= TS;
+	mTrace.record(instrCount, pc, I, s);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Emulates one 60Hz frame synchronously in the calling thread, without speed
+	limit: perFrame instructions, then the delay and sound timers count down
+	once. Key reads never block (see \ref execute()). Used by frontends that
+	schedule many emulators on their own threads (grid view, thumbnails), don't
+	call it while \ref Run() is active.
+
+	\param	[in]	perFrame	Instructions per frame.
+*/
+void CHIP8::run_frame(unsigned int perFrame)
+{
+	CHIP8_PROFILE("frame");
+	waitForKeys = false;
+	{
+		CHIP8_PROFILE("execute");
+		for(unsigned int n = 0; n < perFrame; ++n){
+			execute();
 		}
 	}
-	trace_msg("-T- CHIP8::run() end");
-	emulatorRunning=false;
-
-	return 0;
+	handle_timers();
+	mDsp->present(++frameCount);
+	CHIP8_PROBE2(frame, frameCount, instrCount);
+	sound();
 }
 //-----------------------------------------------------------------------------
 
 /**
+	Runs the loaded program from address for a number of frames (see
+	\ref run_frame()). The frame and instruction counts start at 0, so a
+	rewound \ref Chip8KeyTape replays identically.
 
+	\param	[in]	address		Start address of the program.
+	\param	[in]	frames		Number of 60Hz frames to emulate.
+	\param	[in]	perFrame	Instructions per frame.
 */
-std::string CHIP8::parse_op_code(u_int16_t op_code, u_int16_t pc)
+void CHIP8::run_frames(u_int16_t address, unsigned int frames, unsigned int perFrame)
 {
-	std::string	command;
-	char		buf[100];
-	u_int8_t 	reg_x	= 0;		// index of register X
-	u_int8_t 	reg_y	= 0;		// index of register Y
-	u_int8_t 	k		= 0;		// 8-bit constant
-	u_int16_t	i_val	= 0;
-
-	switch((op_code & MSK_OP_CODE) >> 12){
-	case 0:	if(OC_CALL == op_code){
-				sprintf(buf, "$%03X:   SYS, addr (not implemented -> HALT)", pc);
-				command = buf;
-			} else if(OC_DSP_CLR == op_code){
-				sprintf(buf, "$%03X:   CLS", pc);
-				command	= buf;
-			} else if(OC_RET == op_code){
-				sprintf(buf, "$%03X:   RET",pc);
-				command	= buf;
-			}
-			break;
-	case 1:	PC = (op_code & MSK_ADDR);		// JMP to address
-			sprintf(buf, "$%03X:   JMP $%03X", pc, PC);
-			command = buf;
-			break;
-	case 2: PC = (op_code & MSK_ADDR);		// JSR
-			sprintf(buf, "$%03X:   CALL $%03X", pc, PC);
-			command = buf;
-			break;
-	case 3:	reg_x	= (op_code & MSK_REG_X) >> 8;
-			k		= (op_code & MSK_CONST);
-			sprintf(buf, "$%03X:   SE V%X #$%02X", pc, reg_x, k);
-			command = buf;
-			break;
-	case 4:	reg_x	= (op_code & MSK_REG_X) >> 8;
-			k		= (op_code & MSK_CONST);
-			sprintf(buf, "$%03X:   SNE V%X, #$%02X", pc, reg_x, k);
-			command = buf;
-			break;
-	case 5:	reg_x	= (op_code & MSK_REG_X) >> 8;
-			reg_y	= (op_code & MSK_REG_Y) >> 4;
-			sprintf(buf, "$%03X:   SE V%X, V%X", pc, reg_x, reg_y);
-			command = buf;
-			break;
-	case 6:	reg_x		= (op_code & MSK_REG_X) >> 8;
-			k			= (op_code & MSK_CONST);
-			sprintf(buf, "$%03X:   LD V%X, #$%02X", pc, reg_x, k);
-			command = buf;
-			break;
-	case 7:	reg_x		= (op_code & MSK_REG_X) >> 8;
-			k			= (op_code & MSK_CONST);
-			sprintf(buf, "$%03X:   ADD V%X, #$%02X", pc, reg_x, k);
-			command = buf;
-			break;
-	case 8:	switch(op_code & 0x000f){
-				case 0:	reg_x		= (op_code & MSK_REG_X) >> 8;
-						reg_y		= (op_code & MSK_REG_Y) >> 4;
-						sprintf(buf, "$%03X:   LD V%X, V%X", pc, reg_x, reg_y);
-						command = buf;
-						V[reg_x]	= V[reg_y];
-						break;
-				case 1:	reg_x		= (op_code & MSK_REG_X) >> 8;
-						reg_y		= (op_code & MSK_REG_Y) >> 4;
-						sprintf(buf, "$%03X:   OR V%X, V%X", pc, reg_x, reg_y);
-						command = buf;
-						break;
-				case 2:	reg_x		= (op_code & MSK_REG_X) >> 8;
-						reg_y		= (op_code & MSK_REG_Y) >> 4;
-						sprintf(buf, "$%03X:   AND V%X, V%X", pc, reg_x, reg_y);
-						command = buf;
-						break;
-				case 3:	reg_x		= (op_code & MSK_REG_X) >> 8;
-						reg_y		= (op_code & MSK_REG_Y) >> 4;
-						sprintf(buf, "$%03X:   XOR V%X, V%X", pc, reg_x, reg_y);
-						command = buf;
-						break;
-				case 4:	reg_x		= (op_code & MSK_REG_X) >> 8;
-						reg_y		= (op_code & MSK_REG_Y) >> 4;
-						sprintf(buf, "$%03X:   ADC V%X, V%X", pc, reg_x, reg_y);
-						command = buf;
-						break;
-				case 5:	reg_x		= (op_code & MSK_REG_X) >> 8;
-						reg_y		= (op_code & MSK_REG_Y) >> 4;
-						sprintf(buf, "$%03X:   SBC V%X, V%X", pc, reg_x, reg_y);
-						command = buf;
-						break;
-				case 6:	reg_x		= (op_code & MSK_REG_X) >> 8;
-						reg_y		= (op_code & MSK_REG_Y) >> 4;
-						sprintf(buf, "$%03X:   SHR V%X{, V%X}", pc, reg_x, reg_y);
-						command = buf;
-						break;
-				case 7:	reg_x		= (op_code & MSK_REG_X) >> 8;
-						reg_y		= (op_code & MSK_REG_Y) >> 4;
-						sprintf(buf, "$%03X:   SUBN V%X, V%X", pc, reg_x, reg_y);
-						command = buf;
-						break;
-				case 0x0e:	reg_x		= (op_code & MSK_REG_X) >> 8;
-							reg_y		= (op_code & MSK_REG_Y) >> 4;
-							sprintf(buf, "$%03X:   SHL V%X{, V%X}", pc, reg_x, reg_y);
-							command = buf;
-							break;
-			}
-			break;
-	case 9:		reg_x	= (op_code & MSK_REG_X) >> 8;
-				reg_y	= (op_code & MSK_REG_Y) >> 4;
-				sprintf(buf, "$%03X:   SNE V%X, V%X", pc, reg_x, reg_y);
-				command = buf;
-				break;
-	case 0xa:	M = (op_code & MSK_ADDR);		// Load new address
-				sprintf(buf, "$%03X:   LD M, #$%03X", pc, M);
-				command = buf;
-				break;
-	case 0xb:	PC = (op_code & MSK_ADDR) + V[0];
-				sprintf(buf, "$%03X:   JMP V0, #$%03X", pc, M);
-				command = buf;
-				break;
-	case 0xc:	reg_x	= (op_code & MSK_REG_X) >> 8;
-				k		= (op_code & MSK_CONST);
-				sprintf(buf, "$%03X:   RND V%X, #$%02X", pc, reg_x, k);
-				command = buf;
-				break;
-	case 0xd:	reg_x	= (op_code & MSK_REG_X) >> 8;
-				reg_y	= (op_code & MSK_REG_Y) >> 4;
-				i_val	= (op_code & 0x000f);
-				sprintf(buf, "$%03X:   DRW V%X, V%X, #$%X", pc, reg_x, reg_y, i_val);
-				command = buf;
-				break;
-	case 0xe: switch(op_code & 0x00ff){
-			case 0x9e:	reg_x		= (op_code & MSK_REG_X) >> 8;
-						sprintf(buf, "$%03X:   SKP V%X", pc, reg_x);
-						command = buf;
-						break;
-			case 0xa1:	reg_x		= (op_code & MSK_REG_X) >> 8;
-						sprintf(buf, "$%03X:   SKNP V%X", pc, reg_x);
-						command = buf;
-						break;
-			default:	sprintf(buf,"-E- Unknown OP-code %04X", op_code);
-						command = buf;
-						break;
-			}
-				break;
-	case 0xf:	switch(op_code & 0x00ff){
-			case 0x07:	reg_x		= (op_code & MSK_REG_X) >> 8;
-						sprintf(buf, "$%03X:   LD V%X, TD", pc, reg_x);
-						command = buf;
-						break;
-			case 0x0a:	reg_x		= (op_code & MSK_REG_X) >> 8;
-						sprintf(buf, "$%03X:   LD V%X, K", pc, reg_x);
-						command = buf;
-						break;
-			case 0x15:	reg_x		= (op_code & MSK_REG_X) >> 8;
-					sprintf(buf, "$%03X:   LD TD, V%X", pc, reg_x);
-					command = buf;
-					break;
-			case 0x18:	reg_x		= (op_code & MSK_REG_X) >> 8;
-					sprintf(buf, "$%03X:   LD TS, V%X", pc, reg_x);
-					command = buf;
-					break;
-			case 0x1e:	reg_x		= (op_code & MSK_REG_X) >> 8;
-					sprintf(buf, "$%03X:   ADD M, V%X", pc, reg_x);
-					command = buf;
-					break;
-			case 0x29:	reg_x		= (op_code & MSK_REG_X) >> 8;
-					sprintf(buf, "$%03X:   LD F, V%X", pc, reg_x);
-					command = buf;
-					break;
-			case 0x33:	reg_x		= (op_code & MSK_REG_X) >> 8;			// store BCD representation of VX at memory loc. M
-					sprintf(buf, "$%03X:   STO B, V%X", pc, reg_x);
-					command = buf;
-					break;
-			case 0x55:	reg_x		= (op_code & MSK_REG_X) >> 8;
-					sprintf(buf, "$%03X:   STO [M], V%X", pc, reg_x);
-					command = buf;
-					break;
-			case 0x65:	reg_x		= (op_code & MSK_REG_X) >> 8;
-					sprintf(buf, "$%03X:   RSTO [M], V%X", pc, reg_x);
-					command = buf;
-					break;
-			case 0x75:
-					break;
-			}
+	PC			= address;
+	frameCount	= 0;
+	instrCount	= 0;
+	for(unsigned int f = 0; f < frames; ++f){
+		run_frame(perFrame);
 	}
-	return command;
 }
 //-----------------------------------------------------------------------------
 
 /**
+	Disassembles the single instruction at address. This doesn't touch the
+	machine state and can be called from the user interface while the program
+	is running.
+*/
+std::string CHIP8::disassemble(u_int16_t address) const
+{
+	return Chip8Disassembler::format(peek(address), address);
+}
+//-----------------------------------------------------------------------------
 
+/**
+	Reads the (big endian) 16-bit word at address, 0 outside the memory.
 */
-std::vector<std::string> CHIP8::disassemble(void)
+u_int16_t CHIP8::peek(u_int16_t address) const
 {
-	std::vector<std::string>	prog;
-	u_int16_t					base = PC;
+	if(address+1 >= VM_SIZE){
+		return 0;
+	}
+	return static_cast<u_int16_t>((ram[address] << 8) | ram[address+1]);
+}
+//-----------------------------------------------------------------------------
 
-	for(unsigned int index = 0; index < program_size; index+=2){
-		prog.push_back(parse_op_code(htons(*(u_int16_t*)(ram+base+index)), base+index));
+/**
+	Records a write of the emulated program into memory. The user interface
+	compares the page generations (\ref page_generation()) to find out which
+	parts of the code view are outdated, so writes cost one atomic increment
+	per page and no signal.
+
+	\param	[in]	address	First byte written.
+	\param	[in]	length	Number of bytes written.
+*/
+void CHIP8::written(u_int16_t address, unsigned int length)
+{
+	if(0 == length){
+		return;
+	}
+	unsigned int last = std::min(address + length - 1, static_cast<unsigned int>(VM_SIZE - 1));
+	for(unsigned int page = address >> PAGE_SHIFT; page <= (last >> PAGE_SHIFT); ++page){
+		pageGen[page].fetch_add(1, std::memory_order_release);
 	}
-	return prog;
 }
 //-----------------------------------------------------------------------------
 
@@ -831,6 +1234,34 @@ void CHIP8::mode(EMULATION_MODE mode)
 //-----------------------------------------------------------------------------
 
 
+/**
+	This method stops the emulation thread (if any) and waits for it, the
+	memory, registers and display are left as they are (e.g. for
+	\ref save_snapshot()).
+
+	\return true if the program was running and not halted.
+*/
+bool CHIP8::terminate(void)
+{
+	bool running = (nullptr != runMethod) && emulatorRunning && (MODE_RUNNING == execMode);
+
+	emuTimer->stop();
+	if(runMethod){
+		exitSignal->set_value();			// tell run() thread to stop
+
+		if(MODE_STEP == execMode){		// make sure we are not stuck in a wait for a condition var
+			Continue();
+		}
+
+		runMethod->join();
+		delete runMethod;
+	}
+	runMethod = nullptr;
+	emulatorRunning = false;
+	return running;
+}
+//-----------------------------------------------------------------------------
+
 /* Pupblic slots */
 
 /**
@@ -845,6 +1276,7 @@ void CHIP8::Stop(void)
 {
 	execMode = MODE_STEP;
 	do_step  = true;
+	CHIP8_PROBE1(stop, PC);
 }
 //-----------------------------------------------------------------------------
 
@@ -858,6 +1290,7 @@ void CHIP8::Step(void)
 		std::lock_guard<std::mutex> guard(mtx);		// acquire mutex for condition var.
 		do_step = true;								// do one step
 		cond_var.notify_one();						// send the notification
+		CHIP8_PROBE1(step, PC);
 	}
 }
 //-----------------------------------------------------------------------------
@@ -872,6 +1305,7 @@ void CHIP8::Continue(void)
 		std::lock_guard<std::mutex> guard(mtx);		// acquire mutex for condition var ...
 		cond_var.notify_one();						// ... and tell the thread to stop waiting for the condition var
 		do_step		= true;							//
+		CHIP8_PROBE1(resume, PC);
 	}
 }
 //-----------------------------------------------------------------------------
@@ -886,6 +1320,10 @@ void CHIP8::Run(u_int16_t address)
 {
 	emulatorRunning = true;
 	execMode = MODE_RUNNING;
+	frameCount = 0;
+	instrCount = 0;
+	frameStart = 0;
+	instrHistory.clear();
 	start_timers();																		// start the CHIP8 60 Hz timers
     if(exitSignal){
         delete exitSignal, exitSignal = 0;
@@ -897,23 +1335,16 @@ void CHIP8::Run(u_int16_t address)
 //-----------------------------------------------------------------------------
 
 /**
-
+	This slot stops the program and clears display and memory. The program
+	is forgotten as well, so no session is saved for the cleared machine.
 */
 void CHIP8::Reset(void)
 {
-	emuTimer->stop();
-	if(runMethod){
-		exitSignal->set_value();			// tell run() thread to stop
-
-		if(MODE_STEP == execMode){		// make sure we are not stuck in a wait for a condition var
-			Continue();
-		}
-
-		runMethod->join();
-	}
-	runMethod = nullptr;
-	emulatorRunning = false;
+	terminate();
 	mDsp->clear();
 	memset(ram, 0, VM_SIZE);			// clear memory
+	program_size	= 0;
+	programHash		= 0;
+	written(0, VM_SIZE);
 }
 //-----------------------------------------------------------------------------
@@ -8,13 +8,23 @@
 #include <future>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
 
 #include "chip8keyboard.h"
+#include "chip8state.h"
+#include "chip8seqlock.h"
+#include "chip8history.h"
+#include "chip8perf.h"
+#include "chip8logger.h"
+#include "chip8trace.h"
 
 #define VM_SIZE	8192
 #define CHAR_SIZE	5
 
 class Chip8Display;
+class Chip8Audio;
+class Chip8Metrics;
+struct Chip8Snapshot;
 
 class CHIP8 : public QObject
 {
@@ -40,6 +50,15 @@ class CHIP8 : public QObject
 			MAP_RAM_END			= 0xfff
 		};
 
+		enum MEMORY_PAGE {
+			PAGE_SHIFT	= 8,					///< Memory writes are tracked in pages of 256 byte.
+			PAGE_COUNT	= VM_SIZE >> PAGE_SHIFT	///< Number of tracked pages.
+		};
+
+		enum RANDOM {
+			RNG_SEED	= 0x2545f491			///< Default seed of the Cxnn generator.
+		};
+
 		enum WIN_SIZE {
 			WIN_ROWS	= 32,	///< Original CHIP8 rows (32)
 			WIN_COLS	= 64,	///< Original CHIP8 columns (64)
@@ -101,14 +120,28 @@ class CHIP8 : public QObject
 		unsigned int height(void){return dsp_height;}
 		int load(std::string program, u_int16_t address);
 		int load_file(std::string filename, u_int16_t address);
+		static u_int64_t program_hash(std::string const& program);				///< FNV-1a hash of a program (identifies snapshots and thumbnails).
+		bool terminate(void);													///< Stop the emulation thread, keep the machine state.
+		bool save_snapshot(std::string const& filename, bool running) const;	///< Write the machine state to a file.
+		bool restore_snapshot(std::string const& filename, u_int64_t romHash, bool& running);	///< Load the machine state written by \ref save_snapshot().
 		void set_address(u_int16_t address){PC = address;}
-		std::vector<std::string> disassemble(void);
+		void seed(u_int32_t aSeed){rngSeed = aSeed ? aSeed : static_cast<u_int32_t>(RNG_SEED); rng = rngSeed;}	///< Seed of Cxnn, applied again by every \ref load().
+		void run_frame(unsigned int perFrame);											///< Emulate one frame synchronously in the calling thread.
+		void run_frames(u_int16_t address, unsigned int frames, unsigned int perFrame);	///< Run synchronously from address for a number of frames.
+		std::string disassemble(u_int16_t address) const;						///< Disassemble the instruction at address (any thread).
+		u_int16_t peek(u_int16_t address) const;								///< Read the 16-bit word at address (any thread).
+		unsigned char const* memory(void) const {return ram;}					///< The emulator memory (VM_SIZE byte).
+		u_int16_t program_length(void) const {return program_size;}			///< Size of the loaded program in byte.
+		u_int16_t program_address(void) const {return programAddress;}		///< Address the program was loaded to.
+		u_int32_t page_generation(unsigned int page) const {return pageGen[page].load(std::memory_order_acquire);}	///< Changes whenever the program writes into the page.
 		bool log(void){return f_log;}
 		bool trace(void){return f_trace;}
 		bool ptrace(void){return f_ptrace;}
 		int open_log(void);
 		void close_log(void);
 		void set_logname(std::string filename);
+		Chip8Logger& logger(void){return mLog;}				///< The log file (e.g. \ref Chip8Logger::set_overflow()).
+		Chip8Trace& binary_trace(void){return mTrace;}		///< Binary instruction trace, open it before \ref Run().
 		void trace_on(void){f_trace = true;}
 		void trace_of(void){f_trace = false;}
 		void log_on(void){f_log = true;}
@@ -116,41 +149,84 @@ class CHIP8 : public QObject
 		void ptrace_on(void){f_ptrace = true;}
 		void ptrace_of(void){f_ptrace = false;}
 		Chip8Display* display(void){return mDsp;}
+		void set_audio(Chip8Audio* aAudio){mAudio = aAudio;}			///< Render the sound timer into aAudio (not owned, set before \ref Run()).
+		Chip8Audio* audio(void) const {return mAudio;}
+		bool state(Chip8State& s) const {return snapshot.load(s);}		///< Read the last published CPU state (any thread).
+		Chip8History const& history(void) const {return instrHistory;}	///< The last executed instructions (read only while halted).
+		Chip8PerfCounters const& perf(void) const {return perfCounters;}	///< Performance counters of the emulation (any thread).
+		void register_metrics(Chip8Metrics& metrics);					///< Export the counters of the emulation, display, log and sound.
 
 	signals:
 		void ButtonPress(int button);					///< Signal a button press to the main window for possible display.
 		void ButtonRelease(int button);					///< Signal a button release to the main window for possible display.
-		void UpdateTs(u_int8_t const ts);				///< Send new value of sound timer to main window for display.
-		void UpdateTd(u_int8_t const td);				///< Send new value of delay timer to main window for display.
-		void UpdateV(unsigned char const* regs);		///< Send new values of registers to main window for display.
-		void UpdateM(u_int16_t const M);				///< Send new value of memory pointer to main window for display.
-		void UpdateI(u_int16_t const I);				///< Send current instruction to main window for display.
-		void UpdatePC(u_int16_t const pc);				///< Send new value of program counter to main window for display.
-		void UpdateStack(u_int16_t const*  stack);		///< Send current stack contents to main window for display.
-		void UpdateSP(u_int16_t const sp);				///< Send current stack pointer to main windows for display.
+		void Stepped(void);								///< The program halted after \ref Stop() or \ref Step(), \ref state() is up to date.
 
 	public slots:
 		void Run(u_int16_t address);					///< This slot executes the program at \ref address in a new thread.
 		void Stop(void);								///< This slot interrupts the running thread (but keeps it alive)
 		void Step(void);								///< This slot single-steps the program.
 		void Continue(void);							///< This slot continues after an interrupt.
-		void Clock(int time){sleep_time = time;}		///< This slot changes the emulation speed.
+		void Clock(int time){sleep_time = time; perfCounters.targetIps.store((time > 0) ? 1000000/time : 0, std::memory_order_relaxed);}	///< This slot changes the emulation speed.
 		void Reset(void);								///< This slot stops the current program and terminates the thread.
+		void RunAhead(int frames){runAheadFrames.store(frames, std::memory_order_relaxed);}	///< This slot sets the number of run-ahead frames (0: off).
 
 	private:
 		void start_timers(void);									///< Start the 60Hz CHIP8 timers
 		void log_msg(char const* msg);								///< Write log-messages if enabled.
 		void trace_msg(char const* msg);							///< Write trace-messages if enabled.
 		void p_trace_msg(char const* msg);							///< Write program-trace-messages if enabled.
+		bool ptracing(void) const {return Chip8Logger::compiled(Chip8Logger::LEVEL_PROGRAM) && f_ptrace;}	///< Format program-trace-messages at all.
 		int	 run(u_int16_t address, std::future<void> exitRequest);	///< The main emulation routine.
+		void execute(void);											///< Execute one instruction.
+		int	 read_key(void){return keyboard ? keyboard->ReadKey(Chip8Keyboard::RD_MODE_NON_BLOCKING) : Chip8Keyboard::NO_KEY;}	///< Non-blocking key read, no key when headless.
+		bool key_down(u_int8_t key);								///< Test one key of the key mask (Ex9E/ExA1).
+		void key_seen(int key);										///< The program read a pressed key (key latency).
+		void trace_record(u_int16_t pc);							///< Append the executed instruction to \ref mTrace.
 		void handle_timers(void);									///< Handler for Chip8 timers.
-		std::string parse_op_code(u_int16_t op_code, u_int16_t pc);
+		void end_frame(void);										///< Called at the end of every 60Hz frame.
+		void sound(void);											///< Hand the sound timer of the frame to \ref mAudio.
+		void run_ahead(unsigned int frames);						///< Show the display some frames ahead (see \ref RunAhead()).
+		void ahead_off(void);										///< Show every draw again.
+		void capture(Chip8Snapshot& snap) const;					///< Copy the machine state.
+		void apply(Chip8Snapshot const& snap);						///< Restore the machine state.
+		void publish(bool halted);									///< Publish the CPU state for the user interface.
+		void written(u_int16_t address, unsigned int length);		///< Bump the write generation of the pages in [address, address+length).
+
+		/**
+			Counts the delay and sound timers down by one tick, without
+			profiling or probes (run-ahead frames, see \ref handle_timers()).
+		*/
+		void tick_timers(void)
+		{
+			if(TS > 0){
+				--TS;
+			}
+			if(TD > 0){
+				--TD;
+			}
+		}
+
+		/**
+			\return The next random byte of this emulator (Cxnn). Every instance
+			has its own generator, so replays and run-ahead don't disturb each
+			other.
+		*/
+		u_int8_t random_byte(void)
+		{
+			rng ^= rng << 13;
+			rng ^= rng >> 17;
+			rng ^= rng << 5;
+			return static_cast<u_int8_t>(rng >> 24);
+		}
 
 		Chip8Display*			mDsp;						///< Our display object.
 		std::string				log_filename;				///< Name of the logfile.
-		FILE*					log_file;					///< File handle for the logfile.
+		Chip8Logger				mLog;						///< Asynchronous writer of the logfile.
+		Chip8Trace				mTrace;						///< Binary instruction trace (off unless opened).
 		unsigned char*			ram;						///< The memory of the CHIP8 emulation.
 		u_int16_t				program_size;				///< The size of the memory of the CHIP8 emulation.
+		u_int16_t				programAddress;				///< Address the program was loaded to.
+		u_int64_t				programHash;				///< \ref program_hash() of the loaded program.
 		EMULATION_MODE			emuMode;					///< Indicates if we are emulation the classic CHIP8 or the SuperCHIP.
 		EXECUTION_MODE			execMode;
 		bool					emulatorRunning;
@@ -163,6 +239,8 @@ class CHIP8 : public QObject
 		u_int8_t				TD;							///< Delay timer.
 		u_int8_t				TS;							///< Sound timer.
 		int						sleep_time; 				///< Constant to adjust emulation speed.
+		u_int64_t				frameCount;					///< Number of 60Hz frames since the program was started.
+		u_int64_t				instrCount;					///< Number of instructions since the program was started (key tapes).
 		unsigned int			dsp_width;					///< Current width of the display.
 		unsigned int			dsp_height;					///< Current height of the display.
 		bool					f_trace;					///< Indicates whether we are writing a fuction trace or not.
@@ -176,6 +254,23 @@ class CHIP8 : public QObject
 		std::mutex				mtx;						///< Synchronize access to condition variable to control exec mode
 		std::condition_variable	cond_var;					///< Used to control the execution mode (halt, step, continue)
 		bool 					do_step;
+		bool					waitForKeys;				///< Fx0A blocks in the keyboard (own thread) instead of spinning (frame-driven).
+		Chip8SeqLock<Chip8State>	snapshot;				///< CPU state published for the user interface.
+		u_int64_t				snapshotSerial;				///< Number of published snapshots.
+		std::atomic<u_int32_t>	pageGen[PAGE_COUNT];		///< Write generation per memory page.
+		Chip8History			instrHistory;				///< The last executed instructions.
+		Chip8PerfCounters		perfCounters;				///< Performance counters for the HUD.
+		std::atomic<int>		runAheadFrames;				///< Frames to run ahead (0: off).
+		bool					aheadActive;				///< The display only shows run-ahead frames.
+		bool					speculating;				///< Executing run-ahead frames.
+		bool					keyWaiting;					///< Fx0A is waiting for a key (key_wait_start probe fired).
+		u_int64_t				frameStart;					///< \ref instrCount at the start of the frame.
+		Chip8Snapshot*			aheadState;					///< The real state during run-ahead.
+		Chip8Audio*				mAudio;						///< Sound output (optional).
+		bool					soundFrame;					///< Fx18 started a tone in this frame (shorter than a frame).
+		u_int32_t				rngSeed;					///< Seed of the random generator (\ref seed()).
+		u_int32_t				rng;						///< State of the random generator of Cxnn (xorshift32), part of the snapshot.
+		std::atomic<u_int32_t>	timerTicks;					///< Real ticks of \ref handle_timers(), see \ref run_ahead().
 
 		static unsigned char CHAR_0[];
 		static unsigned char CHAR_1[];
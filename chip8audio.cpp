@@ -0,0 +1,159 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include "chip8audio.h"
+
+/**
+	Constructor, the default tone is a square wave of 250Hz (pattern of 8 bits
+	off and 8 bits on, 4000 bits per second).
+
+	\param	[in]	ringMs	Capacity of the ring buffer in ms.
+*/
+Chip8Audio::Chip8Audio(unsigned int ringMs)
+: ring(SAMPLE_RATE * ringMs / 1000), stamps(60 * ringMs / 1000 + 2), bitRate(4000.0), phase(0.0), next(0), consumed(0)
+, havePending(false), lossless(false), lastFrameNs(0), producedSamples(0), droppedSamples(0), underrunCount(0)
+{
+	for(unsigned int i = 0; i < sizeof(pattern); ++i){
+		pattern[i] = (i & 1) ? 0xff : 0x00;
+	}
+	pending.first	= 0;
+	pending.ns		= 0;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Returns a monotonic time stamp in ns.
+*/
+int64_t Chip8Audio::now_ns(void)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Sets the tone like the XO-CHIP audio pattern buffer: 128 bits played at
+	4000 * 2^((pitch-64)/48) bits per second.
+
+	\param	[in]	aPattern	16 byte pattern, MSB first.
+	\param	[in]	aPitch		Pitch register.
+*/
+void Chip8Audio::set_pattern(uint8_t const aPattern[16], uint8_t aPitch)
+{
+	memcpy(pattern, aPattern, sizeof(pattern));
+	bitRate = 4000.0 * std::pow(2.0, (static_cast<int>(aPitch) - 64) / 48.0);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Renders one 60Hz frame of samples into the ring (emulator thread). Silence
+	is rendered too, so the sink sees a continuous stream while the program
+	runs. If the ring is full the rest of the frame is dropped and counted,
+	or with \ref set_lossless() the emulator waits until the sink made room.
+
+	\param	[in]	on	The sound timer was active in this frame.
+*/
+void Chip8Audio::frame(bool on)
+{
+	double	step	= bitRate / SAMPLE_RATE;
+	Stamp	stamp;
+	size_t	n		= 0;
+
+	stamp.first	= next;
+	stamp.ns	= now_ns();
+	stamps.push(stamp);
+	lastFrameNs.store(stamp.ns, std::memory_order_relaxed);
+	for(; n < SAMPLES_PER_FRAME; ++n){
+		int16_t sample = 0;
+		if(on){
+			unsigned int bit = static_cast<unsigned int>(phase) & 127;
+			sample	= ((pattern[bit >> 3] >> (7 - (bit & 7))) & 1) ? AMPLITUDE : -AMPLITUDE;
+			phase	= std::fmod(phase + step, 128.0);
+		}
+		if(!ring.push(sample)){
+			if(!lossless){
+				break;
+			}
+			do {
+				std::this_thread::yield();
+			} while(!ring.push(sample));
+		}
+	}
+	next += n;
+	producedSamples.store(producedSamples.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	if(n < SAMPLES_PER_FRAME){
+		droppedSamples.store(droppedSamples.load(std::memory_order_relaxed) + SAMPLES_PER_FRAME - n, std::memory_order_relaxed);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Takes up to count samples from the ring and measures the latency of the
+	first one (sink thread).
+*/
+size_t Chip8Audio::take(int16_t* out, size_t count)
+{
+	size_t n = 0;
+
+	while((n < count) && ring.pop(out[n])){
+		++n;
+	}
+	if(0 == n){
+		return 0;
+	}
+	while(true){												// find the frame of the first sample
+		if(!havePending){
+			if(!stamps.pop(pending)){
+				break;
+			}
+			havePending = true;
+		}
+		if(pending.first + SAMPLES_PER_FRAME <= consumed){		// frame (partly dropped) is behind us
+			havePending = false;
+			continue;
+		}
+		if(pending.first <= consumed){
+			int64_t rendered = pending.ns + static_cast<int64_t>((consumed - pending.first) * 1000000000ull / SAMPLE_RATE);
+			int64_t age = now_ns() - rendered;
+			latencyHist.add((age > 0) ? static_cast<uint32_t>(age / 1000) : 0);
+		}
+		break;
+	}
+	consumed += n;
+	return n;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Fills out with count samples for an audio callback. Missing samples are
+	replaced by silence, this counts as an underrun if the emulator rendered
+	a frame in the last 100 ms (a halted program is no underrun).
+
+	\return	count
+*/
+size_t Chip8Audio::read(int16_t* out, size_t count)
+{
+	size_t n = take(out, count);
+
+	if(n < count){
+		memset(out + n, 0, (count - n) * sizeof(int16_t));
+		if((now_ns() - lastFrameNs.load(std::memory_order_relaxed)) < 100000000){
+			underrunCount.store(underrunCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+	}
+	return count;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Takes the samples that are in the ring, up to count, for a sink that is
+	not bound to real time (e.g. \ref Chip8WavSink).
+
+	\return Number of samples stored in out.
+*/
+size_t Chip8Audio::read_available(int16_t* out, size_t count)
+{
+	return take(out, count);
+}
+//-----------------------------------------------------------------------------
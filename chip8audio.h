@@ -0,0 +1,78 @@
+#ifndef CHIP8AUDIO_H
+#define CHIP8AUDIO_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include "chip8spscqueue.h"
+#include "chip8histogram.h"
+
+/**
+	Sound of the emulator: turns the sound timer into 16-bit mono PCM.
+
+	The emulator thread calls \ref frame() at the end of every 60Hz frame,
+	which renders one frame of samples into a lock-free ring buffer. Exactly
+	one sink consumes the ring: the audio callback of \ref Chip8AudioOutput
+	(speaker, needs Qt Multimedia) with \ref read() or \ref Chip8WavSink
+	(file, headless) with \ref read_available().
+
+	The tone is a 128-bit pattern played at a bit rate derived from a pitch,
+	as the XO-CHIP audio pattern buffer works. This emulator has no XO-CHIP
+	instructions yet, the default pattern is a square wave and
+	\ref set_pattern() is the hook for them.
+
+	Measured for the HUD: underruns (the callback found less than it needed
+	while the emulator was producing), samples dropped because the ring was
+	full and the latency from rendering a sample to handing it to the sink.
+*/
+class Chip8Audio
+{
+	public:
+		enum AUDIO_FORMAT {
+			SAMPLE_RATE			= 48000,				///< Samples per second.
+			SAMPLES_PER_FRAME	= SAMPLE_RATE / 60,		///< Samples per 60Hz frame.
+			AMPLITUDE			= 8000					///< Amplitude of the tone.
+		};
+
+		explicit Chip8Audio(unsigned int ringMs = 200);		///< Constructor, the ring holds ringMs of audio.
+
+		void		frame(bool on);													///< Render one 60Hz frame (emulator thread).
+		void		set_pattern(uint8_t const aPattern[16], uint8_t aPitch);		///< Tone pattern and pitch (XO-CHIP semantics, emulator thread).
+		void		set_lossless(bool on)	{lossless = on;}						///< \ref frame() waits for the sink instead of dropping (headless, set before rendering).
+		size_t		read(int16_t* out, size_t count);								///< Fill out completely, silence on underrun (sink thread).
+		size_t		read_available(int16_t* out, size_t count);					///< Take what is there, up to count (sink thread).
+
+		uint64_t	underruns(void) const	{return underrunCount.load(std::memory_order_relaxed);}	///< Reads that had to insert silence.
+		uint64_t	dropped(void) const		{return droppedSamples.load(std::memory_order_relaxed);}	///< Samples lost because the ring was full.
+		uint64_t	produced(void) const	{return producedSamples.load(std::memory_order_relaxed);}	///< Samples rendered so far.
+		double		buffered_ms(void) const	{return 1000.0 * ring.size() / SAMPLE_RATE;}				///< Audio waiting in the ring.
+		Chip8Histogram const& latency(void) const {return latencyHist;}							///< Render-to-sink latency (us).
+
+	private:
+		struct Stamp {
+			uint64_t	first;		///< Index of the first sample of a frame.
+			int64_t		ns;			///< Time the frame was rendered.
+		};
+
+		size_t		take(int16_t* out, size_t count);
+		static int64_t now_ns(void);
+
+		Chip8SpscQueue<int16_t>	ring;				///< The samples.
+		Chip8SpscQueue<Stamp>	stamps;				///< Render time of every frame in the ring.
+		uint8_t					pattern[16];		///< 128 bit tone pattern.
+		double					bitRate;			///< Pattern bits per second.
+		double					phase;				///< Position in the pattern (bits).
+		uint64_t				next;				///< Index of the next sample to render.
+		uint64_t				consumed;			///< Index of the next sample to hand out (sink).
+		Stamp					pending;			///< Oldest stamp not yet reached by the sink.
+		bool					havePending;		///< pending is valid.
+		bool					lossless;			///< See \ref set_lossless().
+		std::atomic<int64_t>	lastFrameNs;		///< Time of the last \ref frame().
+		std::atomic<uint64_t>	producedSamples;	///< Statistics: samples rendered.
+		std::atomic<uint64_t>	droppedSamples;		///< Statistics: samples lost (ring full).
+		std::atomic<uint64_t>	underrunCount;		///< Statistics: reads short of samples.
+		Chip8Histogram			latencyHist;		///< Statistics: render-to-sink latency.
+};
+
+#endif // CHIP8AUDIO_H
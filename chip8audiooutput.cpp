@@ -0,0 +1,71 @@
+#include <QAudioFormat>
+
+#include "chip8audiooutput.h"
+#include "chip8audio.h"
+
+/**
+	Constructor, opens the default audio device with the format of
+	\ref Chip8Audio and starts pulling samples.
+
+	\param	[in]	aAudio	The sound of the emulator (this output is its only reader).
+	\param	[in]	parent	Parent object.
+*/
+Chip8AudioOutput::Chip8AudioOutput(Chip8Audio* aAudio, QObject* parent)
+: QIODevice(parent), audio(aAudio), output(nullptr)
+{
+	QAudioFormat format;
+	format.setSampleRate(Chip8Audio::SAMPLE_RATE);
+	format.setChannelCount(1);
+	format.setSampleSize(16);
+	format.setCodec("audio/pcm");
+	format.setByteOrder(QAudioFormat::LittleEndian);
+	format.setSampleType(QAudioFormat::SignedInt);
+
+	output = new QAudioOutput(format, this);
+	output->setBufferSize(Chip8Audio::SAMPLE_RATE * 2 * BUFFER_MS / 1000);
+	open(QIODevice::ReadOnly);
+	output->start(this);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Destructor, stops the playback.
+*/
+Chip8AudioOutput::~Chip8AudioOutput()
+{
+	output->stop();
+	close();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	\return true if the audio device is playing.
+*/
+bool Chip8AudioOutput::ok(void) const
+{
+	return QAudio::NoError == output->error();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Audio callback: hands over whole samples, with silence where the ring
+	ran dry (counted as underrun).
+*/
+qint64 Chip8AudioOutput::readData(char* data, qint64 maxlen)
+{
+	size_t count = static_cast<size_t>(maxlen) / sizeof(int16_t);
+
+	return static_cast<qint64>(audio->read(reinterpret_cast<int16_t*>(data), count) * sizeof(int16_t));
+}
+//-----------------------------------------------------------------------------
+
+/**
+	The output is read only.
+*/
+qint64 Chip8AudioOutput::writeData(char const* data, qint64 len)
+{
+	Q_UNUSED(data)
+	Q_UNUSED(len)
+	return -1;
+}
+//-----------------------------------------------------------------------------
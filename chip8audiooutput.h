@@ -0,0 +1,40 @@
+#ifndef CHIP8AUDIOOUTPUT_H
+#define CHIP8AUDIOOUTPUT_H
+
+#include <QIODevice>
+#include <QAudioOutput>
+
+class Chip8Audio;
+
+/**
+	Plays the sound of the emulator on the default audio device (Qt
+	Multimedia, only built if it is available, see CHIP8_HAVE_QTAUDIO).
+
+	The audio output pulls the samples: its callback reads exactly the
+	requested amount from the ring of \ref Chip8Audio (\ref readData()), so
+	missing samples show up as underruns there. The device buffer is kept
+	small (\ref BUFFER_MS) for a low latency.
+*/
+class Chip8AudioOutput : public QIODevice
+{
+	Q_OBJECT
+
+	public:
+		enum OUTPUT_BUFFER {
+			BUFFER_MS	= 40		///< Size of the device buffer.
+		};
+
+		explicit Chip8AudioOutput(Chip8Audio* aAudio, QObject* parent = nullptr);		///< Constructor, starts the playback.
+		~Chip8AudioOutput() override;													///< Destructor, stops the playback.
+		bool	ok(void) const;															///< The device plays.
+
+	protected:
+		qint64	readData(char* data, qint64 maxlen) override;							///< Audio callback.
+		qint64	writeData(char const* data, qint64 len) override;						///< Not supported.
+
+	private:
+		Chip8Audio*		audio;		///< Source of the samples.
+		QAudioOutput*	output;		///< The audio device.
+};
+
+#endif // CHIP8AUDIOOUTPUT_H
@@ -0,0 +1,505 @@
+#include <cstdio>
+#include <algorithm>
+
+#include "chip8disassembler.h"
+
+/**
+	Constructor.
+
+	\param	[in]	aImage	The program.
+	\param	[in]	aSize	Size of the program in byte.
+	\param	[in]	aBase	Load address of the program.
+*/
+Chip8Disassembler::Chip8Disassembler(unsigned char const* aImage, u_int16_t aSize, u_int16_t aBase)
+: image(aImage, aImage + aSize), base(aBase), romHash(0xcbf29ce484222325ull), kinds(aSize, KIND_DATA), leaders(aSize, 0)
+{
+	unsigned char	address[2] = {static_cast<unsigned char>(base & 0xff), static_cast<unsigned char>(base >> 8)};
+
+	for(unsigned char c : address){										// FNV-1a over load address and program
+		romHash = (romHash ^ c) * 0x100000001b3ull;
+	}
+	for(unsigned char c : image){
+		romHash = (romHash ^ c) * 0x100000001b3ull;
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Finds the possible successors of the instruction at address.
+
+	\param	[in]	address	Address of the instruction.
+	\param	[out]	next	Addresses that may be executed next.
+	\param	[out]	ends	The instruction changes the control flow (ends a basic block).
+*/
+void Chip8Disassembler::targets(u_int16_t address, std::vector<u_int16_t>& next, bool& ends) const
+{
+	u_int16_t	op	= op_code(address);
+	u_int16_t	nnn	= op & MSK_ADDR;
+
+	next.clear();
+	ends = true;
+	switch((op & MSK_OP_CODE) >> 12){
+		case 0x0:	if(OC_RET == op){										// return: the caller continues
+						return;
+					}
+					break;
+		case 0x1:	next.push_back(nnn);									// JMP
+					return;
+		case 0x2:	next.push_back(nnn);									// CALL
+					next.push_back(address+2);
+					return;
+		case 0x3:
+		case 0x4:
+		case 0x5:
+		case 0x9:	next.push_back(address+2);								// skips
+					next.push_back(address+4);
+					return;
+		case 0xb:	return;													// JMP V0, NNN: target unknown
+		case 0xe:	if((0x9e == (op & MSK_CONST)) || (0xa1 == (op & MSK_CONST))){
+						next.push_back(address+2);							// SKP, SKNP
+						next.push_back(address+4);
+						return;
+					}
+					break;
+	}
+	ends = false;
+	next.push_back(address+2);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Follows the control flow from entry and marks every reached instruction as
+	code. Afterwards the reached code is split into basic blocks.
+
+	\param	[in]	entry	Address where the program starts.
+*/
+void Chip8Disassembler::analyse(u_int16_t entry)
+{
+	std::vector<u_int16_t>	work(1, entry);
+	std::vector<u_int16_t>	next;
+	bool					ends;
+
+	std::fill(kinds.begin(), kinds.end(), KIND_DATA);
+	std::fill(leaders.begin(), leaders.end(), 0);
+	blockList.clear();
+	if(inside(entry)){
+		leaders[entry-base] = 1;
+	}
+
+	while(!work.empty()){													// trace the code reachable from the entry point
+		u_int16_t a = work.back();
+		work.pop_back();
+		while(inside(a)){
+			if(KIND_CODE == kinds[a-base]){									// joins code that was traced before
+				leaders[a-base] = 1;
+				break;
+			}
+			if((KIND_DATA != kinds[a-base]) || (KIND_DATA != kinds[a-base+1])){
+				break;														// would overlap another instruction
+			}
+			kinds[a-base]	= KIND_CODE;
+			kinds[a-base+1]	= KIND_OPERAND;
+			targets(a, next, ends);
+			if(ends){
+				for(u_int16_t n : next){
+					if(inside(n)){
+						leaders[n-base] = 1;
+						work.push_back(n);
+					}
+				}
+				break;
+			}
+			a += 2;
+		}
+	}
+
+	for(u_int32_t i = 0; i < image.size(); ++i){							// cut the code into basic blocks
+		if(!leaders[i] || (KIND_CODE != kinds[i])){
+			continue;
+		}
+		Block		block;
+		u_int16_t	a = static_cast<u_int16_t>(base + i);
+		block.start = a;
+		while(true){
+			targets(a, next, ends);
+			a += 2;
+			if(ends || !inside(a) || (KIND_CODE != kinds[a-base]) || leaders[a-base]){
+				break;
+			}
+		}
+		block.end = a;
+		for(u_int16_t n : next){
+			if(inside(n) && (KIND_CODE == kinds[n-base])){
+				block.successors.push_back(n);
+			}
+		}
+		blockList.push_back(block);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	\return Whether the byte at address is the start or the operand of an
+			 instruction or data.
+*/
+Chip8Disassembler::BYTE_KIND Chip8Disassembler::kind(u_int16_t address) const
+{
+	if((address < base) || (address >= base + kinds.size())){
+		return KIND_DATA;
+	}
+	return static_cast<BYTE_KIND>(kinds[address-base]);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Builds the listing: one line per instruction and one line per data byte,
+	in address order.
+*/
+std::vector<Chip8Disassembler::Line> Chip8Disassembler::listing(void) const
+{
+	std::vector<Line>	lines;
+
+	for(u_int32_t i = 0; i < image.size(); ){
+		Line line;
+		line.address	= static_cast<u_int16_t>(base + i);
+		line.code		= (KIND_CODE == kinds[i]) && (i+1 < image.size());
+		line.block		= line.code && leaders[i];
+		lines.push_back(line);
+		i += line.code ? 2 : 1;
+	}
+	return lines;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Formats one data byte.
+*/
+std::string Chip8Disassembler::format_data(u_int8_t value, u_int16_t address)
+{
+	char	buf[32];
+
+	sprintf(buf, "$%03X:   DB #$%02X", address, value);
+	return buf;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	\return Name of the cache file of this program.
+*/
+std::string Chip8Disassembler::cache_file(std::string const& cacheDir) const
+{
+	char	name[32];
+
+	sprintf(name, "/%016llx.c8d", static_cast<unsigned long long>(romHash));
+	return cacheDir + name;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Writes the analysis to the cache. File layout (little endian):
+	"C8DA", u32 version, u64 hash, u16 base, u32 size, u8 kind[size], u8 leader[size],
+	u32 block count, per block: u16 start, u16 end, u16 count, u16 successor[count].
+
+	\param	[in]	cacheDir	Directory of the cache (must exist).
+	\return false if the file couldn't be written.
+*/
+bool Chip8Disassembler::save(std::string const& cacheDir) const
+{
+	std::vector<unsigned char>	buf;
+	auto put = [&buf](uint64_t value, unsigned int bytes){
+		for(unsigned int i = 0; i < bytes; ++i){
+			buf.push_back(static_cast<unsigned char>(value >> (8*i)));
+		}
+	};
+
+	buf.insert(buf.end(), {'C', '8', 'D', 'A'});
+	put(CACHE_VERSION, 4);
+	put(romHash, 8);
+	put(base, 2);
+	put(image.size(), 4);
+	buf.insert(buf.end(), kinds.begin(), kinds.end());
+	buf.insert(buf.end(), leaders.begin(), leaders.end());
+	put(blockList.size(), 4);
+	for(Block const& block : blockList){
+		put(block.start, 2);
+		put(block.end, 2);
+		put(block.successors.size(), 2);
+		for(u_int16_t s : block.successors){
+			put(s, 2);
+		}
+	}
+
+	std::string	filename	= cache_file(cacheDir);
+	std::string	tmpname		= filename + ".tmp";								// never leave a half written cache file
+	FILE*		out			= fopen(tmpname.c_str(), "wb");
+	if(nullptr == out){
+		return false;
+	}
+	bool ok = (buf.size() == fwrite(buf.data(), 1, buf.size(), out));
+	ok = (0 == fclose(out)) && ok;
+	return ok && (0 == rename(tmpname.c_str(), filename.c_str()));
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Reads the analysis of this program from the cache.
+
+	\param	[in]	cacheDir	Directory of the cache.
+	\return false if there is no valid cache entry, \ref analyse() must be called then.
+*/
+bool Chip8Disassembler::load(std::string const& cacheDir)
+{
+	FILE*	in = fopen(cache_file(cacheDir).c_str(), "rb");
+	if(nullptr == in){
+		return false;
+	}
+	std::vector<unsigned char>	buf;
+	unsigned char				chunk[4096];
+	size_t						n;
+	while((n = fread(chunk, 1, sizeof(chunk), in)) > 0){
+		buf.insert(buf.end(), chunk, chunk + n);
+	}
+	fclose(in);
+
+	size_t	pos	= 0;
+	bool	ok	= true;
+	auto get = [&buf, &pos, &ok](unsigned int bytes) -> uint64_t {
+		uint64_t value = 0;
+		if(pos + bytes > buf.size()){
+			ok = false;
+			return 0;
+		}
+		for(unsigned int i = 0; i < bytes; ++i){
+			value |= static_cast<uint64_t>(buf[pos++]) << (8*i);
+		}
+		return value;
+	};
+
+	if((buf.size() < 4) || !std::equal(buf.begin(), buf.begin() + 4, "C8DA")){
+		return false;
+	}
+	pos = 4;
+	if((get(4) != CACHE_VERSION) || (get(8) != romHash) || (get(2) != base) || (get(4) != image.size()) || !ok){
+		return false;
+	}
+	if(pos + 2*image.size() > buf.size()){
+		return false;
+	}
+	std::vector<u_int8_t>	newKinds(buf.begin() + pos, buf.begin() + pos + image.size());
+	pos += image.size();
+	std::vector<u_int8_t>	newLeaders(buf.begin() + pos, buf.begin() + pos + image.size());
+	pos += image.size();
+	uint64_t				count = get(4);
+	if(!ok || (count > image.size())){
+		return false;
+	}
+	std::vector<Block>		newBlocks(count);
+	for(Block& block : newBlocks){
+		block.start	= static_cast<u_int16_t>(get(2));
+		block.end	= static_cast<u_int16_t>(get(2));
+		block.successors.resize(std::min<uint64_t>(get(2), 2));
+		for(u_int16_t& s : block.successors){
+			s = static_cast<u_int16_t>(get(2));
+		}
+		if(!ok){
+			return false;
+		}
+	}
+	if(!ok){
+		return false;
+	}
+	kinds.swap(newKinds);
+	leaders.swap(newLeaders);
+	blockList.swap(newBlocks);
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Disassembles one instruction. This is a pure function, it can be used from
+	any thread.
+
+	\param	[in]	op_code	The instruction.
+	\param	[in]	pc		Address of the instruction.
+	\return The assembler text, prefixed with the address.
+*/
+std::string Chip8Disassembler::format(u_int16_t op_code, u_int16_t pc)
+{
+	std::string	command;
+	char		buf[100];
+	u_int8_t 	reg_x	= 0;		// index of register X
+	u_int8_t 	reg_y	= 0;		// index of register Y
+	u_int8_t 	k		= 0;		// 8-bit constant
+	u_int16_t	i_val	= 0;
+
+	switch((op_code & MSK_OP_CODE) >> 12){
+	case 0:	if(OC_CALL == op_code){
+				sprintf(buf, "$%03X:   SYS, addr (not implemented -> HALT)", pc);
+				command = buf;
+			} else if(OC_DSP_CLR == op_code){
+				sprintf(buf, "$%03X:   CLS", pc);
+				command	= buf;
+			} else if(OC_RET == op_code){
+				sprintf(buf, "$%03X:   RET",pc);
+				command	= buf;
+			}
+			break;
+	case 1:	sprintf(buf, "$%03X:   JMP $%03X", pc, op_code & MSK_ADDR);		// JMP to address
+			command = buf;
+			break;
+	case 2: sprintf(buf, "$%03X:   CALL $%03X", pc, op_code & MSK_ADDR);		// JSR
+			command = buf;
+			break;
+	case 3:	reg_x	= (op_code & MSK_REG_X) >> 8;
+			k		= (op_code & MSK_CONST);
+			sprintf(buf, "$%03X:   SE V%X #$%02X", pc, reg_x, k);
+			command = buf;
+			break;
+	case 4:	reg_x	= (op_code & MSK_REG_X) >> 8;
+			k		= (op_code & MSK_CONST);
+			sprintf(buf, "$%03X:   SNE V%X, #$%02X", pc, reg_x, k);
+			command = buf;
+			break;
+	case 5:	reg_x	= (op_code & MSK_REG_X) >> 8;
+			reg_y	= (op_code & MSK_REG_Y) >> 4;
+			sprintf(buf, "$%03X:   SE V%X, V%X", pc, reg_x, reg_y);
+			command = buf;
+			break;
+	case 6:	reg_x		= (op_code & MSK_REG_X) >> 8;
+			k			= (op_code & MSK_CONST);
+			sprintf(buf, "$%03X:   LD V%X, #$%02X", pc, reg_x, k);
+			command = buf;
+			break;
+	case 7:	reg_x		= (op_code & MSK_REG_X) >> 8;
+			k			= (op_code & MSK_CONST);
+			sprintf(buf, "$%03X:   ADD V%X, #$%02X", pc, reg_x, k);
+			command = buf;
+			break;
+	case 8:	switch(op_code & 0x000f){
+				case 0:	reg_x		= (op_code & MSK_REG_X) >> 8;
+						reg_y		= (op_code & MSK_REG_Y) >> 4;
+						sprintf(buf, "$%03X:   LD V%X, V%X", pc, reg_x, reg_y);
+						command = buf;
+						break;
+				case 1:	reg_x		= (op_code & MSK_REG_X) >> 8;
+						reg_y		= (op_code & MSK_REG_Y) >> 4;
+						sprintf(buf, "$%03X:   OR V%X, V%X", pc, reg_x, reg_y);
+						command = buf;
+						break;
+				case 2:	reg_x		= (op_code & MSK_REG_X) >> 8;
+						reg_y		= (op_code & MSK_REG_Y) >> 4;
+						sprintf(buf, "$%03X:   AND V%X, V%X", pc, reg_x, reg_y);
+						command = buf;
+						break;
+				case 3:	reg_x		= (op_code & MSK_REG_X) >> 8;
+						reg_y		= (op_code & MSK_REG_Y) >> 4;
+						sprintf(buf, "$%03X:   XOR V%X, V%X", pc, reg_x, reg_y);
+						command = buf;
+						break;
+				case 4:	reg_x		= (op_code & MSK_REG_X) >> 8;
+						reg_y		= (op_code & MSK_REG_Y) >> 4;
+						sprintf(buf, "$%03X:   ADC V%X, V%X", pc, reg_x, reg_y);
+						command = buf;
+						break;
+				case 5:	reg_x		= (op_code & MSK_REG_X) >> 8;
+						reg_y		= (op_code & MSK_REG_Y) >> 4;
+						sprintf(buf, "$%03X:   SBC V%X, V%X", pc, reg_x, reg_y);
+						command = buf;
+						break;
+				case 6:	reg_x		= (op_code & MSK_REG_X) >> 8;
+						reg_y		= (op_code & MSK_REG_Y) >> 4;
+						sprintf(buf, "$%03X:   SHR V%X{, V%X}", pc, reg_x, reg_y);
+						command = buf;
+						break;
+				case 7:	reg_x		= (op_code & MSK_REG_X) >> 8;
+						reg_y		= (op_code & MSK_REG_Y) >> 4;
+						sprintf(buf, "$%03X:   SUBN V%X, V%X", pc, reg_x, reg_y);
+						command = buf;
+						break;
+				case 0x0e:	reg_x		= (op_code & MSK_REG_X) >> 8;
+							reg_y		= (op_code & MSK_REG_Y) >> 4;
+							sprintf(buf, "$%03X:   SHL V%X{, V%X}", pc, reg_x, reg_y);
+							command = buf;
+							break;
+			}
+			break;
+	case 9:		reg_x	= (op_code & MSK_REG_X) >> 8;
+				reg_y	= (op_code & MSK_REG_Y) >> 4;
+				sprintf(buf, "$%03X:   SNE V%X, V%X", pc, reg_x, reg_y);
+				command = buf;
+				break;
+	case 0xa:	sprintf(buf, "$%03X:   LD M, #$%03X", pc, op_code & MSK_ADDR);		// Load new address
+				command = buf;
+				break;
+	case 0xb:	sprintf(buf, "$%03X:   JMP V0, #$%03X", pc, op_code & MSK_ADDR);
+				command = buf;
+				break;
+	case 0xc:	reg_x	= (op_code & MSK_REG_X) >> 8;
+				k		= (op_code & MSK_CONST);
+				sprintf(buf, "$%03X:   RND V%X, #$%02X", pc, reg_x, k);
+				command = buf;
+				break;
+	case 0xd:	reg_x	= (op_code & MSK_REG_X) >> 8;
+				reg_y	= (op_code & MSK_REG_Y) >> 4;
+				i_val	= (op_code & 0x000f);
+				sprintf(buf, "$%03X:   DRW V%X, V%X, #$%X", pc, reg_x, reg_y, i_val);
+				command = buf;
+				break;
+	case 0xe: switch(op_code & 0x00ff){
+			case 0x9e:	reg_x		= (op_code & MSK_REG_X) >> 8;
+						sprintf(buf, "$%03X:   SKP V%X", pc, reg_x);
+						command = buf;
+						break;
+			case 0xa1:	reg_x		= (op_code & MSK_REG_X) >> 8;
+						sprintf(buf, "$%03X:   SKNP V%X", pc, reg_x);
+						command = buf;
+						break;
+			default:	sprintf(buf,"-E- Unknown OP-code %04X", op_code);
+						command = buf;
+						break;
+			}
+				break;
+	case 0xf:	switch(op_code & 0x00ff){
+			case 0x07:	reg_x		= (op_code & MSK_REG_X) >> 8;
+						sprintf(buf, "$%03X:   LD V%X, TD", pc, reg_x);
+						command = buf;
+						break;
+			case 0x0a:	reg_x		= (op_code & MSK_REG_X) >> 8;
+						sprintf(buf, "$%03X:   LD V%X, K", pc, reg_x);
+						command = buf;
+						break;
+			case 0x15:	reg_x		= (op_code & MSK_REG_X) >> 8;
+					sprintf(buf, "$%03X:   LD TD, V%X", pc, reg_x);
+					command = buf;
+					break;
+			case 0x18:	reg_x		= (op_code & MSK_REG_X) >> 8;
+					sprintf(buf, "$%03X:   LD TS, V%X", pc, reg_x);
+					command = buf;
+					break;
+			case 0x1e:	reg_x		= (op_code & MSK_REG_X) >> 8;
+					sprintf(buf, "$%03X:   ADD M, V%X", pc, reg_x);
+					command = buf;
+					break;
+			case 0x29:	reg_x		= (op_code & MSK_REG_X) >> 8;
+					sprintf(buf, "$%03X:   LD F, V%X", pc, reg_x);
+					command = buf;
+					break;
+			case 0x33:	reg_x		= (op_code & MSK_REG_X) >> 8;			// store BCD representation of VX at memory loc. M
+					sprintf(buf, "$%03X:   STO B, V%X", pc, reg_x);
+					command = buf;
+					break;
+			case 0x55:	reg_x		= (op_code & MSK_REG_X) >> 8;
+					sprintf(buf, "$%03X:   STO [M], V%X", pc, reg_x);
+					command = buf;
+					break;
+			case 0x65:	reg_x		= (op_code & MSK_REG_X) >> 8;
+					sprintf(buf, "$%03X:   RSTO [M], V%X", pc, reg_x);
+					command = buf;
+					break;
+			case 0x75:
+					break;
+			}
+	}
+	return command;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,89 @@
+#ifndef CHIP8DISASSEMBLER_H
+#define CHIP8DISASSEMBLER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <sys/types.h>
+
+/**
+	Control-flow aware CHIP8 disassembler.
+
+	Starting at the entry point, all JMP, CALL and skip targets are followed
+	recursively. Every byte that is reached this way is code, everything else
+	is data. Instructions may start at odd addresses. The reachable code is
+	also split into basic blocks with their successors.
+
+	The disassembler works on a copy of the program and never touches the
+	emulator. The result of \ref analyse() can be cached on disk, keyed by a
+	hash of the program (\ref load(), \ref save()).
+*/
+class Chip8Disassembler
+{
+	public:
+		enum BYTE_KIND {
+			KIND_DATA		= 0,		///< Not reached from the entry point.
+			KIND_CODE		= 1,		///< First byte of an instruction.
+			KIND_OPERAND	= 2			///< Second byte of an instruction.
+		};
+
+		enum OP_MASK {
+			MSK_OP_CODE	= 0xf000,
+			MSK_ADDR	= 0x0fff,
+			MSK_REG_X	= 0x0f00,
+			MSK_REG_Y	= 0x00f0,
+			MSK_CONST	= 0x00ff
+		};
+
+		enum OP_CODE {
+			OC_CALL		= 0x0000,	///< 0NNN - call RCA 1802 program at address NNN
+			OC_DSP_CLR	= 0x00e0,	///< 00E0 - clear screen
+			OC_RET		= 0x00ee	///< 00ee - retun from subroutine
+		};
+
+		/// One line of the listing.
+		struct Line {
+			u_int16_t	address;		///< Address of the line.
+			bool		code;			///< Instruction (2 byte) or data (1 byte).
+			bool		block;			///< First instruction of a basic block.
+		};
+
+		/// A basic block: straight-line code that is only entered at the top.
+		struct Block {
+			u_int16_t				start;			///< Address of the first instruction.
+			u_int16_t				end;			///< Address after the last instruction.
+			std::vector<u_int16_t>	successors;		///< Start addresses of the blocks that may follow.
+		};
+
+		Chip8Disassembler(unsigned char const* aImage, u_int16_t aSize, u_int16_t aBase);	///< Constructor, copies the program.
+		void	analyse(u_int16_t entry);													///< Find code and basic blocks.
+		bool	load(std::string const& cacheDir);											///< Read the analysis from the cache.
+		bool	save(std::string const& cacheDir) const;									///< Write the analysis to the cache.
+
+		uint64_t					hash(void) const	{return romHash;}		///< FNV-1a hash of base address and program.
+		std::vector<Line>			listing(void) const;						///< The listing in address order.
+		std::vector<Block> const&	blocks(void) const	{return blockList;}		///< The basic blocks in address order.
+		BYTE_KIND					kind(u_int16_t address) const;				///< Code or data.
+
+		static std::string	format(u_int16_t op_code, u_int16_t pc);			///< Disassemble one instruction.
+		static std::string	format_data(u_int8_t value, u_int16_t address);		///< Format one data byte.
+
+	private:
+		enum CACHE_FORMAT {
+			CACHE_VERSION	= 1			///< Increment whenever the analysis or the file layout changes.
+		};
+
+		bool		inside(u_int32_t address) const {return (address >= base) && (address + 1 < static_cast<u_int32_t>(base) + image.size());}
+		u_int16_t	op_code(u_int16_t address) const {return static_cast<u_int16_t>((image[address-base] << 8) | image[address-base+1]);}
+		void		targets(u_int16_t address, std::vector<u_int16_t>& next, bool& ends) const;
+		std::string	cache_file(std::string const& cacheDir) const;
+
+		std::vector<unsigned char>	image;			///< Copy of the program.
+		u_int16_t					base;			///< Load address of the program.
+		uint64_t					romHash;		///< Hash of base address and program.
+		std::vector<u_int8_t>		kinds;			///< \ref BYTE_KIND of every program byte.
+		std::vector<u_int8_t>		leaders;		///< 1 for every byte that starts a basic block.
+		std::vector<Block>			blockList;		///< The basic blocks.
+};
+
+#endif // CHIP8DISASSEMBLER_H
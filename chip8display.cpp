@@ -1,24 +1,24 @@
 #include "chip8display.h"
+#include "chip8recorder.h"
+#include "chip8profiler.h"
 
 /**
 
 */
 Chip8Display::Chip8Display(void)
-	: mMode(CHIP8::MODE_CLASSIC), mWidth(CHIP8::WIN_COLS), mHeight(CHIP8::WIN_ROWS)
+	: mMode(CHIP8::MODE_CLASSIC), mWidth(CHIP8::WIN_COLS), mHeight(CHIP8::WIN_ROWS), mFrame(mWidth, mHeight), mRecorder(nullptr), mBacklog(0), mUpdates(0), mFramesOnly(false), mSpeculating(false), mKeyNs(0), mSeenNs(0)
 {
-	mDsp.resize(mWidth);
-	for(unsigned int i = 0; i < mDsp.size(); ++i){
-		mDsp[i].resize(mHeight);
-	}
+	qRegisterMetaType<Chip8Frame>("Chip8Frame");
 };
 //-----------------------------------------------------------------------------
 
 /**
-
+	The destructor stops a running recording. The emulator thread must not
+	present any more frames at this point.
 */
 Chip8Display::~Chip8Display()
 {
-
+	delete mRecorder;
 }
 //-----------------------------------------------------------------------------
 
@@ -45,15 +45,9 @@ void Chip8Display::mode(CHIP8::EMULATION_MODE aMode)
 */
 void Chip8Display::resize(void)
 {
-	mDsp.resize(mWidth);
-	for(unsigned int i = 0; i < mDsp.size(); ++i){
-		mDsp[i].resize(mHeight);
-	}
-	for(unsigned int y = 0; y < mHeight; ++y){
-		for(unsigned int x = 0; x < mWidth; ++x){
-			mDsp[x][y] = false;
-		}
-	}
+	mFrame.width	= mWidth;
+	mFrame.height	= mHeight;
+	mFrame.clear();
 	emit Resize(mWidth, mHeight);	// signal main application to reset (the size of) the screen
 }
 //-----------------------------------------------------------------------------
@@ -63,40 +57,168 @@ void Chip8Display::resize(void)
 */
 void Chip8Display::clear(void)
 {
-	for(unsigned int y = 0; y < mHeight; ++y){
-		for(unsigned int x = 0; x < mWidth; ++x){
-			mDsp[x][y] = false;
-		}
+	mFrame.clear();
+	if(mFramesOnly){
+		return;
 	}
+	mBacklog.fetch_add(1, std::memory_order_relaxed);
 	emit Clear();
+	updated();
 }
 //-----------------------------------------------------------------------------
 
 /**
+	Builds the pixel mask of one sprite line placed at column x, wrapping around
+	at the right edge of the display.
 
+	\param	[in]	line	One line of the sprite (8 pixel, MSB is leftmost).
+	\param	[in]	x		X-position of the sprite.
+	\param	[out]	mask	Row mask with \ref Chip8Frame::WORDS words.
+*/
+void Chip8Display::sprite_mask(unsigned char line, unsigned int x, uint64_t* mask) const
+{
+	for(unsigned int lx = 0; lx < 8; ++lx){
+		if(line & (0x80 >> lx)){
+			unsigned int px = (x+lx) % mWidth;
+			mask[px >> 6] |= 1ull << (63 - (px & 63));
+		}
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Draws a sprite by XOR-ing it line by line into the display rows.
+
+	\return true if at least one pixel was switched off (collision).
 */
 bool Chip8Display::draw_sprite(unsigned int x, unsigned int y, unsigned int size, unsigned char* ram)
 {
-	bool		collision = false;
+	CHIP8_PROFILE("draw_sprite");
+	bool		collision	= false;
+	bool		stats		= mStats.active() && !mSpeculating;		// checked once, no cost per row when off
 
 	if(0 == size ){															// draw an 16x16 sprite
 //TBD
 	} else {																// draw an 8xn sprite
-		int idx=0;															// index for memory access
 		for(unsigned int ly=0; ly < size; ++ly){
-			for(unsigned int lx=0; lx<8; ++lx){
-				bool pixel = ram[idx] & (0x80 >> lx);						// extract pixel from sprite
-				bool screen_pixel = mDsp[(x+lx) % mWidth][(y+ly) % mHeight];
-				if(pixel & screen_pixel){									// check collision
-					collision |= true;
-				}
-				screen_pixel ^= pixel;
-				mDsp[(x+lx) % mWidth][(y+ly) % mHeight] = screen_pixel;		// draw pixel into screen
+			uint64_t	mask[Chip8Frame::WORDS] = {0};
+			uint64_t	hit[Chip8Frame::WORDS];
+			uint64_t*	row = mFrame.rows[(y+ly) % mHeight];
+			sprite_mask(ram[ly], x, mask);
+			for(unsigned int w = 0; w < Chip8Frame::WORDS; ++w){
+				hit[w]		= row[w] & mask[w];
+				collision	|= (0 != hit[w]);								// check collision
+				row[w]		^= mask[w];										// draw pixels into screen
+			}
+			if(stats){
+				mStats.add_row((y+ly) % mHeight, mask, hit);
 			}
-			++idx;
 		}
-		emit DrawSprite(mDsp, x, y, size);	// signal main application to redraw screen
+		if(stats){
+			mStats.add_draw();
+		}
+		if(!mFramesOnly){
+			mBacklog.fetch_add(1, std::memory_order_relaxed);
+			emit DrawSprite(mFrame, x, y, size);	// signal main application to redraw screen
+			updated();
+		}
 	}
 
 	return collision;
 }
+//-----------------------------------------------------------------------------
+
+/**
+	Called by the emulator when the program reads a pressed key for the first
+	time. Adds the queueing stage and keeps the key until the next display
+	update, unless another key is still in flight.
+
+	\param	[in]	keyNs	Time stamp of the key event (\ref Chip8Latency::now_ns()).
+*/
+void Chip8Display::key_observed(int64_t keyNs)
+{
+	int64_t now = Chip8Latency::now_ns();
+
+	mLatency.queueing.add(Chip8Latency::to_us(now - keyNs));
+	if((0 == mKeyNs) && (0 == mLatency.markUpdate.load(std::memory_order_acquire))){
+		mKeyNs	= keyNs;
+		mSeenNs	= now;
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Counts a sent DrawSprite/Clear signal. If a key waits for a display update,
+	this is the one: the emulation stage ends and the key is handed to the view
+	(see \ref Chip8Latency::presented()).
+*/
+void Chip8Display::updated(void)
+{
+	++mUpdates;
+	if(mKeyNs){
+		int64_t now = Chip8Latency::now_ns();
+		mLatency.emulation.add(Chip8Latency::to_us(now - mSeenNs));
+		mLatency.markKeyNs.store(mKeyNs, std::memory_order_relaxed);
+		mLatency.markDrawNs.store(now, std::memory_order_relaxed);
+		mLatency.markUpdate.store(mUpdates, std::memory_order_release);
+		mKeyNs = 0;
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	This method is called by the emulator at the end of every 60Hz frame and
+	passes the completed frame on to the recorder (if any).
+
+	\param	[in]	number	Number of the frame since the program was started.
+*/
+void Chip8Display::present(uint64_t number)
+{
+	mFrame.number = number;
+	if(mStats.active()){
+		mStats.end_frame();
+	}
+	if(mRecorder){
+		mRecorder->push(mFrame);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Installs a recorder that receives every completed frame. The display takes
+	ownership of the recorder and stops it on destruction.
+
+	Must be called before the emulation is started.
+*/
+void Chip8Display::record(Chip8Recorder* aRecorder)
+{
+	delete mRecorder;
+	mRecorder = aRecorder;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Replaces the display contents by a saved frame and sends it to the
+	frontend as one DrawSprite. The frame must have the size of the current
+	mode (call \ref mode() first).
+*/
+void Chip8Display::restore(Chip8Frame const& aFrame)
+{
+	mFrame = aFrame;
+	show(mFrame);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Sends a complete frame to the frontend as one DrawSprite, also while
+	\ref frames_only() is set. The display contents are not changed.
+
+	\param	[in]	aFrame	The frame to show (e.g. a run-ahead frame).
+*/
+void Chip8Display::show(Chip8Frame const& aFrame)
+{
+	mBacklog.fetch_add(1, std::memory_order_relaxed);
+	emit DrawSprite(aFrame, 0, 0, mHeight);
+	updated();
+}
+//-----------------------------------------------------------------------------
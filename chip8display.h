@@ -2,9 +2,11 @@
 #define CHIP8DISPLAY_H
 
 #include "chip8.h"
-#include "mainwindow.h"
+#include "chip8frame.h"
+#include "chip8drawstats.h"
+#include "chip8latency.h"
 
-/// TBD: derive from QObject
+class Chip8Recorder;
 
 class Chip8Display : public QObject
 {
@@ -18,17 +20,42 @@ class Chip8Display : public QObject
 		bool draw_sprite(unsigned int x, unsigned int y, unsigned int size, unsigned char* ram);
 		void resize(void);
 		void clear(void);
+		void present(uint64_t number);						///< Called by the emulator at the end of every 60Hz frame.
+		void record(Chip8Recorder* aRecorder);				///< Hand completed frames to a recorder (takes ownership).
+		void restore(Chip8Frame const& aFrame);				///< Replace the display contents and show them (session snapshot).
+		void set_frame(Chip8Frame const& aFrame) {mFrame = aFrame;}	///< Replace the display contents without telling the frontend.
+		void show(Chip8Frame const& aFrame);				///< Send a complete frame to the frontend.
+		void frames_only(bool on) {mFramesOnly = on;}		///< Only \ref show() reaches the frontend, no signal per draw (run-ahead, headless instances without a receiver).
+		void speculate(bool on) {mSpeculating = on;}		///< Draws of run-ahead frames: no statistics, no key latency.
+		Chip8Frame const& frame(void) const {return mFrame;}
+		Chip8DrawStats* stats(void) {return &mStats;}		///< Draw instrumentation (off by default).
+		int queued(void) const {return mBacklog.load(std::memory_order_relaxed);}	///< Sent DrawSprite/Clear signals not yet handled.
+		void delivered(void) {mBacklog.fetch_sub(1, std::memory_order_relaxed);}	///< Called by the receiver of DrawSprite/Clear.
+		void key_observed(int64_t keyNs);					///< The program read a key pressed at keyNs (emulator thread).
+		Chip8Latency& latency(void) {return mLatency;}		///< Input-to-photon latency of the key presses.
 
 	signals:
-		void DrawSprite(std::vector<std::vector<bool>> display, unsigned int x, unsigned int y, unsigned int size);
+		void DrawSprite(Chip8Frame const& frame, unsigned int x, unsigned int y, unsigned int size);
 		void Resize(unsigned int x, unsigned int y);
 		void Clear(void);
 
 	private:
+		void sprite_mask(unsigned char line, unsigned int x, uint64_t* mask) const;
+		void updated(void);
+
 		CHIP8::EMULATION_MODE			mMode;
 		unsigned int					mWidth;
 		unsigned int					mHeight;
-		std::vector<std::vector<bool>>	mDsp;
+		Chip8Frame						mFrame;			///< The display contents.
+		Chip8Recorder*					mRecorder;		///< Optional recorder for completed frames.
+		Chip8DrawStats					mStats;			///< Per-pixel and per-frame draw counters.
+		std::atomic<int>				mBacklog;		///< Queued DrawSprite/Clear signals.
+		uint64_t						mUpdates;		///< Sent DrawSprite/Clear signals (the receiver counts the same way).
+		bool							mFramesOnly;	///< Draws are not sent, see \ref frames_only().
+		bool							mSpeculating;	///< Drawing a run-ahead frame.
+		int64_t							mKeyNs;			///< Key event of the key waiting for a display update (0: none).
+		int64_t							mSeenNs;		///< Time the program read that key.
+		Chip8Latency					mLatency;		///< Key latency histograms.
 };
 
 #endif // CHIP8DISPLAY_H
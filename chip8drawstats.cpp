@@ -0,0 +1,137 @@
+#include "chip8drawstats.h"
+
+/**
+	Constructor, counting is off until \ref enable() is called.
+*/
+Chip8DrawStats::Chip8DrawStats()
+: enabled(false)
+{
+	reset();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Clears all counters. Only safe while counting is off or from the emulator thread.
+*/
+void Chip8DrawStats::reset(void)
+{
+	for(unsigned int k = 0; k < PLANES; ++k){
+		for(unsigned int y = 0; y < Chip8Frame::MAX_HEIGHT; ++y){
+			for(unsigned int w = 0; w < Chip8Frame::WORDS; ++w){
+				flipPlanes[k][y][w].store(0, std::memory_order_relaxed);
+				hitPlanes[k][y][w].store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+	curDraws.store(0, std::memory_order_relaxed);
+	curPixels.store(0, std::memory_order_relaxed);
+	lastDraws.store(0, std::memory_order_relaxed);
+	lastPixels.store(0, std::memory_order_relaxed);
+	totalDraws.store(0, std::memory_order_relaxed);
+	totalPixels.store(0, std::memory_order_relaxed);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Adds one to the counters of all pixels set in mask. The mask is added to
+	plane 0, the carry (pixels whose bit was already set) moves on to plane 1
+	and so on until no carry is left.
+
+	\param	[in]	planes	The bit planes of the counters.
+	\param	[in]	y		Display row.
+	\param	[in]	mask	Pixels to count (\ref Chip8Frame::WORDS words).
+*/
+void Chip8DrawStats::increment(Plane* planes, unsigned int y, uint64_t const* mask)
+{
+	for(unsigned int w = 0; w < Chip8Frame::WORDS; ++w){
+		uint64_t carry = mask[w];
+		for(unsigned int k = 0; carry && (k < PLANES); ++k){
+			uint64_t bits = planes[k][y][w].load(std::memory_order_relaxed);
+			planes[k][y][w].store(bits ^ carry, std::memory_order_relaxed);
+			carry &= bits;
+		}
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Counts one sprite row. Called from the emulator thread only.
+
+	\param	[in]	y			Display row.
+	\param	[in]	flipped		Pixels that were flipped.
+	\param	[in]	collided	Pixels that were switched off (subset of flipped).
+*/
+void Chip8DrawStats::add_row(unsigned int y, uint64_t const* flipped, uint64_t const* collided)
+{
+	uint32_t pixels = 0;
+
+	increment(flipPlanes, y, flipped);
+	increment(hitPlanes, y, collided);
+	for(unsigned int w = 0; w < Chip8Frame::WORDS; ++w){
+		pixels += __builtin_popcountll(flipped[w]);
+	}
+	bump(curPixels, pixels);
+	totalPixels.store(totalPixels.load(std::memory_order_relaxed) + pixels, std::memory_order_relaxed);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Counts one sprite draw call. Called from the emulator thread only.
+*/
+void Chip8DrawStats::add_draw(void)
+{
+	bump(curDraws, 1);
+	totalDraws.store(totalDraws.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Publishes the per-frame counters of the frame that just ended.
+*/
+void Chip8DrawStats::end_frame(void)
+{
+	lastDraws.store(curDraws.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	lastPixels.store(curPixels.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	curDraws.store(0, std::memory_order_relaxed);
+	curPixels.store(0, std::memory_order_relaxed);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Converts bit planes back into one counter per pixel (row-major).
+*/
+void Chip8DrawStats::gather(Plane const* planes, unsigned int width, unsigned int height, std::vector<uint32_t>& counters)
+{
+	counters.assign(width * height, 0);
+	for(unsigned int k = 0; k < PLANES; ++k){
+		for(unsigned int y = 0; y < height; ++y){
+			for(unsigned int w = 0; w < Chip8Frame::WORDS; ++w){
+				uint64_t bits = planes[k][y][w].load(std::memory_order_relaxed);
+				while(bits){
+					unsigned int x = w*64 + __builtin_clzll(bits);		// MSB is the leftmost pixel
+					bits &= ~(0x8000000000000000ull >> (x & 63));
+					if(x < width){
+						counters[y*width + x] |= 1u << k;
+					}
+				}
+			}
+		}
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Reads the counters of all pixels. Can be called from any thread, a counter
+	that is incremented at the same time may be off for this read.
+
+	\param	[in]	width		Display width.
+	\param	[in]	height		Display height.
+	\param	[out]	flips		Flip count per pixel (row-major).
+	\param	[out]	collisions	Collision count per pixel (row-major).
+*/
+void Chip8DrawStats::heatmap(unsigned int width, unsigned int height, std::vector<uint32_t>& flips, std::vector<uint32_t>& collisions) const
+{
+	gather(flipPlanes, width, height, flips);
+	gather(hitPlanes, width, height, collisions);
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,62 @@
+#ifndef CHIP8DRAWSTATS_H
+#define CHIP8DRAWSTATS_H
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+#include "chip8frame.h"
+
+/**
+	Instrumentation of \ref Chip8Display::draw_sprite().
+
+	Counts per pixel how often it was flipped and how often it collided, and per
+	frame how many sprites were drawn and how many pixels they touched.
+
+	The per-pixel counters are bit-sliced: plane k holds bit k of the counters of
+	a whole display row, so one sprite row increments all its pixel counters with
+	a few word operations (a binary ripple-carry over the planes, two planes on
+	average). The emulator thread is the only writer, readers in other threads
+	use \ref heatmap() and the frame counters.
+*/
+class Chip8DrawStats
+{
+	public:
+		enum STATS_SIZE {
+			PLANES	= 32		///< Bits per pixel counter.
+		};
+
+		Chip8DrawStats();
+		void	enable(bool on)		{enabled.store(on, std::memory_order_relaxed);}		///< Switch counting on or off.
+		bool	active(void) const	{return enabled.load(std::memory_order_relaxed);}	///< Indicates whether counting is on.
+		void	reset(void);															///< Clear all counters.
+
+		void	add_row(unsigned int y, uint64_t const* flipped, uint64_t const* collided);	///< Count one drawn sprite row.
+		void	add_draw(void);																///< Count one sprite draw call.
+		void	end_frame(void);															///< Close the per-frame counters.
+
+		void		heatmap(unsigned int width, unsigned int height, std::vector<uint32_t>& flips, std::vector<uint32_t>& collisions) const;	///< Read all pixel counters.
+		uint32_t	frame_draws(void) const		{return lastDraws.load(std::memory_order_relaxed);}		///< Sprite draws in the last frame.
+		uint32_t	frame_pixels(void) const	{return lastPixels.load(std::memory_order_relaxed);}	///< Pixels touched in the last frame.
+		uint64_t	total_draws(void) const		{return totalDraws.load(std::memory_order_relaxed);}	///< Sprite draws since the last reset.
+		uint64_t	total_pixels(void) const	{return totalPixels.load(std::memory_order_relaxed);}	///< Pixels touched since the last reset.
+
+	private:
+		typedef std::atomic<uint64_t> Plane[Chip8Frame::MAX_HEIGHT][Chip8Frame::WORDS];
+
+		static void increment(Plane* planes, unsigned int y, uint64_t const* mask);
+		static void gather(Plane const* planes, unsigned int width, unsigned int height, std::vector<uint32_t>& counters);
+		static void bump(std::atomic<uint32_t>& counter, uint32_t value) {counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);}
+
+		std::atomic<bool>		enabled;				///< Counting is on.
+		Plane					flipPlanes[PLANES];		///< Bit-sliced flip counters.
+		Plane					hitPlanes[PLANES];		///< Bit-sliced collision counters.
+		std::atomic<uint32_t>	curDraws;				///< Sprite draws in the current frame.
+		std::atomic<uint32_t>	curPixels;				///< Pixels touched in the current frame.
+		std::atomic<uint32_t>	lastDraws;				///< Sprite draws in the last completed frame.
+		std::atomic<uint32_t>	lastPixels;				///< Pixels touched in the last completed frame.
+		std::atomic<uint64_t>	totalDraws;				///< Sprite draws since the last reset.
+		std::atomic<uint64_t>	totalPixels;			///< Pixels touched since the last reset.
+};
+
+#endif // CHIP8DRAWSTATS_H
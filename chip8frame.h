@@ -0,0 +1,35 @@
+#ifndef CHIP8FRAME_H
+#define CHIP8FRAME_H
+
+#include <cstring>
+#include <cstdint>
+
+/**
+	A complete CHIP8 framebuffer as packed bitmap. Every display row is stored
+	as two 64-bit words (128 pixel, enough for the S-CHIP8 resolution), the
+	leftmost pixel is the most significant bit of the first word.
+
+	The frame is a plain value type, so it can be copied into queues and passed
+	through queued signal connections cheaply.
+*/
+struct Chip8Frame
+{
+	enum FRAME_SIZE {
+		MAX_WIDTH	= 128,				///< Widest supported display (S-CHIP8).
+		MAX_HEIGHT	= 64,				///< Highest supported display (S-CHIP8).
+		WORDS		= MAX_WIDTH / 64	///< 64-bit words per row.
+	};
+
+	uint64_t		number;						///< Number of the emulated 60Hz frame.
+	unsigned int	width;						///< Logical X-resolution.
+	unsigned int	height;						///< Logical Y-resolution.
+	uint64_t		rows[MAX_HEIGHT][WORDS];	///< The pixels.
+
+	Chip8Frame(unsigned int aWidth = 64, unsigned int aHeight = 32) : number(0), width(aWidth), height(aHeight) {clear();}
+	void clear(void)								{memset(rows, 0, sizeof(rows));}
+	bool pixel(unsigned int x, unsigned int y) const	{return (rows[y][x >> 6] >> (63 - (x & 63))) & 1;}
+	bool operator==(Chip8Frame const& other) const	{return (width == other.width) && (height == other.height) && (0 == memcmp(rows, other.rows, sizeof(rows)));}
+	bool operator!=(Chip8Frame const& other) const	{return !(*this == other);}
+};
+
+#endif // CHIP8FRAME_H
@@ -0,0 +1,73 @@
+#include <QPainter>
+
+#include "chip8frameitem.h"
+#include "chip8profiler.h"
+
+/**
+	Constructor, all pixels are off.
+
+	\param	[in]	rect	Area of the CHIP8 display in the scene.
+	\param	[in]	width	X-resolution of the CHIP8 display.
+	\param	[in]	height	Y-resolution of the CHIP8 display.
+*/
+Chip8FrameItem::Chip8FrameItem(QRectF rect, unsigned int width, unsigned int height)
+: area(rect), image(static_cast<int>(width), static_cast<int>(height), QImage::Format_Grayscale8)
+{
+	image.fill(Qt::white);
+	setPos(rect.x(), rect.y());
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Default destructor.
+*/
+Chip8FrameItem::~Chip8FrameItem()
+{
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Copies the display contents into the image (black pixels on white, like
+	the original pixel items). Frames of another resolution are ignored.
+*/
+void Chip8FrameItem::set_frame(Chip8Frame const& frame)
+{
+	if((static_cast<int>(frame.width) != image.width()) || (static_cast<int>(frame.height) != image.height())){
+		return;
+	}
+	for(unsigned int y = 0; y < frame.height; ++y){
+		uchar* line = image.scanLine(static_cast<int>(y));
+		for(unsigned int x = 0; x < frame.width; ++x){
+			line[x] = frame.pixel(x, y) ? 0x00 : 0xff;
+		}
+	}
+	update();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	The item covers the whole display area.
+*/
+QRectF Chip8FrameItem::boundingRect() const
+{
+	return QRectF(0, 0, area.width(), area.height());
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Draws the image scaled to the display area (nearest neighbour, the pixels
+	stay sharp).
+
+	\param	[in]	painter	Painter object.
+	\param	[in]	option	Not used.
+	\param	[in]	widget	Not used.
+*/
+void Chip8FrameItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+	Q_UNUSED(option)
+	Q_UNUSED(widget)
+
+	CHIP8_PROFILE("paint_scene");
+	painter->drawImage(boundingRect(), image);
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,29 @@
+#ifndef CHIP8FRAMEITEM_H
+#define CHIP8FRAMEITEM_H
+
+#include <QGraphicsItem>
+#include <QImage>
+
+#include "chip8frame.h"
+
+/**
+	The CHIP8 display as a single scene item. The display is kept as an image
+	with one pixel per CHIP8 pixel and scaled up when painted, which replaces
+	one item per CHIP8 pixel (2048, or 8192 for the S-CHIP8).
+*/
+class Chip8FrameItem : public QGraphicsItem
+{
+public:
+	Chip8FrameItem(QRectF rect, unsigned int width, unsigned int height);
+	~Chip8FrameItem() override;
+	void	set_frame(Chip8Frame const& frame);		///< Take over new display contents.
+
+	QRectF	boundingRect() const override;
+	void 	paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+private:
+	QRectF	area;			///< Position and size of the CHIP8 display in the scene.
+	QImage	image;			///< One image pixel per CHIP8 pixel.
+};
+
+#endif // CHIP8FRAMEITEM_H
@@ -1,27 +1,39 @@
 #include "chip8graphicsview.h"
 #include "chip8display.h"
-#include "mainwindow.h"
+#include "chip8profiler.h"
+#include "chip8metrics.h"
 
 /**
 	The constructor for our QtGraphicsView interface to draw the CHIP8 display.
 	This object runs in the main-application context and reacts to signals from the
 	emulator object that runs in its own thread.
 
+	Sprite draws only update a copy of the display, the scene is changed at most
+	once per 60Hz refresh, so a program that draws faster than the screen can
+	show doesn't flood the event loop with scene updates.
+
 	\param	[in]	aWidth	X-resolution of the CHIP8 display.
 	\param	[in]	aHeight	Y-resolution of the CHIP8 display.
 	\param	[in]	aGv		Pointer to the QtGraphicsView object that was created by QtCreator.
+	\param	[in]	aDsp	The emulator display to show.
 	\param	[in]	parent	Pointer to the main-window object (Chip8MainWindow)
 */
-Chip8GraphicsView::Chip8GraphicsView(unsigned int aWidth, unsigned int aHeight, QGraphicsView* aGv, QObject* parent)
-: QObject(parent), gv(aGv), width(aWidth), height(aHeight)
+Chip8GraphicsView::Chip8GraphicsView(unsigned int aWidth, unsigned int aHeight, QGraphicsView* aGv, Chip8Display* aDsp, QObject* parent)
+: QObject(parent), gv(aGv), width(aWidth), height(aHeight), screen(nullptr), dsp(aDsp), dirty(false), firstShown(false), receivedUpdates(0), presentedFrames(0), heatmap(nullptr)
 {
 	gs = new QGraphicsScene(parent);				// initialize our graphicsView
 	gv->setScene(gs);
 	Resize(aWidth, aHeight);						//
 
-	connect(dynamic_cast<Chip8MainWindow*>(parent)->get_emu()->display(), &Chip8Display::DrawSprite,	this, &Chip8GraphicsView::DrawSprite);	// receive signal from emulator display to draw a sprite
-	connect(dynamic_cast<Chip8MainWindow*>(parent)->get_emu()->display(), &Chip8Display::Clear,			this, &Chip8GraphicsView::Clear);		// receive signal from emulator display to clear the screen
-	connect(dynamic_cast<Chip8MainWindow*>(parent)->get_emu()->display(), &Chip8Display::Resize,		this, &Chip8GraphicsView::Resize);		// receive signal from emulator display to switch the display resolution
+	connect(dsp, &Chip8Display::DrawSprite,	this, &Chip8GraphicsView::DrawSprite);	// receive signal from emulator display to draw a sprite
+	connect(dsp, &Chip8Display::Clear,			this, &Chip8GraphicsView::Clear);		// receive signal from emulator display to clear the screen
+	connect(dsp, &Chip8Display::Resize,		this, &Chip8GraphicsView::Resize);		// receive signal from emulator display to switch the display resolution
+
+	stats = dsp->stats();
+	heatmapTimer.setInterval(100);					// the heatmap doesn't need the full frame rate
+	connect(&heatmapTimer, &QTimer::timeout, this, &Chip8GraphicsView::UpdateHeatmap);
+	connect(&presentTimer, &QTimer::timeout, this, &Chip8GraphicsView::Present);
+	presentTimer.start(16);
 }
 //-----------------------------------------------------------------------------
 
@@ -30,6 +42,9 @@ Chip8GraphicsView::Chip8GraphicsView(unsigned int aWidth, unsigned int aHeight,
 */
 Chip8GraphicsView::~Chip8GraphicsView()
 {
+	presentTimer.stop();
+	heatmapTimer.stop();
+	stats->enable(false);
 	delete gs;
 }
 //-----------------------------------------------------------------------------
@@ -45,22 +60,21 @@ void Chip8GraphicsView::Resize(unsigned int aWidth, unsigned int aHeight)
 	width	= aWidth;
 	height	= aHeight;
 
-	gv->scene()->clear();																// delete all pixels in current scene
+	gv->scene()->clear();																// delete the display (and the heatmap) in current scene
 
-	display.clear();																	// remove all buffered pointer to the pixels
-	display.resize(aWidth);																// set up a new pixel buffer with new width...
-	for(unsigned int i = 0; i < display.size(); ++i){									// .. and height
-		display[i].resize(aHeight);
-	}
+	pending.width	= width;
+	pending.height	= height;
+	pending.clear();
+	dirty			= false;															// the new pixels are all off already
 
 	unsigned int pixel_width	= static_cast<unsigned int>(gv->width()) / width;		// re-compute the physical size of a pixel on sceen ...
 	unsigned int pixel_height	= static_cast<unsigned int>(gv->height()) / height;		// ... (depending on the actual window size)
-	for(unsigned int x = 0; x < width; ++x){											// create width x height new pixel
-		for(unsigned int y = 0; y < height; ++y){
-			Chip8PixelItem* pixel =  new Chip8PixelItem(QRectF(x*pixel_width, y*pixel_height, pixel_width, pixel_height));
-			gv->scene()->addItem(pixel);												// add pixel to the scene ...
-			display[x][y] = pixel;														// and our pixel-buffer
-		}
+	screen = new Chip8FrameItem(QRectF(-(pixel_width/2.0), -(pixel_height/2.0), width*pixel_width, height*pixel_height), width, height);
+	gv->scene()->addItem(screen);														// one item for the whole display
+
+	if(heatmap){																		// the old overlay was deleted with the scene
+		heatmap = new Chip8HeatmapItem(QRectF(-(pixel_width/2.0), -(pixel_height/2.0), width*pixel_width, height*pixel_height));
+		gv->scene()->addItem(heatmap);
 	}
 }
 //-----------------------------------------------------------------------------
@@ -70,39 +84,133 @@ void Chip8GraphicsView::Resize(unsigned int aWidth, unsigned int aHeight)
 */
 void Chip8GraphicsView::Clear(void)
 {
-	for(unsigned int x = 0; x < width; ++x){		// loop over all pixel ...
-		for(unsigned int y = 0; y < height; ++y){
-			display[x][y]->off();					// .. and switch them off
-		}
-	}
+	CHIP8_PROFILE("Clear");
+	dsp->delivered();
+	Chip8PerfCounters::add(receivedUpdates, 1);
+	pending.clear();
+	dirty = true;
 }
 //-----------------------------------------------------------------------------
 
 /**
 	Public slot that receives the \ref DrawSprite signal from the emulator display class.
+	We only keep the display contents, drawing happens in \ref Present().
+
+	\param	[in]	frame	The display that is to be drawn.
+	\param	[in]	xs		Not used.
+	\param	[in]	ys		Not used.
+	\param	[in]	size	Not used.
+*/
+void Chip8GraphicsView::DrawSprite(Chip8Frame const& frame, unsigned int xs, unsigned int ys, unsigned int size)
+{
+	Q_UNUSED(xs)
+	Q_UNUSED(ys)
+	Q_UNUSED(size)
+
+	CHIP8_PROFILE("DrawSprite");
+	dsp->delivered();
+	Chip8PerfCounters::add(receivedUpdates, 1);
+	if(frame.width == width){								// drop frames from before a resolution change
+		pending	= frame;
+		dirty	= true;
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Timer slot that brings the display item up to date with the latest display
+	contents. All draws since the last refresh are shown at once.
+*/
+void Chip8GraphicsView::Present(void)
+{
+	if(!dirty){
+		return;
+	}
+	CHIP8_PROFILE("Present");
+	dirty = false;
+
+	screen->set_frame(pending);
+	Chip8PerfCounters::add(presentedFrames, 1);
+	dsp->latency().presented(receivedUpdates.load(std::memory_order_relaxed));				// a key waiting for this update is on screen now
+	if(!firstShown){										// first picture of the program: startup is over
+		firstShown = true;
+		emit FirstFrame();
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Registers the presentation counters in a metrics registry. Display
+	updates that arrive between two refreshes are shown together, they
+	count as coalesced.
+
+	\param	[in]	metrics	The registry, must not outlive the view.
+*/
+void Chip8GraphicsView::register_metrics(Chip8Metrics& metrics)
+{
+	metrics.counter("chip8_display_updates_total", "DrawSprite/Clear signals handled by the view.", [this]{return received_updates();});
+	metrics.counter("chip8_frames_presented_total", "Display states shown by the view.", [this]{return presented_frames();});
+	metrics.counter("chip8_display_updates_coalesced_total", "Display updates shown together with later ones.", [this]{
+		uint64_t presented	= presented_frames();
+		uint64_t received	= received_updates();
+		return (received > presented) ? received - presented : 0;
+	});
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Public slot to switch the draw heatmap on or off. The draw counters in the
+	emulator display are only active while the heatmap is shown.
+
+	\param	[in]	on	true to show the heatmap.
+*/
+void Chip8GraphicsView::ShowHeatmap(bool on)
+{
+	if(on == (nullptr != heatmap)){
+		return;
+	}
+	if(on){
+		unsigned int pixel_width	= static_cast<unsigned int>(gv->width()) / width;
+		unsigned int pixel_height	= static_cast<unsigned int>(gv->height()) / height;
+		heatmap = new Chip8HeatmapItem(QRectF(-(pixel_width/2.0), -(pixel_height/2.0), width*pixel_width, height*pixel_height));
+		gv->scene()->addItem(heatmap);
+		stats->enable(true);
+		heatmapTimer.start();
+	} else {
+		heatmapTimer.stop();
+		stats->enable(false);
+		gv->scene()->removeItem(heatmap);
+		delete heatmap;
+		heatmap = nullptr;
+		gs->update();
+	}
+}
+//-----------------------------------------------------------------------------
 
-	\param	[in]	dsp	The display that is to be drawn.
-	\param	[in]	xs		X-psition of the sprite.
-	\param	[in]	ys		Y-psition of the sprite.
-	\param	[in]	size	Size of the sprite (i.e. the number of lines. The size in X-direction is always 8).
+/**
+	Public slot that clears the draw counters. Draws that happen in the emulator
+	thread at the same moment may survive the reset.
+*/
+void Chip8GraphicsView::ResetHeatmap(void)
+{
+	stats->reset();
+	if(heatmap){
+		UpdateHeatmap();
+	}
+}
+//-----------------------------------------------------------------------------
 
-	NOTE: Right now the method only works for the CHIP8 Classic and not the SuperCHIP !
+/**
+	Private slot, called by the heatmap timer. Reads the draw counters and
+	rebuilds the overlay.
 */
-void Chip8GraphicsView::DrawSprite(std::vector<std::vector<bool>> dsp, unsigned int xs, unsigned int ys, unsigned int size)
+void Chip8GraphicsView::UpdateHeatmap(void)
 {
-	for(unsigned int x = xs; x < xs+8; ++x){				// all sprites are 8 pixel wide
-		unsigned int xm = x % width;						// wrap around at right edge of display
-		for(unsigned int y = ys; y < ys+size; ++y){
-			unsigned int ym = y % height;					// wrap around at bottom edge of display
-			if(dsp[xm][ym] == display[xm][ym]->state()){
-				continue;									// pixel didn't change -> don't bother
-			} else if(true == dsp[xm][ym]){					// draw pixel
-				display[xm][ym]->on();
-			} else {
-				display[xm][ym]->off();
-			}
-		}
+	if(nullptr == heatmap){
+		return;
 	}
-	gs->update();											// actually show the changes
+	stats->heatmap(width, height, flips, collisions);
+	heatmap->set_counters(width, height, flips, collisions);
+	emit FrameStats(stats->frame_draws(), stats->frame_pixels());
 }
 //-----------------------------------------------------------------------------
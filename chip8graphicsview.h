@@ -3,22 +3,41 @@
 
 #include <QObject>
 #include <QGraphicsView>
-#include "chip8pixelitem.h"
+#include <QTimer>
+#include "chip8frameitem.h"
+#include "chip8heatmapitem.h"
+#include "chip8frame.h"
+#include "chip8perf.h"
+
+class Chip8DrawStats;
+class Chip8Display;
+class Chip8Metrics;
 
 class Chip8GraphicsView : public QObject
 {
 	Q_OBJECT
 
 	public:
-		explicit Chip8GraphicsView(unsigned int aWidth, unsigned int aHeight, QGraphicsView* aGv, QObject *parent = nullptr);	///< Constructor
+		explicit Chip8GraphicsView(unsigned int aWidth, unsigned int aHeight, QGraphicsView* aGv, Chip8Display* aDsp, QObject *parent = nullptr);	///< Constructor
 		~Chip8GraphicsView();																									///< Destructor
+		uint64_t	received_updates(void) const	{return receivedUpdates.load(std::memory_order_relaxed);}		///< DrawSprite/Clear signals handled so far.
+		uint64_t	presented_frames(void) const	{return presentedFrames.load(std::memory_order_relaxed);}		///< Changed display states actually shown so far.
+		void		register_metrics(Chip8Metrics& metrics);	///< Export the presentation counters.
 
 	signals:
+		void FrameStats(unsigned int draws, unsigned int pixels);												///< Sprite draws and touched pixels of the last frame (heatmap only).
+		void FirstFrame(void);																						///< The first display contents were shown.
 
 	public slots:
 		void Resize(unsigned int width, unsigned int heigt);														///< Changed display resolution.
 		void Clear(void);																							///< Clear the display.
-		void DrawSprite(std::vector<std::vector<bool>> dsp, unsigned int x, unsigned int y, unsigned int size);		///< Draw a sprite.
+		void DrawSprite(Chip8Frame const& frame, unsigned int x, unsigned int y, unsigned int size);					///< Draw a sprite.
+		void ShowHeatmap(bool on);																					///< Switch the draw heatmap overlay on or off.
+		void ResetHeatmap(void);																					///< Clear the draw counters.
+		void Present(void);																							///< Show the latest display contents.
+
+	private slots:
+		void UpdateHeatmap(void);																					///< Refresh the overlay from the draw counters.
 
 	private:
 		QGraphicsView*								gv;			///< The QtGraphicsView that display the CHIP8 display.
@@ -26,7 +45,19 @@ class Chip8GraphicsView : public QObject
 //		QPainter									painter;	///< Painter that does the drawing.
 		unsigned int								width;		///< Logical X-resolution of the CHIP8 display.
 		unsigned int								height;		///< Logical Y-resolution of the CHIP8 display.
-		std::vector<std::vector<Chip8PixelItem*>>	display;	///< Local pixel buffer for faster access to items in scene.
+		Chip8FrameItem*								screen;		///< The display in the scene.
+		Chip8Display*								dsp;		///< The emulator display we show.
+		Chip8Frame									pending;	///< Latest display contents, shown by \ref Present().
+		bool										dirty;		///< pending changed since the last \ref Present().
+		bool										firstShown;	///< \ref FirstFrame() was emitted.
+		QTimer										presentTimer;	///< 60Hz refresh timer.
+		std::atomic<uint64_t>						receivedUpdates;	///< DrawSprite/Clear signals handled (read by the metrics).
+		std::atomic<uint64_t>						presentedFrames;	///< Calls of \ref Present() that changed the scene.
+		Chip8DrawStats*								stats;		///< Draw counters of the emulator display.
+		Chip8HeatmapItem*							heatmap;	///< Heatmap overlay (nullptr when switched off).
+		QTimer										heatmapTimer;	///< Refreshes the overlay.
+		std::vector<uint32_t>						flips;		///< Buffer for the flip counters.
+		std::vector<uint32_t>						collisions;	///< Buffer for the collision counters.
 };
 
 #endif // CHIP8GRAPHICSVIEW_H
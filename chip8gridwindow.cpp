@@ -0,0 +1,240 @@
+#include <QPainter>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QAction>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QDir>
+#include <cmath>
+
+#include "chip8gridwindow.h"
+#include "chip8display.h"
+
+/**
+	Constructor, the grid starts empty.
+*/
+Chip8GridWindow::Chip8GridWindow(QWidget* parent)
+: QWidget(parent, Qt::Window), focus(-1), cols(0), rows(0)
+{
+	setWindowTitle(tr("CHIP8 grid"));
+	resize(800, 480);
+	setFocusPolicy(Qt::StrongFocus);
+	setContextMenuPolicy(Qt::ActionsContextMenu);
+
+	QAction* addClassic	= new QAction(tr("Add CHIP8 program..."), this);
+	QAction* addSuper	= new QAction(tr("Add S-CHIP8 program..."), this);
+	QAction* remove		= new QAction(tr("Remove focused instance"), this);
+	connect(addClassic,	&QAction::triggered, this, &Chip8GridWindow::AddClassic);
+	connect(addSuper,	&QAction::triggered, this, &Chip8GridWindow::AddSuper);
+	connect(remove,		&QAction::triggered, this, &Chip8GridWindow::RemoveFocused);
+	addAction(addClassic);
+	addAction(addSuper);
+	addAction(remove);
+
+	connect(&timer, &QTimer::timeout, this, &Chip8GridWindow::Tick);
+	timer.start(16);
+	layout_grid();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Destructor. The pool finishes the queued frames before the instances are
+	deleted (member order).
+*/
+Chip8GridWindow::~Chip8GridWindow()
+{
+	timer.stop();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Loads a program into a new instance and starts it with the next tick.
+
+	\param	[in]	filename	The program file.
+	\param	[in]	mode		Emulation mode of the instance.
+	\return	false if the program couldn't be read.
+*/
+bool Chip8GridWindow::add(QString const& filename, CHIP8::EMULATION_MODE mode)
+{
+	std::unique_ptr<Tile> tile(new Tile(QFileInfo(filename).completeBaseName()));
+
+	tile->emu.mode(mode);
+	tile->emu.display()->frames_only(true);				// the grid reads the frames, nobody receives (and drains) DrawSprite/Clear
+	if(tile->emu.load_file(filename.toStdString(), CHIP8::MAP_RAM_START)){
+		return false;
+	}
+	tile->emu.set_address(CHIP8::MAP_RAM_START);
+	tiles.push_back(std::move(tile));
+	focus = static_cast<int>(tiles.size()) - 1;			// new instances get the keys
+	layout_grid();
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Asks for a program and adds it.
+*/
+void Chip8GridWindow::ask_program(CHIP8::EMULATION_MODE mode)
+{
+	QString filename = QFileDialog::getOpenFileName(this, tr("Open Chip8 Program"), QDir::homePath(), tr("Chip8 Programs (*.ch8)"));
+	if(!filename.isEmpty()){
+		add(filename, mode);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Public slot of the context menu.
+*/
+void Chip8GridWindow::AddClassic(void)
+{
+	ask_program(CHIP8::MODE_CLASSIC);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Public slot of the context menu.
+*/
+void Chip8GridWindow::AddSuper(void)
+{
+	ask_program(CHIP8::MODE_SUPER);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Public slot of the context menu. Waits for a running frame of the instance
+	(a few microseconds), new frames are only queued by \ref Tick() in this thread.
+*/
+void Chip8GridWindow::RemoveFocused(void)
+{
+	if((focus < 0) || (focus >= static_cast<int>(tiles.size()))){
+		return;
+	}
+	while(tiles[focus]->busy.load(std::memory_order_acquire)){
+		std::this_thread::yield();
+	}
+	tiles.erase(tiles.begin() + focus);
+	focus = tiles.empty() ? -1 : std::min(focus, static_cast<int>(tiles.size()) - 1);
+	layout_grid();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Computes the grid (as square as possible) and allocates the atlas.
+*/
+void Chip8GridWindow::layout_grid(void)
+{
+	unsigned int n = static_cast<unsigned int>(tiles.size());
+
+	cols	= n ? static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<double>(n)))) : 1;
+	rows	= n ? (n + cols - 1) / cols : 1;
+	atlas	= QImage(static_cast<int>(cols * Chip8Frame::MAX_WIDTH), static_cast<int>(rows * Chip8Frame::MAX_HEIGHT), QImage::Format_Grayscale8);
+	atlas.fill(0);
+	update();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Timer slot, queues one frame of every instance that isn't still busy with
+	the last one and schedules a repaint.
+*/
+void Chip8GridWindow::Tick(void)
+{
+	for(std::unique_ptr<Tile>& t : tiles){
+		if(t->busy.exchange(true, std::memory_order_acquire)){
+			continue;										// still running the last frame: skip this tick
+		}
+		Tile* tile = t.get();
+		pool.submit([tile]{
+			tile->emu.run_frame(PER_FRAME);
+			tile->frame.store(tile->emu.display()->frame());
+			tile->busy.store(false, std::memory_order_release);
+		});
+	}
+	if(!tiles.empty()){
+		update();
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Copies the displays of all instances into the atlas (scaled to the cell
+	size, so CHIP8 and S-CHIP8 tiles are the same size) and draws it at once.
+*/
+void Chip8GridWindow::paintEvent(QPaintEvent* event)
+{
+	Q_UNUSED(event)
+
+	for(unsigned int i = 0; i < tiles.size(); ++i){
+		if(!tiles[i]->frame.load(scratch) || (0 == scratch.width) || (0 == scratch.height)){
+			continue;										// the worker is just writing: keep the old contents
+		}
+		unsigned int sx = Chip8Frame::MAX_WIDTH / scratch.width;
+		unsigned int sy = Chip8Frame::MAX_HEIGHT / scratch.height;
+		unsigned int x0 = (i % cols) * Chip8Frame::MAX_WIDTH;
+		unsigned int y0 = (i / cols) * Chip8Frame::MAX_HEIGHT;
+		for(unsigned int y = 0; y < Chip8Frame::MAX_HEIGHT; ++y){
+			uchar* line = atlas.scanLine(static_cast<int>(y0 + y)) + x0;
+			for(unsigned int x = 0; x < Chip8Frame::MAX_WIDTH; ++x){
+				line[x] = scratch.pixel(x / sx, y / sy) ? 0xff : 0x00;
+			}
+		}
+	}
+
+	QPainter painter(this);
+	painter.fillRect(rect(), Qt::black);
+	int scale	= std::max(1, std::min(width() / atlas.width(), height() / atlas.height()));
+	target		= QRect((width() - atlas.width()*scale) / 2, (height() - atlas.height()*scale) / 2, atlas.width()*scale, atlas.height()*scale);
+	painter.drawImage(target, atlas);
+
+	if(focus >= 0){													// frame the tile with the keys
+		int cw = Chip8Frame::MAX_WIDTH * scale;
+		int ch = Chip8Frame::MAX_HEIGHT * scale;
+		painter.setPen(Qt::red);
+		painter.drawRect(target.x() + (focus % static_cast<int>(cols))*cw, target.y() + (focus / static_cast<int>(cols))*ch, cw - 1, ch - 1);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Hands key presses to the tile with the focus.
+*/
+void Chip8GridWindow::keyPressEvent(QKeyEvent* event)
+{
+	if((focus >= 0) && !event->isAutoRepeat()){
+		tiles[focus]->keys.press(event->key());
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Hands key releases to the tile with the focus.
+*/
+void Chip8GridWindow::keyReleaseEvent(QKeyEvent* event)
+{
+	if((focus >= 0) && !event->isAutoRepeat()){
+		tiles[focus]->keys.release(event->key());
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	A click gives the tile under the mouse the input focus.
+*/
+void Chip8GridWindow::mousePressEvent(QMouseEvent* event)
+{
+	if(!target.contains(event->pos()) || (0 == target.width())){
+		return;
+	}
+	int col		= (event->pos().x() - target.x()) * static_cast<int>(cols) / target.width();
+	int row		= (event->pos().y() - target.y()) * static_cast<int>(rows) / target.height();
+	int index	= row * static_cast<int>(cols) + col;
+	if(index < static_cast<int>(tiles.size())){
+		if(focus >= 0){
+			tiles[focus]->keys.release_all();							// don't leave a key pressed in the old tile
+		}
+		focus = index;
+		update();
+	}
+}
+//-----------------------------------------------------------------------------
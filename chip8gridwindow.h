@@ -0,0 +1,106 @@
+#ifndef CHIP8GRIDWINDOW_H
+#define CHIP8GRIDWINDOW_H
+
+#include <QWidget>
+#include <QTimer>
+#include <QImage>
+#include <QRect>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "chip8.h"
+#include "chip8frame.h"
+#include "chip8seqlock.h"
+#include "chip8keysource.h"
+#include "chip8workerpool.h"
+
+/**
+	Key source of one grid tile, fed by the grid window while the tile has the
+	input focus.
+*/
+class Chip8TileKeys : public Chip8KeySource
+{
+	public:
+		Chip8TileKeys() : key(KEY_SOURCE_NO_KEY) {}
+		int		ReadKey(void) override	{return key.load(std::memory_order_relaxed);}	///< The pressed key or \ref KEY_SOURCE_NO_KEY.
+		int		GetKey(void) override	{return ReadKey();}								///< Never blocks, tiles are frame-driven (see \ref CHIP8::run_frame()).
+		void	press(int aKey)			{key.store(aKey, std::memory_order_relaxed); KeyDown(aKey);}
+		void	release(int aKey)		{int k = aKey; key.compare_exchange_strong(k, KEY_SOURCE_NO_KEY); KeyUp(aKey);}
+		void	release_all(void)		{key.store(KEY_SOURCE_NO_KEY, std::memory_order_relaxed); AllKeysUp();}
+
+	private:
+		std::atomic<int>	key;		///< Host key code of the pressed key.
+};
+
+/**
+	Window that runs any number of independent emulators side by side, each
+	with its own program, emulation mode and keys.
+
+	The emulators don't get a thread each: a 60Hz timer queues one
+	\ref CHIP8::run_frame() per instance on a \ref Chip8WorkerPool with one
+	thread per core. An instance whose last frame is still running is skipped
+	for this tick. Each instance publishes its display in a sequence lock and
+	the window copies all of them into one image atlas per repaint, which is
+	drawn with a single call.
+
+	Programs are added and removed with the context menu, a click gives a tile
+	the input focus.
+*/
+class Chip8GridWindow : public QWidget
+{
+	Q_OBJECT
+
+	public:
+		enum GRID_TIMING {
+			PER_FRAME	= 16		///< Instructions per frame of every instance.
+		};
+
+		explicit Chip8GridWindow(QWidget* parent = nullptr);		///< Constructor
+		~Chip8GridWindow() override;								///< Destructor
+		bool add(QString const& filename, CHIP8::EMULATION_MODE mode);	///< Start a new instance.
+
+	public slots:
+		void AddClassic(void);										///< Ask for a program and run it as CHIP8.
+		void AddSuper(void);										///< Ask for a program and run it as S-CHIP8.
+		void RemoveFocused(void);									///< Stop the instance with the input focus.
+
+	private slots:
+		void Tick(void);											///< Queue the next frame of every instance.
+
+	protected:
+		void paintEvent(QPaintEvent* event) override;
+		void keyPressEvent(QKeyEvent* event) override;
+		void keyReleaseEvent(QKeyEvent* event) override;
+		void mousePressEvent(QMouseEvent* event) override;
+
+	private:
+		/**
+			One emulator instance.
+		*/
+		struct Tile {
+			explicit Tile(QString const& aName) : keyboard(&keys), emu(&keyboard), busy(false), name(aName) {}
+
+			Chip8TileKeys				keys;		///< Keys while the tile has the focus.
+			Chip8Keyboard				keyboard;	///< Key mapping for the emulator.
+			CHIP8						emu;		///< The emulator.
+			Chip8SeqLock<Chip8Frame>	frame;		///< Last completed display.
+			std::atomic<bool>			busy;		///< A frame is queued or running in the pool.
+			QString						name;		///< File name of the program.
+		};
+
+		void	ask_program(CHIP8::EMULATION_MODE mode);
+		void	layout_grid(void);
+
+		std::vector<std::unique_ptr<Tile>>	tiles;		///< The instances (must outlive pool).
+		Chip8WorkerPool						pool;		///< Runs the frames of all instances.
+		QTimer								timer;		///< 60Hz tick.
+		int									focus;		///< Index of the tile with the input focus (-1: none).
+		unsigned int						cols;		///< Tiles per atlas row.
+		unsigned int						rows;		///< Tile rows in the atlas.
+		QImage								atlas;		///< All displays, one cell of Chip8Frame::MAX_WIDTH x MAX_HEIGHT per tile.
+		QRect								target;		///< Where the atlas is drawn in the window.
+		Chip8Frame							scratch;	///< Buffer for reading a tile display.
+};
+
+#endif // CHIP8GRIDWINDOW_H
@@ -0,0 +1,79 @@
+#include <QPainter>
+#include <algorithm>
+#include <cmath>
+
+#include "chip8heatmapitem.h"
+
+/**
+	Constructor.
+
+	\param	[in]	rect	Area of the CHIP8 display in the scene.
+*/
+Chip8HeatmapItem::Chip8HeatmapItem(QRectF rect)
+: area(rect)
+{
+	setPos(rect.x(), rect.y());
+	setZValue(1);										// always above the pixels
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Default destructor.
+*/
+Chip8HeatmapItem::~Chip8HeatmapItem()
+{
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Translates the counters into the overlay image. Both vectors hold one
+	counter per pixel (row-major) as delivered by \ref Chip8DrawStats::heatmap().
+*/
+void Chip8HeatmapItem::set_counters(unsigned int width, unsigned int height, std::vector<uint32_t> const& flips, std::vector<uint32_t> const& collisions)
+{
+	uint32_t	max = 1;
+
+	for(size_t i = 0; i < flips.size(); ++i){
+		max = std::max(max, flips[i]);
+	}
+	double scale = 255.0 / std::log1p(static_cast<double>(max));
+
+	image = QImage(static_cast<int>(width), static_cast<int>(height), QImage::Format_ARGB32);
+	for(unsigned int y = 0; y < height; ++y){
+		QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(static_cast<int>(y)));
+		for(unsigned int x = 0; x < width; ++x){
+			int red		= static_cast<int>(scale * std::log1p(static_cast<double>(flips[y*width + x])));
+			int blue	= static_cast<int>(scale * std::log1p(static_cast<double>(collisions[y*width + x])));
+			line[x]		= qRgba(red, 0, blue, std::max(red, blue) * 3 / 4);
+		}
+	}
+	update();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	The overlay covers the whole display area.
+*/
+QRectF Chip8HeatmapItem::boundingRect() const
+{
+	return QRectF(0, 0, area.width(), area.height());
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Draws the overlay image scaled to the display area.
+
+	\param	[in]	painter	Painter object.
+	\param	[in]	option	Not used.
+	\param	[in]	widget	Not used.
+*/
+void Chip8HeatmapItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+	Q_UNUSED(option)
+	Q_UNUSED(widget)
+
+	if(!image.isNull()){
+		painter->drawImage(boundingRect(), image);
+	}
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,29 @@
+#ifndef CHIP8HEATMAPITEM_H
+#define CHIP8HEATMAPITEM_H
+
+#include <QGraphicsItem>
+#include <QImage>
+#include <vector>
+#include <cstdint>
+
+/**
+	Semi-transparent overlay on top of the CHIP8 pixels that shows the draw
+	counters of \ref Chip8DrawStats: red for XOR flips, blue for collisions.
+	The colour intensity is logarithmic relative to the most drawn pixel.
+*/
+class Chip8HeatmapItem : public QGraphicsItem
+{
+public:
+	Chip8HeatmapItem(QRectF rect);
+	~Chip8HeatmapItem() override;
+	void	set_counters(unsigned int width, unsigned int height, std::vector<uint32_t> const& flips, std::vector<uint32_t> const& collisions);	///< Rebuild the overlay image.
+
+	QRectF	boundingRect() const override;
+	void 	paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+private:
+	QRectF	area;			///< Position and size of the CHIP8 display in the scene.
+	QImage	image;			///< One overlay pixel per CHIP8 pixel, scaled up when painted.
+};
+
+#endif // CHIP8HEATMAPITEM_H
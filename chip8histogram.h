@@ -0,0 +1,117 @@
+#ifndef CHIP8HISTOGRAM_H
+#define CHIP8HISTOGRAM_H
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+/**
+	Lock-free histogram of durations in microseconds.
+
+	Buckets are log-linear: four buckets per power of two, so every bucket is
+	at most 25% wide and 64 buckets cover 0 - 131 ms. \ref add() is two
+	relaxed atomic increments (bucket and sum). Readers take a \ref snapshot()
+	and compute quantiles from it, the difference of two snapshots gives the
+	quantiles of that interval.
+*/
+class Chip8Histogram
+{
+	public:
+		enum HISTOGRAM_SIZE {
+			BUCKETS	= 64			///< Number of buckets.
+		};
+
+		Chip8Histogram()
+		: total(0)
+		{
+			for(unsigned int i = 0; i < BUCKETS; ++i){
+				counts[i].store(0, std::memory_order_relaxed);
+			}
+		}
+
+		/**
+			Adds one sample (any thread).
+		*/
+		void add(uint32_t us)
+		{
+			counts[bucket(us)].fetch_add(1, std::memory_order_relaxed);
+			total.fetch_add(us, std::memory_order_relaxed);
+		}
+
+		/**
+			\return Sum of all samples in microseconds.
+		*/
+		uint64_t sum(void) const
+		{
+			return total.load(std::memory_order_relaxed);
+		}
+
+		/**
+			Copies all bucket counts.
+		*/
+		void snapshot(std::vector<uint64_t>& out) const
+		{
+			out.resize(BUCKETS);
+			for(unsigned int i = 0; i < BUCKETS; ++i){
+				out[i] = counts[i].load(std::memory_order_relaxed);
+			}
+		}
+
+		/**
+			\return The bucket of a value.
+		*/
+		static unsigned int bucket(uint32_t us)
+		{
+			if(us < 4){
+				return us;
+			}
+			unsigned int p		= 31 - __builtin_clz(us);				// floor(log2(us)) >= 2
+			unsigned int idx	= (p-1)*4 + ((us >> (p-2)) & 3);
+			return (idx < BUCKETS) ? idx : BUCKETS-1;
+		}
+
+		/**
+			\return The largest value that falls into bucket idx.
+		*/
+		static uint32_t upper(unsigned int idx)
+		{
+			if(idx < 4){
+				return idx;
+			}
+			unsigned int p = idx/4 + 1;
+			return ((4u + (idx & 3)) << (p-2)) + (1u << (p-2)) - 1;
+		}
+
+		/**
+			Computes a quantile of the samples in counts, which can be a snapshot
+			or the difference of two snapshots.
+
+			\param	[in]	counts	Bucket counts.
+			\param	[in]	q		Quantile (e.g. 0.99).
+			\return Upper limit of the bucket that contains the quantile, 0 without samples.
+		*/
+		static uint32_t quantile(std::vector<uint64_t> const& counts, double q)
+		{
+			uint64_t total = 0;
+			for(uint64_t c : counts){
+				total += c;
+			}
+			if(0 == total){
+				return 0;
+			}
+			uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+			for(unsigned int i = 0; i < counts.size(); ++i){
+				if(counts[i] >= rank){
+					return upper(i);
+				}
+				rank -= counts[i];
+			}
+			return upper(BUCKETS-1);
+		}
+
+	private:
+		std::atomic<uint64_t>	counts[BUCKETS];		///< Samples per bucket.
+		std::atomic<uint64_t>	total;					///< Sum of the samples.
+};
+
+#endif // CHIP8HISTOGRAM_H
@@ -0,0 +1,106 @@
+#ifndef CHIP8HISTORY_H
+#define CHIP8HISTORY_H
+
+#include <atomic>
+#include <vector>
+#include <sys/types.h>
+
+/**
+	Ring buffer of the last executed instructions.
+
+	\ref record() is called by the emulator after every instruction. It writes
+	one 8 byte entry into a fixed array and never allocates, so the history can
+	always be on. The contents can only be read consistently while the
+	emulator is halted (see \ref CHIP8::Stepped).
+*/
+class Chip8History
+{
+	public:
+		enum HISTORY_SIZE {
+			ENTRIES		= 256,			///< Number of remembered instructions (power of 2).
+			NO_REG		= 0xff			///< The instruction didn't write a register.
+		};
+
+		/// One executed instruction.
+		struct Entry {
+			u_int16_t	pc;				///< Address of the instruction.
+			u_int16_t	op;				///< The instruction.
+			u_int8_t	reg;			///< Register written by the instruction (\ref NO_REG: none).
+			u_int8_t	value;			///< New value of that register.
+			u_int8_t	vf;				///< VF after the instruction.
+			u_int8_t	pad;
+		};
+
+		Chip8History() : count(0) {}
+
+		/**
+			Records one executed instruction (emulator thread only).
+		*/
+		void record(u_int16_t pc, u_int16_t op, u_int8_t const* V)
+		{
+			u_int64_t	n	= count.load(std::memory_order_relaxed);
+			Entry&		e	= entries[n & (ENTRIES-1)];
+			u_int8_t	reg	= destination(op);
+
+			e.pc	= pc;
+			e.op	= op;
+			e.reg	= reg;
+			e.value	= (NO_REG != reg) ? V[reg] : 0;
+			e.vf	= V[0xf];
+			count.store(n + 1, std::memory_order_release);
+		}
+
+		void		clear(void)			{count.store(0, std::memory_order_relaxed);}		///< Forget all entries.
+		u_int64_t	total(void) const	{return count.load(std::memory_order_acquire);}		///< Number of instructions recorded so far.
+		void		read(std::vector<Entry>& out) const;									///< Copy the entries, oldest first.
+
+		static u_int8_t destination(u_int16_t op);											///< Register written by an instruction.
+
+	private:
+		Entry					entries[ENTRIES];	///< The ring buffer.
+		std::atomic<u_int64_t>	count;				///< Number of recorded entries, the next one goes to count % ENTRIES.
+};
+
+/**
+	Copies the recorded entries, oldest first. Call only while the emulator
+	is halted.
+
+	\param	[out]	out		The entries.
+*/
+inline void Chip8History::read(std::vector<Entry>& out) const
+{
+	u_int64_t	n		= total();
+	u_int64_t	first	= (n > ENTRIES) ? n - ENTRIES : 0;
+
+	out.clear();
+	for(u_int64_t i = first; i < n; ++i){
+		out.push_back(entries[i & (ENTRIES-1)]);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	\return The register (0-15) an instruction writes, \ref NO_REG for none.
+			Fx65 loads V0 - Vx, x is reported.
+*/
+inline u_int8_t Chip8History::destination(u_int16_t op)
+{
+	u_int8_t	x = (op >> 8) & 0x0f;
+
+	switch(op >> 12){
+		case 0x6:
+		case 0x7:
+		case 0x8:
+		case 0xc:	return x;
+		case 0xf:	switch(op & 0xff){
+						case 0x07:
+						case 0x0a:
+						case 0x65:	return x;
+					}
+					break;
+	}
+	return NO_REG;
+}
+//-----------------------------------------------------------------------------
+
+#endif // CHIP8HISTORY_H
@@ -1,4 +1,5 @@
 #include "chip8keyboard.h"
+#include "chip8latency.h"
 
 /**
 	constructor of our abstract keyboard. The main purpose is to provide a keyboard to
@@ -6,10 +7,16 @@
 	0 to 9 and A to F. It Does so by mapping the appropriate PC-keboard key to the
 	orignal keys.  The mapping is configurable.
 
-	\param [in]	device	The actual keyboard device of QT that handles the raw keyboard events.
+	The key source reports presses and releases (\ref Press(), \ref Release()),
+	they are translated with a table of all host keys and kept as one bit per
+	CHIP8 key, so the emulator tests a key without a lookup or a lock.
+
+	\param [in]	device	The actual keyboard device that delivers the raw key events
+						(\ref KbdDevice for the main window, \ref Chip8TermInput for the terminal).
 	\return NONE
 */
-Chip8Keyboard::Chip8Keyboard(KbdDevice* device)
+Chip8Keyboard::Chip8Keyboard(Chip8KeySource* device)
+: pressed(0)
 {
 	// initialize the original keymap (ASCII char -> number)
 	keyMap['1'] = 1;
@@ -33,9 +40,15 @@ Chip8Keyboard::Chip8Keyboard(KbdDevice* device)
 	for(std::map<char,int>::iterator mapIter = keyMap.begin(); mapIter != keyMap.end(); ++mapIter){
 		reverseKeyMap[mapIter->second] = mapIter->first;
 	}
-
+	BuildTable();
+	for(int key = KEY_0; key <= KEY_F; ++key){
+		pressNs[key].store(0, std::memory_order_relaxed);
+	}
 
 	kbdDevice = device;
+	if(kbdDevice){
+		kbdDevice->Attach(this);					// receive presses and releases
+	}
 }
 //-----------------------------------------------------------------------------
 
@@ -45,26 +58,37 @@ Chip8Keyboard::Chip8Keyboard(KbdDevice* device)
 Chip8Keyboard::~Chip8Keyboard()
 {
 //	delete kbdDevice;
+	if(kbdDevice){
+		kbdDevice->Attach(nullptr);
+	}
 }
 //-----------------------------------------------------------------------------
 
 /**
 	This method is the API that is called from the emulator to read one key.
 
+	The non-blocking read returns the lowest pressed key of the key mask. The
+	blocking read waits for the next press of a mapped key, unmapped keys are
+	skipped.
+
 	\param	[in]	mode	Read mode. can be one of \ref RD_MODE_BLOCKING or \ref RD_MODE_NON_BLOCKING.
-	\return	Keyboard value between 0x00 and 0x0f. In case of mode = RD_MODE_NON_BLOCKING -1 is returned if no key was pressed.
+	\return	Keyboard value between 0x00 and 0x0f. -1 is returned if no key was pressed (non-blocking)
+			or the key source was closed (blocking).
 */
 int Chip8Keyboard::ReadKey(READ_MODE mode)
 {
-	int key = KbdDevice::KBD_DEVICE_NO_KEY;
-
 	if(RD_MODE_BLOCKING == mode){
-		key = kbdDevice->GetKey();
-	} else if(RD_MODE_NON_BLOCKING == mode){
-		key = kbdDevice->ReadKey();
+		int host	= Chip8KeySource::KEY_SOURCE_NO_KEY;
+		int key		= NO_KEY;
+		do{
+			host	= kbdDevice->GetKey();
+			key		= Translate(host);
+		} while((NO_KEY == key) && (Chip8KeySource::KEY_SOURCE_NO_KEY != host));
+		return key;
 	}
 
-	return GetKey(static_cast<char>(key));
+	uint16_t mask = Pressed();
+	return mask ? __builtin_ctz(mask) : static_cast<int>(NO_KEY);
 }
 //-----------------------------------------------------------------------------
 
@@ -76,10 +100,70 @@ int Chip8Keyboard::ReadKey(READ_MODE mode)
 */
 int Chip8Keyboard::GetKey(char key)
 {
-	if(KbdDevice::KBD_DEVICE_NO_KEY == key){
-		return KbdDevice::KBD_DEVICE_NO_KEY;
-	} else {
-		return keyMap[key];
+	return Translate(static_cast<unsigned char>(key));
+}
+//-----------------------------------------------------------------------------
+
+/**
+	This method translates a host key with the key table. Unlike a lookup in
+	\ref keyMap this never changes the mapping.
+
+	\param[in]	hostKey	PC-Keyboard value (Qt key code).
+	\return		CHIP8 keyboard value or \ref NO_KEY if the key is not mapped.
+*/
+int Chip8Keyboard::Translate(int hostKey) const
+{
+	if((hostKey < 0) || (hostKey >= TABLE_SIZE)){
+		return NO_KEY;
+	}
+	return keyTable[hostKey].load(std::memory_order_relaxed);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	This method rebuilds the key table from \ref keyMap. It is called whenever
+	the mapping changes.
+*/
+void Chip8Keyboard::BuildTable(void)
+{
+	for(int host = 0; host < TABLE_SIZE; ++host){
+		keyTable[host].store(NO_KEY, std::memory_order_relaxed);
+	}
+	for(std::map<char,int>::iterator mapIter = keyMap.begin(); mapIter != keyMap.end(); ++mapIter){
+		keyTable[static_cast<unsigned char>(mapIter->first)].store(static_cast<int8_t>(mapIter->second), std::memory_order_relaxed);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	This method sets the bit of the CHIP8 key a host key is mapped to and
+	remembers when it was pressed (key latency, see \ref TakePress()).
+
+	\param[in]	hostKey	PC-Keyboard value (Qt key code).
+	\param[in]	stampNs	Time of the key event (\ref Chip8Latency::now_ns()), 0: now.
+*/
+void Chip8Keyboard::Press(int hostKey, int64_t stampNs)
+{
+	int key = Translate(hostKey);
+
+	if(NO_KEY != key){
+		pressNs[key].store(stampNs ? stampNs : Chip8Latency::now_ns(), std::memory_order_release);
+		pressed.fetch_or(static_cast<uint16_t>(1u << key), std::memory_order_release);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	This method clears the bit of the CHIP8 key a host key is mapped to.
+
+	\param[in]	hostKey	PC-Keyboard value (Qt key code).
+*/
+void Chip8Keyboard::Release(int hostKey)
+{
+	int key = Translate(hostKey);
+
+	if(NO_KEY != key){
+		pressed.fetch_and(static_cast<uint16_t>(~(1u << key)), std::memory_order_release);
 	}
 }
 //-----------------------------------------------------------------------------
@@ -105,6 +189,8 @@ bool Chip8Keyboard::MapKey(char source, int target)
 	keyMap[source]			= target;		// add the new mapping to our key map
 	keyMap.erase(reverseKeyMap[target]);	// remove the old mapping in key map
 	reverseKeyMap[target]	= source;		// finally update the reverse mapping
+	BuildTable();
+	ReleaseAll();							// a held key may have changed its meaning
 
 	return true;
 }
@@ -118,3 +204,72 @@ char Chip8Keyboard::GetMappedKey(int key)
 	return reverseKeyMap.at(key);
 }
 //-----------------------------------------------------------------------------
+
+/**
+	This method copies the complete key mapping, map[k] is the PC-key of the
+	CHIP8 key k (0 if the key is not mapped).
+
+	\param	[out]	map	The key mapping.
+*/
+void Chip8Keyboard::GetMap(char map[16]) const
+{
+	for(int key = KEY_0; key <= KEY_F; ++key){
+		std::map<int, char>::const_iterator it = reverseKeyMap.find(key);
+		map[key] = (it != reverseKeyMap.end()) ? it->second : 0;
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	This method replaces the complete key mapping by one that was saved with
+	\ref GetMap(). Unmapped keys (0) are left out.
+
+	\param	[in]	map	The key mapping.
+*/
+void Chip8Keyboard::SetMap(char const map[16])
+{
+	keyMap.clear();
+	reverseKeyMap.clear();
+	for(int key = KEY_0; key <= KEY_F; ++key){
+		if(map[key]){
+			keyMap[map[key]]	= key;
+			reverseKeyMap[key]	= map[key];
+		}
+	}
+	BuildTable();
+	ReleaseAll();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Reports a pressed host key to the attached keyboard.
+*/
+void Chip8KeySource::KeyDown(int key, int64_t stampNs)
+{
+	if(keyboard){
+		keyboard->Press(key, stampNs);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Reports a released host key to the attached keyboard.
+*/
+void Chip8KeySource::KeyUp(int key)
+{
+	if(keyboard){
+		keyboard->Release(key);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Reports to the attached keyboard that all keys were released.
+*/
+void Chip8KeySource::AllKeysUp(void)
+{
+	if(keyboard){
+		keyboard->ReleaseAll();
+	}
+}
+//-----------------------------------------------------------------------------
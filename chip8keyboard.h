@@ -2,7 +2,10 @@
 #define CHIP8KEYBOARD_H
 
 #include <QObject>
-#include "kbddevice.h"
+#include <map>
+#include <atomic>
+#include <cstdint>
+#include "chip8keysource.h"
 
 class Chip8Keyboard
 {
@@ -32,18 +35,38 @@ public:
 		KEY_F		= 15,
 	};
 
-	Chip8Keyboard(KbdDevice* device);
+	enum	KEY_TABLE {
+		TABLE_SIZE	= 256				///< Host keys that can be mapped (Latin-1 range of the Qt key codes).
+	};
+
+	Chip8Keyboard(Chip8KeySource* device);
 	~Chip8Keyboard();
 
 	int		ReadKey(READ_MODE mode);			///< Blocking or non-blocking keyboard read (API).
+	void	Sync(uint64_t frame, uint64_t instructions) {if(kbdDevice){kbdDevice->Sync(frame, instructions);}}	///< Tell the key source the emulated time before a key read.
 	int		GetKey(char key);					///< Do the actual key translation.
 	char	GetMappedKey(int key);				///< Do a reverse lookup of the key mappping.
 	bool	MapKey(char source, int target);	///< Install a new key mapping.
+	void	GetMap(char map[16]) const;			///< Copy the host key of every CHIP8 key (session snapshot).
+	void	SetMap(char const map[16]);			///< Replace the whole key mapping (session snapshot).
+
+	void	Press(int hostKey, int64_t stampNs);	///< A host key went down at stampNs (called by the key source).
+	void	Release(int hostKey);				///< A host key went up (called by the key source).
+	void	ReleaseAll(void)					{pressed.store(0, std::memory_order_release);}								///< No key is pressed anymore.
+	bool	IsPressed(int key) const			{return (pressed.load(std::memory_order_acquire) >> key) & 1;}				///< Test one CHIP8 key (0x0 - 0xf), usable from any thread.
+	uint16_t Pressed(void) const				{return pressed.load(std::memory_order_acquire);}							///< Mask of all pressed CHIP8 keys (bit n: key n).
+	int64_t	TakePress(int key)					{return pressNs[key].load(std::memory_order_relaxed) ? pressNs[key].exchange(0, std::memory_order_acquire) : 0;}	///< Time stamp of a press not seen by the program yet (0: none), once.
 
 private:
-	std::map<char, int>	keyMap;
-	std::map<int, char> reverseKeyMap;
-	KbdDevice*			kbdDevice;
+	int		Translate(int hostKey) const;		///< Table lookup, \ref NO_KEY for unmapped keys.
+	void	BuildTable(void);					///< Rebuild \ref keyTable from \ref keyMap.
+
+	std::map<char, int>		keyMap;
+	std::map<int, char>		reverseKeyMap;
+	std::atomic<int8_t>		keyTable[TABLE_SIZE];	///< CHIP8 key of every host key (-1: not mapped), built from keyMap.
+	std::atomic<uint16_t>	pressed;				///< One bit per pressed CHIP8 key.
+	std::atomic<int64_t>	pressNs[16];			///< Time stamp of the last press per CHIP8 key, until the program reads it.
+	Chip8KeySource*			kbdDevice;
 };
 
 #endif // CHIP8KEYBOARD_H
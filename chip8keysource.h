@@ -0,0 +1,45 @@
+#ifndef CHIP8KEYSOURCE_H
+#define CHIP8KEYSOURCE_H
+
+#include <cstdint>
+
+class Chip8Keyboard;
+
+/**
+	Interface of a raw key input device. A key source delivers host key
+	codes (Qt key codes, which are plain ASCII for digits and letters)
+	to \ref Chip8Keyboard, which maps them onto the CHIP8 hex keypad.
+
+	Besides the reads a source reports every press and release to the
+	keyboard it is attached to (\ref KeyDown(), \ref KeyUp()). The keyboard
+	keeps the state of all 16 CHIP8 keys in one atomic mask, so several keys
+	can be held at once and the emulator tests a key with a single load.
+
+	Implemented by \ref KbdDevice for the Qt main window, by
+	\ref Chip8TermInput for the terminal frontend, by \ref Chip8TileKeys
+	for the grid and by \ref Chip8KeyTape for scripted input.
+*/
+class Chip8KeySource
+{
+public:
+	enum KEY_SOURCE_KEYS {
+		KEY_SOURCE_NO_KEY	= -1
+	};
+
+	Chip8KeySource() : keyboard(nullptr) {}
+	virtual ~Chip8KeySource(){}
+	virtual int ReadKey(void) = 0;		///< Non-blocking read, returns the current key or \ref KEY_SOURCE_NO_KEY.
+	virtual int GetKey(void) = 0;		///< Blocking read, waits for the next key press.
+	virtual void Sync(uint64_t frame, uint64_t instructions) {(void)frame; (void)instructions;}	///< Emulated time before a key read (only timed sources like \ref Chip8KeyTape use it).
+	void Attach(Chip8Keyboard* aKeyboard) {keyboard = aKeyboard;}	///< Called by \ref Chip8Keyboard, which receives the key state.
+
+protected:
+	void KeyDown(int key, int64_t stampNs = 0);	///< Report a pressed host key with the time of the event (0: now, see chip8keyboard.cpp).
+	void KeyUp(int key);						///< Report a released host key.
+	void AllKeysUp(void);						///< Report that no key is pressed anymore.
+
+private:
+	Chip8Keyboard*	keyboard;			///< Receiver of the key state (nullptr: none).
+};
+
+#endif // CHIP8KEYSOURCE_H
@@ -0,0 +1,162 @@
+#include <fstream>
+#include <sstream>
+#include <cctype>
+#include <cstdlib>			// strtoull()
+
+#include "chip8keytape.h"
+
+/**
+	Constructor of an empty tape.
+*/
+Chip8KeyTape::Chip8KeyTape()
+: cursor(0), held(KEY_SOURCE_NO_KEY)
+{
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Reads a timeline file (see \ref Chip8KeyTape).
+
+	\param	[in]	filename	The timeline file.
+	\return true on success, see \ref Error() otherwise.
+*/
+bool Chip8KeyTape::Load(std::string const& filename)
+{
+	std::ifstream file(filename);
+
+	if(!file.is_open()){
+		error = "couldn't read <" + filename + ">";
+		return false;
+	}
+	std::stringstream text;
+	text << file.rdbuf();
+	return Parse(text.str());
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Reads a timeline from a string, replacing the current one.
+
+	\param	[in]	text	The timeline, one event per line.
+	\return true on success, see \ref Error() otherwise.
+*/
+bool Chip8KeyTape::Parse(std::string const& text)
+{
+	std::istringstream	in(text);
+	std::string			line;
+	unsigned int		lineNo	= 0;
+
+	events.clear();
+	error.clear();
+	while(std::getline(in, line)){
+		++lineNo;
+		line = line.substr(0, line.find('#'));					// strip comments
+		std::istringstream	fields(line);
+		std::string			time;
+		std::string			type;
+		std::string			key;
+		if(!(fields >> time)){
+			continue;											// empty line
+		}
+		Event event;
+		event.instructions	= ('i' == time[0]) || ('I' == time[0]);
+		std::string number	= event.instructions ? time.substr(1) : time;
+		char* end			= nullptr;
+		event.at			= strtoull(number.c_str(), &end, 10);
+		if(number.empty() || *end || !(fields >> type >> key) || (1 != key.size())){
+			error = "line " + std::to_string(lineNo) + ": expected <time> <down|up> <key>";
+			return false;
+		}
+		if(("down" == type) || ("d" == type)){
+			event.down = true;
+		} else if(("up" == type) || ("u" == type)){
+			event.down = false;
+		} else {
+			error = "line " + std::to_string(lineNo) + ": unknown event <" + type + ">";
+			return false;
+		}
+		event.key = toupper(static_cast<unsigned char>(key[0]));	// Qt key codes of letters are upper case
+		events.push_back(event);
+	}
+	Rewind();
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Starts the replay from the beginning, all keys are released.
+*/
+void Chip8KeyTape::Rewind(void)
+{
+	cursor	= 0;
+	held	= KEY_SOURCE_NO_KEY;
+	AllKeysUp();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Applies one event to the attached keyboard.
+*/
+void Chip8KeyTape::apply(Event const& event)
+{
+	if(event.down){
+		held = event.key;
+		KeyDown(event.key);
+	} else {
+		if(held == event.key){
+			held = KEY_SOURCE_NO_KEY;
+		}
+		KeyUp(event.key);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Called by the emulator (through \ref Chip8Keyboard::Sync()) before it reads
+	the keys. Applies all events that are due at this emulated time.
+
+	\param	[in]	frame			Emulated frames since the start.
+	\param	[in]	instructions	Executed instructions since the start.
+*/
+void Chip8KeyTape::Sync(uint64_t frame, uint64_t instructions)
+{
+	while(cursor < events.size()){
+		Event const& event = events[cursor];
+		if(event.at > (event.instructions ? instructions : frame)){
+			break;
+		}
+		apply(event);
+		++cursor;
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Non-blocking read.
+
+	\return The last key pressed and not released yet or \ref KEY_SOURCE_NO_KEY.
+*/
+int Chip8KeyTape::ReadKey(void)
+{
+	return held;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Blocking read: a waiting program gets the next key press of the tape at
+	once, all events up to it are applied.
+
+	\return The next pressed key or \ref KEY_SOURCE_NO_KEY at the end of the tape.
+*/
+int Chip8KeyTape::GetKey(void)
+{
+	while(cursor < events.size()){
+		Event const& event = events[cursor++];
+		apply(event);
+		if(event.down){
+			return event.key;
+		}
+	}
+	return KEY_SOURCE_NO_KEY;
+}
+//-----------------------------------------------------------------------------
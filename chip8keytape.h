@@ -0,0 +1,68 @@
+#ifndef CHIP8KEYTAPE_H
+#define CHIP8KEYTAPE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "chip8keysource.h"
+
+/**
+	Key source that replays a timeline of key-down and key-up events, used
+	instead of \ref KbdDevice for headless, benchmark and regression runs.
+
+	The timeline is a text file with one event per line:
+
+		# time  event  key
+		60      down   5
+		64      up     5
+		i12000  down   A
+
+	The time is the emulated frame, or with the prefix "i" the number of
+	executed instructions since the start. The key is the host key as typed
+	(digits and letters, mapped by \ref Chip8Keyboard as usual). The events
+	must be in time order.
+
+	The tape follows the emulated time only: the emulator calls \ref Sync()
+	before every key read and all events that are due by then are applied.
+	Identical runs are only guaranteed by the frame-driven emulation
+	(\ref CHIP8::run_frames(), the --frames option): frame times are exact,
+	the timers count down once per frame and Cxnn draws from the seeded
+	generator of the emulator (\ref CHIP8::seed()). The real-time loop
+	(\ref CHIP8::Run()) counts frames and timers by the host clock, so a
+	replay there follows the tape but may differ from run to run; use
+	instruction times there. A replay costs one compare per key read,
+	\ref Rewind() starts the tape again without parsing it.
+*/
+class Chip8KeyTape : public Chip8KeySource
+{
+	public:
+		Chip8KeyTape();
+		bool	Load(std::string const& filename);					///< Read a timeline file.
+		bool	Parse(std::string const& text);						///< Read a timeline from a string.
+		std::string const& Error(void) const {return error;}		///< Reason why \ref Load() or \ref Parse() failed.
+		size_t	Events(void) const {return events.size();}			///< Number of events on the tape.
+		void	Rewind(void);										///< Start the replay again (releases all keys).
+		bool	Finished(void) const {return cursor >= events.size();}	///< All events were applied.
+
+		int		ReadKey(void) override;								///< The last key pressed and not released or \ref KEY_SOURCE_NO_KEY.
+		int		GetKey(void) override;								///< The next key press on the tape, the program's time stands still.
+		void	Sync(uint64_t frame, uint64_t instructions) override;	///< Apply all events that are due.
+
+	private:
+		struct Event {
+			uint64_t	at;				///< Frame or instruction count.
+			bool		instructions;	///< at counts instructions instead of frames.
+			bool		down;			///< Key-down (true) or key-up event.
+			int			key;			///< Host key code.
+		};
+
+		void	apply(Event const& event);
+
+		std::vector<Event>	events;		///< The timeline.
+		size_t				cursor;		///< Next event to apply.
+		int					held;		///< Last pressed key that is still down.
+		std::string			error;		///< Parse error.
+};
+
+#endif // CHIP8KEYTAPE_H
@@ -0,0 +1,66 @@
+#ifndef CHIP8LATENCY_H
+#define CHIP8LATENCY_H
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include "chip8histogram.h"
+
+/**
+	Input-to-photon latency of the key presses, split into three stages:
+
+	- queueing:		key event (time stamp of the key source) until the program
+					first looks at the key (Ex9E, ExA1, Fx0A),
+	- emulation:	from there until the program changes the display the next time,
+	- presentation:	from that display update until the view shows it.
+
+	The emulation thread measures the first two stages (\ref Chip8Display
+	keeps the key in flight) and then hands the key over to the view with
+	\ref markUpdate, the number of the display update that carries the
+	result. The view calls \ref presented() after showing a frame. Only one
+	key is in flight at a time, presses in between are measured up to the
+	queueing stage only.
+*/
+struct Chip8Latency
+{
+	Chip8Latency() : markUpdate(0), markKeyNs(0), markDrawNs(0) {}
+
+	/// Monotonic time stamp in ns, the clock of all stages.
+	static int64_t now_ns(void)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/// Converts a duration in ns into a histogram sample (us).
+	static uint32_t to_us(int64_t ns)
+	{
+		return (ns <= 0) ? 0 : static_cast<uint32_t>(std::min<int64_t>(ns / 1000, UINT32_MAX));
+	}
+
+	/**
+		Called by the view after it has shown everything up to display update
+		number handled. Completes the key in flight if its update is among them.
+	*/
+	void presented(uint64_t handled)
+	{
+		uint64_t mark = markUpdate.load(std::memory_order_acquire);
+		if(mark && (handled >= mark)){
+			int64_t now = now_ns();
+			presentation.add(to_us(now - markDrawNs.load(std::memory_order_relaxed)));
+			total.add(to_us(now - markKeyNs.load(std::memory_order_relaxed)));
+			markUpdate.store(0, std::memory_order_release);		// the emulator may hand over the next key
+		}
+	}
+
+	Chip8Histogram			queueing;		///< Key event until the program reads the key (us).
+	Chip8Histogram			emulation;		///< Key read until the next display update (us).
+	Chip8Histogram			presentation;	///< Display update until it is shown (us).
+	Chip8Histogram			total;			///< Key event until shown (us).
+	std::atomic<uint64_t>	markUpdate;		///< Display update the view waits for (0: no key in flight).
+	std::atomic<int64_t>	markKeyNs;		///< Key event of the key in flight.
+	std::atomic<int64_t>	markDrawNs;		///< Time of the display update of the key in flight.
+};
+
+#endif // CHIP8LATENCY_H
@@ -0,0 +1,141 @@
+#include <QFont>
+#include <algorithm>
+
+#include "chip8listmodel.h"
+
+/**
+	Constructor, the model is empty until \ref set_range() is called.
+
+	\param	[in]	aEmu	The emulator whose memory is listed.
+	\param	[in]	parent	Parent object.
+*/
+Chip8ListModel::Chip8ListModel(CHIP8* aEmu, QObject* parent)
+: QAbstractListModel(parent), emu(aEmu), addressRow(VM_SIZE, -1), seenGeneration(CHIP8::PAGE_COUNT, 0)
+{
+	CacheEntry empty = {-1, 0, QString()};
+	cache.assign(CACHE_ROWS, empty);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Sets the listed lines. Instructions cover two addresses, data bytes one.
+
+	\param	[in]	aLines	The listing in address order.
+*/
+void Chip8ListModel::set_listing(std::vector<Chip8Disassembler::Line> const& aLines)
+{
+	beginResetModel();
+	lines = aLines;
+	addressRow.assign(VM_SIZE, -1);
+	for(size_t row = 0; row < lines.size(); ++row){
+		u_int16_t a = lines[row].address;
+		addressRow[a] = static_cast<int>(row);
+		if(lines[row].code && (a+1 < VM_SIZE)){
+			addressRow[a+1] = static_cast<int>(row);				// odd addresses belong to the instruction they are in
+		}
+	}
+	for(unsigned int page = 0; page < CHIP8::PAGE_COUNT; ++page){
+		seenGeneration[page] = emu->page_generation(page);
+	}
+	for(auto& entry : cache){
+		entry.row = -1;
+	}
+	endResetModel();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	\return The row that contains address or -1 if address is not listed.
+*/
+int Chip8ListModel::row(u_int16_t address) const
+{
+	return (address < addressRow.size()) ? addressRow[address] : -1;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	\return Number of rows.
+*/
+int Chip8ListModel::rowCount(const QModelIndex& parent) const
+{
+	return parent.isValid() ? 0 : static_cast<int>(lines.size());
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Combined write generation of the (up to two) pages an instruction at
+	address is read from.
+*/
+u_int32_t Chip8ListModel::generation(u_int16_t address) const
+{
+	unsigned int first	= address >> CHIP8::PAGE_SHIFT;
+	unsigned int last	= ((address+1u) % VM_SIZE) >> CHIP8::PAGE_SHIFT;
+
+	return emu->page_generation(first) + ((first != last) ? emu->page_generation(last) : 0);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Returns the disassembled text of a row. Rows are only formatted when the
+	view asks for them and are then kept in the cache until their memory changes.
+*/
+QVariant Chip8ListModel::data(const QModelIndex& index, int role) const
+{
+	if(!index.isValid() || (index.row() >= static_cast<int>(lines.size()))){
+		return QVariant();
+	}
+	Chip8Disassembler::Line const& line = lines[static_cast<size_t>(index.row())];
+	if(Qt::FontRole == role){
+		if(!line.block){
+			return QVariant();
+		}
+		QFont font;
+		font.setBold(true);
+		return font;
+	}
+	if(Qt::DisplayRole != role){
+		return QVariant();
+	}
+
+	u_int16_t	addr	= line.address;
+	u_int32_t	gen		= generation(addr);
+	CacheEntry&	entry	= cache[static_cast<size_t>(index.row()) % CACHE_ROWS];
+	if((entry.row != index.row()) || (entry.generation != gen)){
+		entry.row			= index.row();
+		entry.generation	= gen;
+		entry.text			= QString::fromStdString(line.code ? emu->disassemble(addr) : Chip8Disassembler::format_data(emu->memory()[addr], addr));
+	}
+	return entry.text;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Public slot, called periodically. Compares the write generations of all
+	memory pages with the last check and tells the view which rows to repaint.
+	The emulator only counts the writes, so it never waits for the view.
+*/
+void Chip8ListModel::CheckWrites(void)
+{
+	for(unsigned int page = 0; page < CHIP8::PAGE_COUNT; ++page){
+		u_int32_t gen = emu->page_generation(page);
+		if(gen == seenGeneration[page]){
+			continue;
+		}
+		seenGeneration[page] = gen;
+
+		unsigned int	start	= (page << CHIP8::PAGE_SHIFT) > 0 ? (page << CHIP8::PAGE_SHIFT) - 1 : 0;	// an instruction may start in the previous page
+		unsigned int	end		= std::min((page+1) << CHIP8::PAGE_SHIFT, static_cast<unsigned int>(VM_SIZE));
+		int				first	= -1;
+		int				last	= -1;
+		for(unsigned int a = start; a < end; ++a){
+			if(addressRow[a] >= 0){
+				first	= (first < 0) ? addressRow[a] : first;
+				last	= addressRow[a];
+			}
+		}
+		if(first >= 0){
+			emit dataChanged(index(first, 0), index(last, 0));
+		}
+	}
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,57 @@
+#ifndef CHIP8LISTMODEL_H
+#define CHIP8LISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QString>
+#include <vector>
+
+#include "chip8.h"
+#include "chip8disassembler.h"
+
+/**
+	List model for the code view that disassembles rows on demand straight from
+	the emulator memory.
+
+	The rows come from the listing of \ref Chip8Disassembler (instructions and
+	data bytes), the first instruction of every basic block is shown in bold.
+	Only the rows the view actually asks for are formatted and kept in a small
+	direct-mapped cache, so the cost doesn't depend on the size of the program.
+	A cache entry remembers the write generation of its memory page, rows whose
+	memory was overwritten by the program are formatted again.
+*/
+class Chip8ListModel : public QAbstractListModel
+{
+	Q_OBJECT
+
+	public:
+		enum CACHE_SIZE {
+			CACHE_ROWS	= 256				///< Number of cached rows (a few screens full).
+		};
+
+		explicit Chip8ListModel(CHIP8* aEmu, QObject* parent = nullptr);				///< Constructor
+		int			rowCount(const QModelIndex& parent = QModelIndex()) const override;
+		QVariant	data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+		void		set_listing(std::vector<Chip8Disassembler::Line> const& aLines);		///< Set the listed lines.
+		int			row(u_int16_t address) const;										///< Row covering address (-1 if not listed).
+		u_int16_t	address(int row) const {return lines[static_cast<size_t>(row)].address;}	///< Address of a row.
+
+	public slots:
+		void CheckWrites(void);																///< Refresh rows in pages the program wrote to.
+
+	private:
+		struct CacheEntry {
+			int			row;				///< Row of this entry (-1: empty).
+			u_int32_t	generation;			///< Write generation of the memory when the text was made.
+			QString		text;				///< The formatted row.
+		};
+
+		u_int32_t	generation(u_int16_t address) const;
+
+		CHIP8*							emu;			///< The emulator whose memory is listed.
+		std::vector<Chip8Disassembler::Line>	lines;	///< The listed lines, one per row.
+		std::vector<int>				addressRow;		///< Row of every address (VM_SIZE entries, -1: not listed).
+		std::vector<u_int32_t>			seenGeneration;	///< Page generations at the last \ref CheckWrites().
+		mutable std::vector<CacheEntry>	cache;			///< Formatted rows, indexed by row % CACHE_ROWS.
+};
+
+#endif // CHIP8LISTMODEL_H
@@ -0,0 +1,228 @@
+#include <chrono>
+#include <cstring>
+
+#include "chip8logger.h"
+#include "chip8profiler.h"
+
+namespace {
+	std::atomic<uint64_t> loggerIds(0);		///< Source of \ref Chip8Logger::id.
+
+	/**
+		The queue the current thread used last, so only the first message of a
+		thread (or after switching loggers) takes the registration lock.
+	*/
+	struct QueueCache {
+		uint64_t	id;
+		void*		queue;
+	};
+	thread_local QueueCache cache = {0, nullptr};
+}
+
+/**
+	Constructor, no file is open and no thread is running.
+*/
+Chip8Logger::Chip8Logger(void)
+: file(nullptr), id(++loggerIds), buffer(BUFFER_SIZE), used(0), running(false), maxLevel(LEVEL_PROGRAM), policy(OVERFLOW_DROP), droppedCount(0), depth(0)
+{
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Destructor, writes the queued messages and closes the file. No other
+	thread may log at this point.
+*/
+Chip8Logger::~Chip8Logger()
+{
+	close();
+	for(auto& q : queues){
+		delete q.second;
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Opens filename for appending and starts the writer thread. An open file
+	is closed first.
+
+	\param	[in]	filename	Name of the log file incl. the path.
+	\return false if the file couldn't be opened.
+*/
+bool Chip8Logger::open(std::string const& filename)
+{
+	close();
+	FILE* f = fopen(filename.c_str(), "a");
+	if(!f){
+		return false;
+	}
+	file.store(f, std::memory_order_release);
+	running.store(true);
+	writerThread = std::thread(&Chip8Logger::writer, this);
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Stops the writer thread after it wrote all queued messages, notes the
+	dropped messages and closes the file.
+*/
+void Chip8Logger::close(void)
+{
+	if(!writerThread.joinable()){
+		return;
+	}
+	running.store(false);
+	wake.notify_one();
+	writerThread.join();
+
+	FILE* f = file.exchange(nullptr);
+	uint64_t lost = droppedCount.exchange(0);
+	if(lost){
+		fprintf(f, "-W- Chip8Logger: %llu messages dropped\n", static_cast<unsigned long long>(lost));
+	}
+	fclose(f);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Returns the queue of the calling thread, creating it on the first call.
+*/
+Chip8Logger::Queue* Chip8Logger::queue(void)
+{
+	if(cache.id == id){
+		return static_cast<Queue*>(cache.queue);
+	}
+
+	std::lock_guard<std::mutex>	lock(queuesMtx);
+	std::thread::id				self	= std::this_thread::get_id();
+	Queue*						q		= nullptr;
+	for(auto const& entry : queues){
+		if(entry.first == self){
+			q = entry.second;
+			break;
+		}
+	}
+	if(!q){
+		q = new Queue(QUEUE_RECORDS);
+		queues.push_back(std::make_pair(self, q));
+	}
+	cache.id	= id;
+	cache.queue	= q;
+	return q;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Queues one message. Does nothing if no file is open. Never blocks with
+	\ref OVERFLOW_DROP.
+
+	\param	[in]	level	Level of the message, dropped if above \ref set_level().
+	\param	[in]	msg		The message without newline, truncated to \ref RECORD_SIZE.
+*/
+void Chip8Logger::write(LOG_LEVEL level, char const* msg)
+{
+	if(!active() || (level > maxLevel.load(std::memory_order_relaxed))){
+		return;
+	}
+
+	Queue*	q	= queue();
+	Record	record;
+	size_t	n	= strlen(msg);
+	if(n > sizeof(record.text)){
+		n = sizeof(record.text);
+	}
+	memcpy(record.text, msg, n);
+	record.length = static_cast<uint16_t>(n);
+
+	if(q->push(record)){
+		if(q->size() == QUEUE_RECORDS / 2){						// wake the writer before the queue runs full
+			wake.notify_one();
+		}
+		return;
+	}
+	if(OVERFLOW_BLOCK == policy.load(std::memory_order_relaxed)){
+		while(running.load(std::memory_order_relaxed)){
+			wake.notify_one();
+			std::this_thread::yield();
+			if(q->push(record)){
+				return;
+			}
+		}
+	}
+	droppedCount.fetch_add(1, std::memory_order_relaxed);					// dropped, or the writer stopped while we waited
+}
+//-----------------------------------------------------------------------------
+
+/**
+	The writer thread: drains the queues as long as there are messages and
+	writes the buffer when they are empty, then sleeps for up to 10 ms.
+*/
+void Chip8Logger::writer(void)
+{
+	Chip8Profiler::thread_name("log writer");
+	while(running.load()){
+		if(!drain()){
+			flush();
+			std::unique_lock<std::mutex> lock(wakeMtx);
+			wake.wait_for(lock, std::chrono::milliseconds(10));
+		}
+	}
+	while(drain()){
+	}
+	flush();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Moves the queued messages of all threads into the write buffer (writer
+	thread), writing the buffer whenever it is full. The lock is only held
+	to copy the list of queues: queues are never removed while the file is
+	open, so a new thread registering its queue never waits for a write.
+
+	\return true if there were messages.
+*/
+bool Chip8Logger::drain(void)
+{
+	bool	any		= false;
+	size_t	waiting	= 0;
+	Record	record;
+
+	{
+		std::lock_guard<std::mutex> lock(queuesMtx);
+		draining.clear();
+		for(auto const& entry : queues){
+			draining.push_back(entry.second);
+		}
+	}
+	for(Queue* q : draining){
+		waiting += q->size();
+	}
+	depth.store(waiting, std::memory_order_relaxed);
+	for(Queue* q : draining){
+		for(unsigned int n = 0; (n < QUEUE_RECORDS) && q->pop(record); ++n){
+			if(used + record.length + 1 > buffer.size()){
+				flush();
+			}
+			memcpy(&buffer[used], record.text, record.length);
+			used			+= record.length;
+			buffer[used++]	= '\n';
+			any				= true;
+		}
+	}
+	return any;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Writes the buffer to the file (writer thread).
+*/
+void Chip8Logger::flush(void)
+{
+	if(used){
+		CHIP8_PROFILE("log_write");
+		FILE* f = file.load(std::memory_order_acquire);
+		fwrite(buffer.data(), 1, used, f);
+		fflush(f);
+		used = 0;
+	}
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,110 @@
+#ifndef CHIP8LOGGER_H
+#define CHIP8LOGGER_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "chip8spscqueue.h"
+
+/**
+	Highest level that is compiled in, messages above it cost nothing (the
+	check is a constant). Build with e.g. -DCHIP8_LOG_MAX_LEVEL=1 to remove
+	the function and program traces from the emulator.
+*/
+#ifndef CHIP8_LOG_MAX_LEVEL
+#define CHIP8_LOG_MAX_LEVEL 3
+#endif
+
+/**
+	Asynchronous buffered log file.
+
+	Every thread that logs gets its own lock-free queue (\ref Chip8SpscQueue)
+	on its first message, so \ref write() only copies the message into a
+	fixed-size record and never takes a lock or calls into the C library.
+	A writer thread drains all queues into a large buffer and writes it
+	with one fwrite() when it is full or the queues are empty, so a program
+	trace costs a few syscalls per batch instead of an open, write, flush
+	and close per instruction.
+
+	If a queue is full the message is dropped and counted
+	(\ref OVERFLOW_DROP, default) or the producer waits for the writer
+	(\ref OVERFLOW_BLOCK, nothing is lost but the emulation slows down;
+	a message that is still waiting when the file is closed is counted as
+	dropped). The number of dropped messages is written to the file when
+	it is closed. No thread is started before the first \ref open().
+*/
+class Chip8Logger
+{
+	public:
+		enum LOG_LEVEL {
+			LEVEL_ERROR		= 0,		///< Errors.
+			LEVEL_INFO		= 1,		///< General information (log).
+			LEVEL_TRACE		= 2,		///< Function trace.
+			LEVEL_PROGRAM	= 3			///< Program trace, one message per instruction.
+		};
+
+		enum OVERFLOW_POLICY {
+			OVERFLOW_DROP,				///< Drop the message and count it.
+			OVERFLOW_BLOCK				///< Wait until the writer made room.
+		};
+
+		enum LOGGER_SIZES {
+			RECORD_SIZE		= 256,		///< Size of a record, longer messages are truncated.
+			QUEUE_RECORDS	= 1024,		///< Records per thread queue.
+			BUFFER_SIZE		= 64 * 1024	///< Write buffer of the writer thread.
+		};
+
+		Chip8Logger(void);																	///< Constructor, no file is open.
+		~Chip8Logger();																		///< Writes the rest and closes the file.
+		bool		open(std::string const& filename);										///< Append to filename (closes the previous file).
+		void		close(void);															///< Write the queued messages and close the file.
+		bool		active(void) const	{return nullptr != file.load(std::memory_order_relaxed);}	///< A file is open.
+		void		write(LOG_LEVEL level, char const* msg);								///< Queue one message (any thread).
+		void		set_level(LOG_LEVEL level)				{maxLevel.store(level, std::memory_order_relaxed);}		///< Highest level written (default: all).
+		void		set_overflow(OVERFLOW_POLICY aPolicy)	{policy.store(aPolicy, std::memory_order_relaxed);}		///< Behaviour if a queue is full.
+		OVERFLOW_POLICY	overflow(void) const	{return static_cast<OVERFLOW_POLICY>(policy.load(std::memory_order_relaxed));}	///< See \ref set_overflow().
+		uint64_t	dropped(void) const	{return droppedCount.load(std::memory_order_relaxed);}	///< Messages lost because a queue was full.
+		size_t		queued(void) const	{return depth.load(std::memory_order_relaxed);}			///< Messages waiting in all queues when the writer last looked.
+
+		/**
+			\return true if messages of level are compiled in (constant, lets
+			the compiler remove the call and the formatting of the message).
+		*/
+		static constexpr bool compiled(LOG_LEVEL level) {return level <= CHIP8_LOG_MAX_LEVEL;}
+
+	private:
+		struct Record {
+			uint16_t	length;					///< Length of the text.
+			char		text[RECORD_SIZE - 2];	///< The message, without newline.
+		};
+		typedef Chip8SpscQueue<Record> Queue;
+
+		Queue*		queue(void);
+		void		writer(void);
+		bool		drain(void);
+		void		flush(void);
+
+		std::atomic<FILE*>				file;				///< The log file (nullptr: closed).
+		uint64_t						id;					///< Identifies the logger in the per-thread queue cache.
+		std::mutex						queuesMtx;			///< Protects queues (registration only).
+		std::vector<std::pair<std::thread::id, Queue*>>	queues;	///< One queue per logging thread.
+		std::vector<Queue*>				draining;			///< Copy of queues for \ref drain() (writer thread).
+		std::vector<char>				buffer;				///< Write buffer (writer thread).
+		size_t							used;				///< Bytes in buffer.
+		std::mutex						wakeMtx;			///< Wakes the writer early.
+		std::condition_variable			wake;
+		std::atomic<bool>				running;			///< Cleared to stop the writer.
+		std::atomic<int>				maxLevel;			///< See \ref set_level().
+		std::atomic<int>				policy;				///< \ref OVERFLOW_POLICY.
+		std::atomic<uint64_t>			droppedCount;		///< Statistics: dropped messages.
+		std::atomic<size_t>				depth;				///< Statistics: see \ref queued().
+		std::thread						writerThread;		///< Drains the queues.
+};
+
+#endif // CHIP8LOGGER_H
@@ -0,0 +1,147 @@
+#include <QColor>
+#include <algorithm>
+#include <cstring>
+
+#include "chip8memorymodel.h"
+
+/**
+	Constructor, takes the first copy of the memory.
+
+	\param	[in]	aEmu	The emulator whose memory is shown.
+	\param	[in]	parent	Parent object.
+*/
+Chip8MemoryModel::Chip8MemoryModel(CHIP8* aEmu, QObject* parent)
+: QAbstractTableModel(parent), emu(aEmu), shadow(aEmu->memory(), aEmu->memory() + VM_SIZE), heat(VM_SIZE, 0), seenGeneration(CHIP8::PAGE_COUNT, 0)
+{
+	for(unsigned int page = 0; page < CHIP8::PAGE_COUNT; ++page){
+		seenGeneration[page] = emu->page_generation(page);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	\return Number of rows.
+*/
+int Chip8MemoryModel::rowCount(const QModelIndex& parent) const
+{
+	return parent.isValid() ? 0 : VM_SIZE / BYTES_PER_ROW;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	\return Number of columns.
+*/
+int Chip8MemoryModel::columnCount(const QModelIndex& parent) const
+{
+	return parent.isValid() ? 0 : BYTES_PER_ROW;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Returns one byte of the shadow copy, recently written bytes get a red
+	background that fades out.
+*/
+QVariant Chip8MemoryModel::data(const QModelIndex& index, int role) const
+{
+	if(!index.isValid()){
+		return QVariant();
+	}
+	unsigned int address = static_cast<unsigned int>(index.row() * BYTES_PER_ROW + index.column());
+
+	switch(role){
+		case Qt::DisplayRole:		return QString().sprintf("%02X", shadow[address]);
+		case Qt::BackgroundRole:	if(heat[address]){
+										int gb = 255 - static_cast<int>(shade(heat[address]) * 160 / FADE_STEPS);
+										return QColor(255, gb, gb);
+									}
+									break;
+	}
+	return QVariant();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Rows are labelled with their address, columns with the offset.
+*/
+QVariant Chip8MemoryModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if(Qt::DisplayRole != role){
+		return QVariant();
+	}
+	if(Qt::Horizontal == orientation){
+		return QString().sprintf("%X", section);
+	}
+	return QString().sprintf("$%03X", section * BYTES_PER_ROW);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	\return Colour level (0 - FADE_STEPS) of a byte with heat h.
+*/
+unsigned int Chip8MemoryModel::shade(unsigned int h)
+{
+	return (h * FADE_STEPS + HIGHLIGHT_TICKS - 1) / HIGHLIGHT_TICKS;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Tells the view to repaint the rows that contain the addresses [first, last].
+*/
+void Chip8MemoryModel::changed_rows(unsigned int first, unsigned int last)
+{
+	emit dataChanged(index(static_cast<int>(first / BYTES_PER_ROW), 0), index(static_cast<int>(last / BYTES_PER_ROW), BYTES_PER_ROW - 1));
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Public slot, called periodically by the main window. Pages that were not
+	written since the last call cost one atomic load. Written pages are
+	compared byte by byte with the shadow copy, changed bytes are highlighted.
+*/
+void Chip8MemoryModel::Refresh(void)
+{
+	unsigned char const*	ram		= emu->memory();
+
+	for(unsigned int page = 0; page < CHIP8::PAGE_COUNT; ++page){
+		u_int32_t gen = emu->page_generation(page);
+		if(gen == seenGeneration[page]){
+			continue;
+		}
+		seenGeneration[page] = gen;
+
+		unsigned int start	= page << CHIP8::PAGE_SHIFT;
+		unsigned int end	= start + (1u << CHIP8::PAGE_SHIFT);
+		if(0 == memcmp(&shadow[start], ram + start, end - start)){
+			continue;																// rewritten with the same values
+		}
+		unsigned int first	= end;
+		unsigned int last	= start;
+		for(unsigned int a = start; a < end; ++a){
+			if(shadow[a] != ram[a]){
+				shadow[a] = ram[a];
+				if(0 == heat[a]){
+					hot.push_back(static_cast<u_int16_t>(a));
+				}
+				heat[a]	= HIGHLIGHT_TICKS;
+				first	= std::min(first, a);
+				last	= std::max(last, a);
+			}
+		}
+		changed_rows(first, last);
+	}
+
+	for(size_t i = 0; i < hot.size(); ){											// fade out the highlights
+		u_int16_t		a		= hot[i];
+		unsigned int	level	= shade(heat[a]);
+		if(shade(--heat[a]) != level){
+			changed_rows(a, a);														// only repaint when the colour changes
+		}
+		if(0 == heat[a]){
+			hot[i] = hot.back();
+			hot.pop_back();
+		} else {
+			++i;
+		}
+	}
+}
+//-----------------------------------------------------------------------------
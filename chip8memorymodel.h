@@ -0,0 +1,49 @@
+#ifndef CHIP8MEMORYMODEL_H
+#define CHIP8MEMORYMODEL_H
+
+#include <QAbstractTableModel>
+#include <vector>
+
+#include "chip8.h"
+
+/**
+	Table model for the memory view, 16 byte per row.
+
+	The model shows a shadow copy of the emulator memory. \ref Refresh() only
+	re-reads the pages whose write generation (\ref CHIP8::page_generation())
+	changed since the last refresh and repaints only their rows, so the view can
+	stay open while the program runs at full speed. Bytes that changed are
+	highlighted for a while.
+*/
+class Chip8MemoryModel : public QAbstractTableModel
+{
+	Q_OBJECT
+
+	public:
+		enum MEMORY_VIEW {
+			BYTES_PER_ROW	= 16,		///< Bytes in one row of the view.
+			HIGHLIGHT_TICKS	= 30,		///< Number of refreshes a written byte stays highlighted.
+			FADE_STEPS		= 4			///< Number of colours while a highlight fades.
+		};
+
+		explicit Chip8MemoryModel(CHIP8* aEmu, QObject* parent = nullptr);		///< Constructor
+		int			rowCount(const QModelIndex& parent = QModelIndex()) const override;
+		int			columnCount(const QModelIndex& parent = QModelIndex()) const override;
+		QVariant	data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+		QVariant	headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+	public slots:
+		void Refresh(void);														///< Re-read written pages, fade highlights.
+
+	private:
+		void				changed_rows(unsigned int first, unsigned int last);
+		static unsigned int	shade(unsigned int h);
+
+		CHIP8*					emu;			///< The emulator whose memory is shown.
+		std::vector<u_int8_t>	shadow;			///< Copy of the memory as shown.
+		std::vector<u_int8_t>	heat;			///< Remaining highlight ticks per byte.
+		std::vector<u_int16_t>	hot;			///< Addresses with heat > 0.
+		std::vector<u_int32_t>	seenGeneration;	///< Page generations at the last refresh.
+};
+
+#endif // CHIP8MEMORYMODEL_H
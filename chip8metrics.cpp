@@ -0,0 +1,126 @@
+#include <cstdio>
+
+#include "chip8metrics.h"
+#include "chip8histogram.h"
+
+namespace {
+
+/**
+	\return The series name with its labels, e.g. chip8_x{class="8"}.
+*/
+std::string series(std::string const& name, std::string const& labels, std::string const& extra = std::string())
+{
+	std::string all = labels;
+
+	if(!extra.empty()){
+		all += (all.empty() ? "" : ",") + extra;
+	}
+	return all.empty() ? name : name + "{" + all + "}";
+}
+
+/**
+	\return v formatted for the exposition format (integers without exponent).
+*/
+std::string number(double v)
+{
+	char buf[32];
+
+	snprintf(buf, sizeof(buf), "%.15g", v);
+	return buf;
+}
+
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Registers a counter.
+
+	\param	[in]	name	Metric name, should end in _total.
+	\param	[in]	help	One line of description.
+	\param	[in]	read	Returns the current value, called from the scraping thread.
+	\param	[in]	labels	Labels of this series without braces, e.g. class="8".
+*/
+void Chip8Metrics::counter(std::string const& name, std::string const& help, Reader read, std::string const& labels)
+{
+	add(Metric{name, help, labels, METRIC_COUNTER, read, nullptr});
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Registers a gauge, see \ref counter().
+*/
+void Chip8Metrics::gauge(std::string const& name, std::string const& help, Reader read, std::string const& labels)
+{
+	add(Metric{name, help, labels, METRIC_GAUGE, read, nullptr});
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Registers a histogram of durations. The buckets of \ref Chip8Histogram
+	become the le buckets (in seconds), the last one is +Inf.
+
+	\param	[in]	name	Metric name, should end in _seconds.
+	\param	[in]	help	One line of description.
+	\param	[in]	h		The histogram, must outlive the registry.
+	\param	[in]	labels	Labels of this series without braces.
+*/
+void Chip8Metrics::histogram(std::string const& name, std::string const& help, Chip8Histogram const* h, std::string const& labels)
+{
+	add(Metric{name, help, labels, METRIC_HISTOGRAM, Reader(), h});
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Inserts a series behind the other series of its name.
+*/
+void Chip8Metrics::add(Metric const& metric)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+
+	for(size_t i = metrics.size(); i > 0; --i){
+		if(metrics[i-1].name == metric.name){
+			metrics.insert(metrics.begin() + static_cast<ptrdiff_t>(i), metric);
+			return;
+		}
+	}
+	metrics.push_back(metric);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Reads all metrics (any thread).
+
+	\return The metrics in the Prometheus text exposition format 0.0.4.
+*/
+std::string Chip8Metrics::render(void) const
+{
+	static char const* const	types[3] = {"counter", "gauge", "histogram"};
+	std::string					out;
+	std::vector<uint64_t>		counts;
+
+	std::lock_guard<std::mutex> lock(mtx);
+	for(size_t i = 0; i < metrics.size(); ++i){
+		Metric const& m = metrics[i];
+		if((0 == i) || (metrics[i-1].name != m.name)){
+			out += "# HELP " + m.name + " " + m.help + "\n";
+			out += "# TYPE " + m.name + " " + types[m.type] + "\n";
+		}
+		if(METRIC_HISTOGRAM != m.type){
+			out += series(m.name, m.labels) + " " + number(m.read()) + "\n";
+			continue;
+		}
+		uint64_t	total	= 0;
+		uint64_t	sum		= m.histogram->sum();
+		m.histogram->snapshot(counts);
+		for(unsigned int b = 0; b + 1 < counts.size(); ++b){
+			total += counts[b];
+			out += series(m.name + "_bucket", m.labels, "le=\"" + number(Chip8Histogram::upper(b) / 1e6) + "\"") + " " + number(static_cast<double>(total)) + "\n";
+		}
+		total += counts.back();
+		out += series(m.name + "_bucket", m.labels, "le=\"+Inf\"") + " " + number(static_cast<double>(total)) + "\n";
+		out += series(m.name + "_sum", m.labels) + " " + number(static_cast<double>(sum) / 1e6) + "\n";
+		out += series(m.name + "_count", m.labels) + " " + number(static_cast<double>(total)) + "\n";
+	}
+	return out;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,57 @@
+#ifndef CHIP8METRICS_H
+#define CHIP8METRICS_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <functional>
+
+class Chip8Histogram;
+
+/**
+	Registry of the metrics of the emulator in the Prometheus text format.
+
+	The registry doesn't own any values: the emulator, the display and the
+	view keep their relaxed atomic counters and \ref Chip8Histogram as they
+	are and register a reader for each of them (see
+	\ref CHIP8::register_metrics()). \ref render() calls the readers, so a
+	scrape is a number of relaxed loads and never takes a lock the
+	emulation thread uses. The mutex of the registry only orders
+	registration and scrapes.
+
+	All series of one metric are kept together; series of the same name
+	differ by their labels, e.g. class="8".
+*/
+class Chip8Metrics
+{
+	public:
+		typedef std::function<double(void)> Reader;		///< Current value of a counter or gauge (any thread).
+
+		void		counter(std::string const& name, std::string const& help, Reader read, std::string const& labels = std::string());	///< Monotonic count.
+		void		gauge(std::string const& name, std::string const& help, Reader read, std::string const& labels = std::string());	///< Value that goes up and down.
+		void		histogram(std::string const& name, std::string const& help, Chip8Histogram const* h, std::string const& labels = std::string());	///< Durations in us, exported in seconds.
+		std::string	render(void) const;																	///< All metrics in the text exposition format.
+
+	private:
+		enum METRIC_TYPE {
+			METRIC_COUNTER,
+			METRIC_GAUGE,
+			METRIC_HISTOGRAM
+		};
+
+		struct Metric {
+			std::string				name;		///< Metric name.
+			std::string				help;		///< HELP text.
+			std::string				labels;		///< Labels without braces (may be empty).
+			METRIC_TYPE				type;		///< Kind of metric.
+			Reader					read;		///< Counter or gauge value.
+			Chip8Histogram const*	histogram;	///< Histogram (\ref METRIC_HISTOGRAM).
+		};
+
+		void add(Metric const& metric);
+
+		mutable std::mutex		mtx;			///< Registration vs. scrapes.
+		std::vector<Metric>		metrics;		///< Grouped by name.
+};
+
+#endif // CHIP8METRICS_H
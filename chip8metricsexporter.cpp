@@ -0,0 +1,236 @@
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <unistd.h>			// close()
+#include <poll.h>			// poll()
+#include <sys/socket.h>		// socket()
+#include <sys/time.h>		// timeval
+#include <netinet/in.h>		// sockaddr_in
+#include <arpa/inet.h>		// htons()
+
+#include "chip8metricsexporter.h"
+#include "chip8metrics.h"
+
+/**
+	Constructor.
+
+	\param	[in]	aMetrics	The registry to export, must outlive the exporter.
+*/
+Chip8MetricsExporter::Chip8MetricsExporter(Chip8Metrics const* aMetrics)
+: metrics(aMetrics), interval(FILE_INTERVAL_MS), listenFd(-1), boundPort(0), running(false)
+{
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Destructor, stops the thread and closes the socket. The file is written
+	a last time, so it holds the final counts of the run.
+*/
+Chip8MetricsExporter::~Chip8MetricsExporter()
+{
+	running = false;
+	if(serverThread.joinable()){
+		serverThread.join();
+	}
+	if(!filename.empty()){
+		rewrite();
+	}
+	if(listenFd >= 0){
+		::close(listenFd);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Exports the metrics into a file that is rewritten every intervalMs. The
+	file is written right away, so a wrong path is reported here.
+
+	\param	[in]	aFilename	Name of the metrics file (e.g. chip8.prom).
+	\param	[in]	intervalMs	Period of the rewrite.
+	\return false if the file couldn't be written (see \ref error()).
+*/
+bool Chip8MetricsExporter::write_file(std::string const& aFilename, unsigned int intervalMs)
+{
+	filename	= aFilename;
+	interval	= (intervalMs > 0) ? intervalMs : static_cast<unsigned int>(FILE_INTERVAL_MS);
+	if(!rewrite()){
+		filename.clear();
+		return false;
+	}
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Opens the HTTP listener on the loopback interface.
+
+	\param	[in]	aPort	TCP port, 0 to let the system choose (see \ref port()).
+	\return false if the port couldn't be bound (see \ref error()).
+*/
+bool Chip8MetricsExporter::listen(uint16_t aPort)
+{
+	sockaddr_in	addr;
+	socklen_t	length	= sizeof(addr);
+	int			on		= 1;
+
+	if((listenFd = socket(AF_INET, SOCK_STREAM, 0)) < 0){
+		message = "can't create a socket";
+		return false;
+	}
+	setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family			= AF_INET;
+	addr.sin_addr.s_addr	= htonl(INADDR_LOOPBACK);		// never reachable from outside
+	addr.sin_port			= htons(aPort);
+	if((bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) || (::listen(listenFd, 4) != 0)
+		|| (getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &length) != 0)){
+		message = "can't listen on 127.0.0.1:" + std::to_string(aPort) + " (" + strerror(errno) + ")";
+		::close(listenFd);
+		listenFd = -1;
+		return false;
+	}
+	boundPort = ntohs(addr.sin_port);
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Starts the thread if a file or a listener is set up.
+*/
+void Chip8MetricsExporter::start(void)
+{
+	if(running || (filename.empty() && (listenFd < 0))){
+		return;
+	}
+	running			= true;
+	serverThread	= std::thread(&Chip8MetricsExporter::serve, this);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	The exporter thread: waits for connections at most \ref POLL_MS and
+	rewrites the file when its period is over.
+*/
+void Chip8MetricsExporter::serve(void)
+{
+	std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now() + std::chrono::milliseconds(interval);
+
+	while(running.load()){
+		if(listenFd >= 0){
+			pollfd pfd = {listenFd, POLLIN, 0};
+			if((poll(&pfd, 1, POLL_MS) > 0) && (pfd.revents & POLLIN)){
+				int client = accept(listenFd, nullptr, nullptr);
+				if(client >= 0){
+					answer(client);
+					::close(client);
+				}
+			}
+		} else {
+			std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MS));
+		}
+		if(!filename.empty() && (std::chrono::steady_clock::now() >= next)){
+			rewrite();
+			next += std::chrono::milliseconds(interval);
+			if(next < std::chrono::steady_clock::now()){		// don't catch up after a stall
+				next = std::chrono::steady_clock::now() + std::chrono::milliseconds(interval);
+			}
+		}
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Writes the metrics into <file>.tmp and renames it to the file.
+	\return false if the file couldn't be written.
+*/
+bool Chip8MetricsExporter::rewrite(void)
+{
+	std::string	text	= metrics->render();
+	std::string	tmp		= filename + ".tmp";
+	FILE*		f		= fopen(tmp.c_str(), "w");
+
+	if(!f){
+		message = "can't write <" + tmp + ">";
+		return false;
+	}
+	bool ok = (fwrite(text.data(), 1, text.size(), f) == text.size());
+	ok = (0 == fclose(f)) && ok;
+	if(!ok || (rename(tmp.c_str(), filename.c_str()) != 0)){
+		message = "can't write <" + filename + ">";
+		return false;
+	}
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Reads one HTTP request and answers it: the metrics for GET /metrics (and
+	GET /), 404 for other paths, 405 for other methods. The whole exchange
+	has to finish within a second, a slow client is dropped.
+
+	\param	[in]	client	The connected socket.
+*/
+void Chip8MetricsExporter::answer(int client)
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+	char		request[2048];
+	size_t		used	= 0;
+	std::string	status	= "200 OK";
+	std::string	body;
+
+	auto in_time = [client, deadline](int option){						// the socket timeout applies to each call: limit it to the time left
+		std::chrono::microseconds left = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now());
+		if(left.count() <= 0){
+			return false;
+		}
+		timeval timeout = {static_cast<time_t>(left.count() / 1000000), static_cast<suseconds_t>(left.count() % 1000000)};
+		setsockopt(client, SOL_SOCKET, option, &timeout, sizeof(timeout));
+		return true;
+	};
+
+	while((used < sizeof(request) - 1) && in_time(SO_RCVTIMEO)){		// the request line is all we need
+		ssize_t n = recv(client, request + used, sizeof(request) - 1 - used, 0);
+		if(n <= 0){
+			break;
+		}
+		used			+= static_cast<size_t>(n);
+		request[used]	= '\0';
+		if(strstr(request, "\r\n\r\n") || strstr(request, "\n\n")){
+			break;
+		}
+	}
+	request[used] = '\0';
+	if(0 == used){
+		return;
+	}
+
+	bool get	= (0 == strncmp(request, "GET ", 4));
+	bool head	= (0 == strncmp(request, "HEAD ", 5));
+	std::string path;
+	if(get || head){
+		char const* p = strchr(request, ' ') + 1;
+		path.assign(p, strcspn(p, " ?\r\n"));
+	}
+	if(!get && !head){
+		status	= "405 Method Not Allowed";
+		body	= "only GET\n";
+	} else if(("/metrics" == path) || ("/" == path)){
+		body = metrics->render();
+	} else {
+		status	= "404 Not Found";
+		body	= "try /metrics\n";
+	}
+
+	std::string header = "HTTP/1.0 " + status + "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: "
+		+ std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+	std::string response = header + (head ? std::string() : body);
+	for(size_t sent = 0; (sent < response.size()) && in_time(SO_SNDTIMEO); ){
+		ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+		if(n <= 0){
+			break;
+		}
+		sent += static_cast<size_t>(n);
+	}
+}
+//-----------------------------------------------------------------------------
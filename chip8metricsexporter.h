@@ -0,0 +1,56 @@
+#ifndef CHIP8METRICSEXPORTER_H
+#define CHIP8METRICSEXPORTER_H
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <atomic>
+
+class Chip8Metrics;
+
+/**
+	Makes a \ref Chip8Metrics registry available to Prometheus, in one or
+	both of two ways:
+
+	- \ref write_file(): the file is rewritten periodically (written to
+	  <file>.tmp and renamed, so a reader never sees half a file), e.g. for
+	  the textfile collector of the node exporter.
+	- \ref listen(): a minimal HTTP server on 127.0.0.1 answers
+	  GET /metrics. It serves one request at a time and is only meant for a
+	  local scraper.
+
+	Both run in one thread of the exporter, which only calls
+	\ref Chip8Metrics::render(); the emulator is never locked or woken.
+*/
+class Chip8MetricsExporter
+{
+	public:
+		enum EXPORTER_DEFAULTS {
+			FILE_INTERVAL_MS	= 1000,		///< Default period of the file.
+			POLL_MS				= 100		///< Longest wait of the thread, bounds the time to stop.
+		};
+
+		explicit Chip8MetricsExporter(Chip8Metrics const* aMetrics);				///< Constructor, exports nothing yet.
+		~Chip8MetricsExporter();													///< Stops the thread, writes the file a last time.
+		bool				write_file(std::string const& filename, unsigned int intervalMs = FILE_INTERVAL_MS);	///< Rewrite filename periodically.
+		bool				listen(uint16_t port);									///< Serve on 127.0.0.1:port (0: any free port).
+		void				start(void);											///< Start the thread after \ref write_file() / \ref listen().
+		uint16_t			port(void) const	{return boundPort;}					///< Port of the HTTP server (0: none).
+		std::string const&	error(void) const	{return message;}					///< Reason of the last failure.
+
+	private:
+		void	serve(void);
+		bool	rewrite(void);
+		void	answer(int client);
+
+		Chip8Metrics const*		metrics;			///< The registry.
+		std::string				filename;			///< Metrics file (empty: none).
+		unsigned int			interval;			///< Period of the file in ms.
+		int						listenFd;			///< Listening socket (-1: none).
+		uint16_t				boundPort;			///< Port of listenFd.
+		std::string				message;			///< See \ref error().
+		std::atomic<bool>		running;			///< Cleared to stop the thread.
+		std::thread				serverThread;		///< Writes the file and answers requests.
+};
+
+#endif // CHIP8METRICSEXPORTER_H
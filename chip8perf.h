@@ -0,0 +1,41 @@
+#ifndef CHIP8PERF_H
+#define CHIP8PERF_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "chip8histogram.h"
+
+/**
+	Performance counters of the emulation thread. They are only written by
+	\ref CHIP8::run() (plain relaxed stores, no locked instructions) and can
+	be read from any thread, e.g. by the performance HUD.
+*/
+struct Chip8PerfCounters
+{
+	Chip8PerfCounters() : instructions(0), frames(0), droppedFrames(0), sleepNs(0), execNs(0), targetIps(0), ips(0)
+	{
+		for(unsigned int i = 0; i < 16; ++i){
+			opClass[i].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	/// Adds to a counter that has only one writer.
+	static void add(std::atomic<uint64_t>& counter, uint64_t value)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	std::atomic<uint64_t>	instructions;		///< Executed instructions.
+	std::atomic<uint64_t>	frames;				///< Completed 60Hz frames.
+	std::atomic<uint64_t>	droppedFrames;		///< 60Hz frames skipped because the emulator was late or halted.
+	std::atomic<uint64_t>	sleepNs;			///< Time spent in the speed-limiting sleep.
+	std::atomic<uint64_t>	execNs;				///< Time spent executing instructions.
+	std::atomic<uint32_t>	targetIps;			///< Instructions per second the speed setting aims at.
+	std::atomic<uint32_t>	ips;				///< Instructions per second, measured about once a second.
+	std::atomic<uint64_t>	opClass[16];		///< Executed instructions per opcode class (first nibble), run-ahead excluded.
+	Chip8Histogram			frameTime;			///< Host time per 60Hz frame in microseconds.
+	Chip8Histogram			frameJitter;		///< Deviation of the frame time from 16667 us.
+};
+
+#endif // CHIP8PERF_H
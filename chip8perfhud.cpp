@@ -0,0 +1,152 @@
+#include "chip8perfhud.h"
+#include "chip8graphicsview.h"
+#include "chip8display.h"
+#include "chip8audio.h"
+
+/**
+	Constructor, the overlay is hidden until \ref Show() is called.
+
+	\param	[in]	aEmu	The emulator to watch.
+	\param	[in]	aView	The display whose presentation is watched.
+	\param	[in]	aHost	Widget the overlay is drawn on (the graphics view).
+	\param	[in]	parent	Parent object.
+*/
+Chip8PerfHud::Chip8PerfHud(CHIP8* aEmu, Chip8GraphicsView* aView, QWidget* aHost, QObject* parent)
+: QObject(parent), emu(aEmu), view(aView)
+{
+	label = new QLabel(aHost);
+	label->setStyleSheet("QLabel { background-color: rgba(0, 0, 0, 160); color: #7fff7f; font-family: monospace; padding: 4px; }");
+	label->setAttribute(Qt::WA_TransparentForMouseEvents);
+	label->move(4, 4);
+	label->hide();
+
+	timer.setInterval(500);
+	connect(&timer, &QTimer::timeout, this, &Chip8PerfHud::Update);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Public slot to switch the overlay on or off. Nothing is sampled while it is off.
+
+	\param	[in]	on	true to show the overlay.
+*/
+void Chip8PerfHud::Show(bool on)
+{
+	if(on){
+		sample();
+		label->setText(tr("measuring..."));
+		label->adjustSize();
+		label->show();
+		label->raise();
+		timer.start();
+	} else {
+		timer.stop();
+		label->hide();
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Remembers the current counter values as start of the next interval.
+*/
+void Chip8PerfHud::sample(void)
+{
+	Chip8PerfCounters const& perf = emu->perf();
+
+	lastTime			= std::chrono::steady_clock::now();
+	lastInstructions	= perf.instructions.load(std::memory_order_relaxed);
+	lastFrames			= perf.frames.load(std::memory_order_relaxed);
+	lastSleepNs			= perf.sleepNs.load(std::memory_order_relaxed);
+	lastExecNs			= perf.execNs.load(std::memory_order_relaxed);
+	lastReceived		= view->received_updates();
+	lastPresented		= view->presented_frames();
+	perf.frameTime.snapshot(lastFrameTime);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Formats p50/p95/p99 of a latency histogram (all samples so far) as one line.
+*/
+QString Chip8PerfHud::latency(QString const& name, Chip8Histogram const& histogram)
+{
+	uint64_t samples = 0;
+
+	histogram.snapshot(latencyCounts);
+	for(uint64_t c : latencyCounts){
+		samples += c;
+	}
+	return tr("\n%1 %2 / %3 / %4 ms  (%5)")
+		.arg(name, -7)
+		.arg(Chip8Histogram::quantile(latencyCounts, 0.50) / 1000.0, 0, 'f', 1)
+		.arg(Chip8Histogram::quantile(latencyCounts, 0.95) / 1000.0, 0, 'f', 1)
+		.arg(Chip8Histogram::quantile(latencyCounts, 0.99) / 1000.0, 0, 'f', 1)
+		.arg(static_cast<unsigned long long>(samples));
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Formats the audio statistics (\ref Chip8Audio), empty without sound.
+*/
+QString Chip8PerfHud::sound(void)
+{
+	Chip8Audio const* audio = emu->audio();
+
+	if(!audio){
+		return QString();
+	}
+	return tr("\naudio underruns %1  dropped %2  buffered %3 ms")
+		.arg(static_cast<unsigned long long>(audio->underruns()))
+		.arg(static_cast<unsigned long long>(audio->dropped()))
+		.arg(audio->buffered_ms(), 0, 'f', 1)
+		+ latency(tr("audio"), audio->latency());
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Timer slot, shows the rates since the last call.
+*/
+void Chip8PerfHud::Update(void)
+{
+	Chip8PerfCounters const&				perf		= emu->perf();
+	std::chrono::steady_clock::time_point	now			= std::chrono::steady_clock::now();
+	double									seconds		= std::chrono::duration<double>(now - lastTime).count();
+	uint64_t								instructions	= perf.instructions.load(std::memory_order_relaxed) - lastInstructions;
+	uint64_t								frames		= perf.frames.load(std::memory_order_relaxed) - lastFrames;
+	uint64_t								sleepNs		= perf.sleepNs.load(std::memory_order_relaxed) - lastSleepNs;
+	uint64_t								execNs		= perf.execNs.load(std::memory_order_relaxed) - lastExecNs;
+	uint64_t								received	= view->received_updates() - lastReceived;
+	uint64_t								presented	= view->presented_frames() - lastPresented;
+
+	perf.frameTime.snapshot(frameTime);
+	for(unsigned int i = 0; i < frameTime.size(); ++i){		// histogram of this interval only
+		frameTime[i] -= lastFrameTime[i];
+	}
+	if(seconds <= 0.0){
+		return;
+	}
+
+	double busy		= (sleepNs + execNs) ? (100.0 * execNs) / (sleepNs + execNs) : 0.0;
+	double avgMs	= frames ? (1000.0 * seconds) / frames : 0.0;
+	double coalesced= (received > presented) ? (received - presented) / seconds : 0.0;
+
+	label->setText(tr("IPS  %1 / %2\nFPS  %3\nframe %4 ms  p99 %5 ms\nexec %6%  sleep %7%\npresented %8/s  coalesced %9/s\nbacklog %10")
+		.arg(static_cast<unsigned long long>(instructions / seconds))
+		.arg(perf.targetIps.load(std::memory_order_relaxed))
+		.arg(frames / seconds, 0, 'f', 1)
+		.arg(avgMs, 0, 'f', 2)
+		.arg(Chip8Histogram::quantile(frameTime, 0.99) / 1000.0, 0, 'f', 2)
+		.arg(busy, 0, 'f', 1)
+		.arg(100.0 - busy, 0, 'f', 1)
+		.arg(presented / seconds, 0, 'f', 1)
+		.arg(coalesced, 0, 'f', 1)
+		.arg(emu->display()->queued())
+		+ tr("\nkey latency p50 / p95 / p99")
+		+ latency(tr("total"), emu->display()->latency().total)
+		+ latency(tr("queue"), emu->display()->latency().queueing)
+		+ latency(tr("emu"), emu->display()->latency().emulation)
+		+ latency(tr("present"), emu->display()->latency().presentation)
+		+ sound());
+	label->adjustSize();
+	sample();
+}
+//-----------------------------------------------------------------------------
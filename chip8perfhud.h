@@ -0,0 +1,60 @@
+#ifndef CHIP8PERFHUD_H
+#define CHIP8PERFHUD_H
+
+#include <QObject>
+#include <QTimer>
+#include <QLabel>
+#include <chrono>
+#include <vector>
+
+#include "chip8.h"
+
+class Chip8GraphicsView;
+
+/**
+	On-screen performance overlay of the display area.
+
+	Twice a second the HUD reads the counters of the emulator
+	(\ref Chip8PerfCounters), the display backlog and the presentation counters
+	of \ref Chip8GraphicsView and shows the rates of the last interval. All
+	reads are relaxed atomic loads, the emulator thread is never locked.
+
+	Below the rates the key latency (\ref Chip8Latency) since the start is
+	shown as p50/p95/p99, in total and per stage, and with sound the
+	underruns, drops and latency of the audio ring (\ref Chip8Audio).
+*/
+class Chip8PerfHud : public QObject
+{
+	Q_OBJECT
+
+	public:
+		explicit Chip8PerfHud(CHIP8* aEmu, Chip8GraphicsView* aView, QWidget* aHost, QObject* parent = nullptr);	///< Constructor
+
+	public slots:
+		void Show(bool on);																							///< Switch the overlay on or off.
+
+	private slots:
+		void Update(void);																							///< Compute the rates of the last interval and show them.
+
+	private:
+		void sample(void);
+		QString latency(QString const& name, Chip8Histogram const& histogram);
+		QString sound(void);
+
+		CHIP8*									emu;			///< The emulator to watch.
+		Chip8GraphicsView*						view;			///< The display whose presentation is watched.
+		QLabel*									label;			///< The overlay.
+		QTimer									timer;			///< Refresh timer.
+		std::chrono::steady_clock::time_point	lastTime;		///< Time of the last sample.
+		uint64_t								lastInstructions;	///< Executed instructions at the last sample.
+		uint64_t								lastFrames;		///< Emulated frames at the last sample.
+		uint64_t								lastSleepNs;	///< Sleep time at the last sample.
+		uint64_t								lastExecNs;		///< Execution time at the last sample.
+		uint64_t								lastReceived;	///< Display updates received at the last sample.
+		uint64_t								lastPresented;	///< Presented frames at the last sample.
+		std::vector<uint64_t>					lastFrameTime;	///< Frame time histogram at the last sample.
+		std::vector<uint64_t>					frameTime;		///< Buffer for the current frame time histogram.
+		std::vector<uint64_t>					latencyCounts;	///< Buffer for a key latency histogram.
+};
+
+#endif // CHIP8PERFHUD_H
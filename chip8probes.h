@@ -0,0 +1,45 @@
+#ifndef CHIP8PROBES_H
+#define CHIP8PROBES_H
+
+/**
+	Static tracepoints (USDT) of the emulator, provider "chip8".
+
+	With <sys/sdt.h> (systemtap-sdt-dev, found by CMake as CHIP8_HAVE_SDT) each
+	probe is a single NOP in the code plus an ELF note that tells bpftrace,
+	perf or SystemTap where it is and where its arguments live. Nothing is
+	called and no memory is touched while no tool is attached. Without the
+	header the probes compile to nothing.
+
+	Probes and arguments:
+	- instruction(pc, op, M, SP)			before every executed instruction
+	- draw(pc, x, y, n, collision)			DRW, after the sprite was drawn
+	- key_wait_start(pc, reg)				Fx0A starts waiting for a key
+	- key_wait_end(pc, reg, key)			Fx0A got a key
+	- timer_tick(TD, TS)					60Hz timer tick
+	- frame(frame, instructions)			end of a 60Hz frame (present)
+	- stop(pc), step(pc), resume(pc)		Stop(), Step() and Continue()
+	- load(address, size, hash)				program loaded
+
+	The probes describe the emulated execution only: the speculative frames
+	of run-ahead (\ref CHIP8::run_ahead()) fire none of them, so counts are
+	the same with and without --run-ahead.
+
+	Example: bpftrace -e 'usdt:./Chip8Emu:chip8:draw { @[arg0] = count(); }'
+*/
+
+#ifdef CHIP8_HAVE_SDT
+#include <sys/sdt.h>
+#define CHIP8_PROBE1(name, a1)						DTRACE_PROBE1(chip8, name, a1)
+#define CHIP8_PROBE2(name, a1, a2)					DTRACE_PROBE2(chip8, name, a1, a2)
+#define CHIP8_PROBE3(name, a1, a2, a3)				DTRACE_PROBE3(chip8, name, a1, a2, a3)
+#define CHIP8_PROBE4(name, a1, a2, a3, a4)			DTRACE_PROBE4(chip8, name, a1, a2, a3, a4)
+#define CHIP8_PROBE5(name, a1, a2, a3, a4, a5)		DTRACE_PROBE5(chip8, name, a1, a2, a3, a4, a5)
+#else
+#define CHIP8_PROBE1(name, a1)						do {} while(0)
+#define CHIP8_PROBE2(name, a1, a2)					do {} while(0)
+#define CHIP8_PROBE3(name, a1, a2, a3)				do {} while(0)
+#define CHIP8_PROBE4(name, a1, a2, a3, a4)			do {} while(0)
+#define CHIP8_PROBE5(name, a1, a2, a3, a4, a5)		do {} while(0)
+#endif
+
+#endif // CHIP8PROBES_H
@@ -0,0 +1,203 @@
+#include <cstdio>
+#include <mutex>
+#include <algorithm>
+
+#include "chip8profiler.h"
+
+std::atomic<bool>				Chip8Profiler::enabled(false);
+thread_local Chip8Profiler::Owner	Chip8Profiler::mine		= {nullptr};
+thread_local char const*		Chip8Profiler::myName	= nullptr;
+
+/**
+	Protects the list of rings and the thread names. A function static, so a
+	scope in a static constructor finds it.
+*/
+std::mutex& Chip8Profiler::registry_mutex(void)
+{
+	static std::mutex mtx;
+	return mtx;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	\return All rings. A ring lives as long as the program, a dump may still
+	want the scopes of a thread that has ended.
+*/
+std::vector<Chip8Profiler::Ring*>& Chip8Profiler::rings(void)
+{
+	static std::vector<Ring*> all;
+	return all;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	\return The rings of ended threads, see \ref Owner.
+*/
+std::vector<Chip8Profiler::Ring*>& Chip8Profiler::free_rings(void)
+{
+	static std::vector<Ring*> unused;
+	return unused;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Destructor, runs when the thread ends: its ring can be reused.
+*/
+Chip8Profiler::Owner::~Owner()
+{
+	if(ring){
+		std::lock_guard<std::mutex> lock(registry_mutex());
+		free_rings().push_back(ring);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Starts or stops recording. The rings keep their contents when recording
+	stops, so they can be dumped afterwards.
+
+	\param	[in]	on	true to record scopes.
+*/
+void Chip8Profiler::enable(bool on)
+{
+	enabled.store(on, std::memory_order_relaxed);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	\return The ring of the calling thread, taken from the free list or
+	created on its first scope. A reused ring gets a new tid, so the ended
+	thread and the new one are not mixed up in the timeline.
+*/
+Chip8Profiler::Ring* Chip8Profiler::ring(void)
+{
+	static unsigned int	threads	= 0;
+
+	if(!mine.ring){
+		std::lock_guard<std::mutex> lock(registry_mutex());
+		Ring* r = nullptr;
+		if(!free_rings().empty()){
+			r = free_rings().back();
+			free_rings().pop_back();
+		} else {
+			r = new Ring();
+			r->events.resize(RING_EVENTS);
+			rings().push_back(r);
+		}
+		r->written.store(0, std::memory_order_relaxed);		// drops the scopes of the ended thread
+		r->name = myName ? myName : "";
+		r->tid = ++threads;
+		mine.ring = r;
+	}
+	return mine.ring;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Names the calling thread in the timeline of \ref dump(). Threads without
+	a name are shown as "thread <n>". The ring is only created with the
+	first scope, a named thread costs no memory while profiling is off.
+
+	\param	[in]	name	Static name of the thread.
+*/
+void Chip8Profiler::thread_name(char const* name)
+{
+	myName = name;
+	if(mine.ring){
+		std::lock_guard<std::mutex> lock(registry_mutex());
+		mine.ring->name = name;
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Stores a finished scope in the ring of the calling thread, overwriting
+	the oldest one if the ring is full. Only called while \ref on().
+
+	\param	[in]	name	Static name of the scope.
+	\param	[in]	startNs	Start (\ref now()).
+	\param	[in]	endNs	End (\ref now()).
+*/
+void Chip8Profiler::record(char const* name, int64_t startNs, int64_t endNs)
+{
+	Ring*		r	= ring();
+	uint64_t	n	= r->written.load(std::memory_order_relaxed);
+	Event&		e	= r->events[n % RING_EVENTS];
+
+	e.name		= name;
+	e.start		= startNs;
+	e.duration	= endNs - startNs;
+	r->written.store(n + 1, std::memory_order_release);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Writes the scopes of all threads that ended in the last windowMs as
+	Chrome trace-event JSON ("X" events, times in µs from the first scope of
+	the window). Can be called from any thread while the others keep
+	recording: a ring is copied first, scopes the owner may have
+	overwritten meanwhile are left out.
+
+	\param	[in]	filename	Name of the JSON file.
+	\param	[in]	windowMs	Length of the window, 0 for everything in the rings.
+	\return false if the file couldn't be written.
+*/
+bool Chip8Profiler::dump(std::string const& filename, unsigned int windowMs)
+{
+	struct Copy {
+		unsigned int		tid;
+		std::string			name;
+		std::vector<Event>	events;
+	};
+	std::vector<Copy>	copies;
+	int64_t				from	= windowMs ? now() - static_cast<int64_t>(windowMs) * 1000000 : INT64_MIN;
+	int64_t				base	= INT64_MAX;
+
+	{
+		std::lock_guard<std::mutex> lock(registry_mutex());
+		for(Ring* r : rings()){
+			Copy		c;
+			uint64_t	end		= r->written.load(std::memory_order_acquire);
+			uint64_t	begin	= (end > RING_EVENTS) ? end - RING_EVENTS : 0;
+			c.tid	= r->tid;
+			c.name	= r->name;
+			c.events.reserve(static_cast<size_t>(end - begin));
+			for(uint64_t n = begin; n < end; ++n){
+				c.events.push_back(r->events[n % RING_EVENTS]);
+			}
+			uint64_t	after	= r->written.load(std::memory_order_acquire);
+			uint64_t	valid	= (after + 1 > RING_EVENTS) ? after + 1 - RING_EVENTS : 0;		// the slot of event "after" may be half written
+			if(valid > begin){
+				c.events.erase(c.events.begin(), c.events.begin() + static_cast<ptrdiff_t>(std::min(valid, end) - begin));
+			}
+			c.events.erase(std::remove_if(c.events.begin(), c.events.end(), [from](Event const& e){
+				return e.start + e.duration < from;
+			}), c.events.end());
+			for(Event const& e : c.events){
+				base = std::min(base, e.start);
+			}
+			copies.push_back(c);
+		}
+	}
+
+	FILE* f = fopen(filename.c_str(), "w");
+	if(!f){
+		return false;
+	}
+	fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Chip8Emu\"}}");
+	for(Copy const& c : copies){
+		if(c.name.empty()){
+			fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}", c.tid, c.tid);
+		} else {
+			fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", c.tid, c.name.c_str());
+		}
+		for(Event const& e : c.events){
+			fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				e.name, c.tid, static_cast<double>(e.start - base) / 1000.0, static_cast<double>(e.duration) / 1000.0);
+		}
+	}
+	fprintf(f, "\n]}\n");
+	return (0 == fclose(f));
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,125 @@
+#ifndef CHIP8PROFILER_H
+#define CHIP8PROFILER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+/**
+	Host-side timing of the emulator: where does the time of the emulator
+	thread, the user interface and the timer thread go?
+
+	Instrumented code marks scopes with \ref CHIP8_PROFILE("name"). Every
+	thread writes its scopes into a ring buffer of its own (no lock, no
+	allocation after the first scope of the thread), so the newest
+	\ref RING_EVENTS scopes of every thread are always available. When a
+	thread ends its ring goes to a free list and is handed to the next new
+	thread, so short-lived threads (e.g. thumbnail workers) don't add a ring
+	each; the scopes of an ended thread stay in the dump until then.
+	\ref dump() writes a time window of all rings as Chrome trace-event
+	JSON, which Perfetto (ui.perfetto.dev) and chrome://tracing show as one
+	timeline per thread.
+
+	While profiling is off a scope costs one relaxed load and one branch on
+	entry and a test of a register on exit, the clock is not read.
+*/
+class Chip8Profiler
+{
+	public:
+		enum PROFILER_SIZES {
+			RING_EVENTS		= 64 * 1024		///< Scopes kept per thread.
+		};
+
+		static bool		on(void)	{return enabled.load(std::memory_order_relaxed);}	///< Profiling is active.
+		static void		enable(bool on);												///< Start or stop recording.
+		static void		thread_name(char const* name);									///< Name of the calling thread in the timeline.
+		static void		record(char const* name, int64_t startNs, int64_t endNs);		///< Store one finished scope (calling thread).
+		static bool		dump(std::string const& filename, unsigned int windowMs = 0);	///< Write the last windowMs (0: all) as trace JSON.
+
+		/**
+			\return Nanoseconds of the steady clock, the time base of \ref record().
+		*/
+		static int64_t now(void)
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		/**
+			\return t in nanoseconds of the steady clock.
+		*/
+		static int64_t ns(std::chrono::steady_clock::time_point t)
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+		}
+
+	private:
+		struct Event {
+			char const*		name;				///< Static name of the scope.
+			int64_t			start;				///< Start in ns (steady clock).
+			int64_t			duration;			///< Duration in ns.
+		};
+
+		struct Ring {
+			std::vector<Event>		events;		///< RING_EVENTS entries, written round robin.
+			std::atomic<uint64_t>	written;	///< Events written so far, published after the event.
+			std::string				name;		///< Thread name (empty: "thread <tid>").
+			unsigned int			tid;		///< Number of the thread in the trace.
+		};
+
+		/**
+			Owns the ring of a thread and returns it to the free list when
+			the thread ends.
+		*/
+		struct Owner {
+			Ring*	ring;						///< Ring of the thread (nullptr: no scope yet).
+			~Owner();
+		};
+
+		static Ring*				ring(void);
+		static std::mutex&			registry_mutex(void);
+		static std::vector<Ring*>&	rings(void);
+		static std::vector<Ring*>&	free_rings(void);
+
+		static std::atomic<bool>		enabled;	///< See \ref on().
+		static thread_local Owner		mine;		///< Ring of the thread.
+		static thread_local char const*	myName;		///< Name of the thread (\ref thread_name()).
+};
+
+/**
+	Times the enclosing scope under a static name, see \ref CHIP8_PROFILE.
+*/
+class Chip8ProfileScope
+{
+	public:
+		explicit Chip8ProfileScope(char const* aName)
+		: name(aName), start(Chip8Profiler::on() ? Chip8Profiler::now() : 0)
+		{
+		}
+
+		~Chip8ProfileScope()
+		{
+			if(start){
+				Chip8Profiler::record(name, start, Chip8Profiler::now());
+			}
+		}
+
+	private:
+		Chip8ProfileScope(Chip8ProfileScope const&);
+		Chip8ProfileScope& operator=(Chip8ProfileScope const&);
+
+		char const*		name;					///< Name of the scope.
+		int64_t			start;					///< Start in ns, 0 if profiling was off.
+};
+
+#define CHIP8_PROFILE_JOIN2(a, b)	a##b
+#define CHIP8_PROFILE_JOIN(a, b)	CHIP8_PROFILE_JOIN2(a, b)
+
+/**
+	Times the rest of the enclosing block as name (a string literal).
+*/
+#define CHIP8_PROFILE(name)			Chip8ProfileScope CHIP8_PROFILE_JOIN(chip8ProfileScope, __LINE__)(name)
+
+#endif // CHIP8PROFILER_H
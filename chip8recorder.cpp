@@ -0,0 +1,392 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "chip8recorder.h"
+
+/**
+	Constructor, opens the output file and starts the writer thread.
+
+	\param	[in]	filename	Name of the output file, "-" writes to stdout.
+	\param	[in]	aFormat		Output format.
+	\param	[in]	aScale		Size of a CHIP8 pixel in the Y4M and GIF output.
+	\param	[in]	queueSize	Number of frames that may wait for the writer.
+*/
+Chip8Recorder::Chip8Recorder(std::string const& filename, FORMAT aFormat, unsigned int aScale, size_t queueSize)
+: out(nullptr), format(aFormat), scale(aScale ? aScale : 1), outWidth(0), outHeight(0), started(false), lossless(false), pendingNumber(0)
+, queue(queueSize), running(true), framesWritten(0), framesDropped(0)
+{
+	if("-" == filename){
+		out = stdout;
+	} else if((out = fopen(filename.c_str(), "wb")) == nullptr){
+		std::cerr << "-E- Chip8Recorder: couldn't open <" << filename << ">" << std::endl;
+		return;
+	}
+	writerThread = std::thread(&Chip8Recorder::writer, this);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Destructor, lets the writer thread write all frames still in the queue,
+	completes the file and closes it.
+*/
+Chip8Recorder::~Chip8Recorder()
+{
+	running.store(false);
+	if(writerThread.joinable()){
+		writerThread.join();
+	}
+	if(out && (stdout != out)){
+		fclose(out);
+	} else if(out){
+		fflush(out);
+	}
+	if(framesDropped.load()){
+		std::cerr << "-W- Chip8Recorder: " << framesDropped.load() << " frames dropped" << std::endl;
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Translates a format name into a \ref FORMAT.
+	\return false if the name is unknown.
+*/
+bool Chip8Recorder::parse_format(std::string const& name, FORMAT& format)
+{
+	if("y4m" == name){
+		format = FORMAT_Y4M;
+	} else if("gif" == name){
+		format = FORMAT_GIF;
+	} else if("rle" == name){
+		format = FORMAT_RLE;
+	} else {
+		return false;
+	}
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Guesses the output format from the extension of the file name. Anything
+	unknown (including stdout) is recorded as Y4M.
+*/
+Chip8Recorder::FORMAT Chip8Recorder::format_from_filename(std::string const& filename)
+{
+	FORMAT		format	= FORMAT_Y4M;
+	size_t		dot		= filename.rfind('.');
+
+	if(std::string::npos != dot){
+		parse_format(filename.substr(dot+1), format);
+	}
+	return format;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Queues a frame for the writer thread. This is called from the emulator
+	thread and never blocks: if the queue is full the frame is dropped. A
+	lossless recorder waits until the writer made room.
+*/
+void Chip8Recorder::push(Chip8Frame const& frame)
+{
+	if(!out){
+		framesDropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	while(!queue.push(frame)){
+		if(!lossless){
+			framesDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		std::this_thread::yield();
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	The writer thread. Polls the queue and writes all frames, after the
+	recorder was told to stop it drains the queue and completes the file.
+*/
+void Chip8Recorder::writer(void)
+{
+	Chip8Frame frame;
+
+	while(running.load()){
+		if(queue.pop(frame)){
+			write_frame(frame);
+		} else {
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+	}
+	while(queue.pop(frame)){
+		write_frame(frame);
+	}
+	finish();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Writes one frame in the selected format. The first frame fixes the
+	size of the video.
+*/
+void Chip8Recorder::write_frame(Chip8Frame const& frame)
+{
+	if(!started){
+		outWidth	= frame.width * scale;
+		outHeight	= frame.height * scale;
+	}
+	switch(format){
+		case FORMAT_Y4M:	write_y4m(frame);
+							break;
+		case FORMAT_GIF:	write_gif(frame);
+							break;
+		case FORMAT_RLE:	write_rle(frame);
+							break;
+	}
+	started = true;
+	framesWritten.fetch_add(1, std::memory_order_relaxed);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Scales a frame to the video size into \ref pixels. Frames with a different
+	resolution than the first one (mode switch) are stretched to fit.
+*/
+void Chip8Recorder::render(Chip8Frame const& frame)
+{
+	pixels.resize(outWidth * outHeight);
+	for(unsigned int oy = 0; oy < outHeight; ++oy){
+		unsigned int y = oy * frame.height / outHeight;
+		for(unsigned int ox = 0; ox < outWidth; ++ox){
+			pixels[oy*outWidth + ox] = frame.pixel(ox * frame.width / outWidth, y);
+		}
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Y4M: one grey plane per frame. Frames that were dropped are replaced by
+	the previous frame, so the timing of the video stays correct.
+*/
+void Chip8Recorder::write_y4m(Chip8Frame const& frame)
+{
+	if(!started){
+		fprintf(out, "YUV4MPEG2 W%u H%u F60:1 Ip A1:1 Cmono\n", outWidth, outHeight);
+	} else {
+		for(uint64_t n = previous.number + 1; (n < frame.number) && (n < previous.number + 600); ++n){
+			fputs("FRAME\n", out);
+			fwrite(pixels.data(), 1, pixels.size(), out);
+		}
+	}
+	render(frame);
+	for(auto& p : pixels){
+		p = p ? 0x00 : 0xff;									// black pixel on white background
+	}
+	fputs("FRAME\n", out);
+	fwrite(pixels.data(), 1, pixels.size(), out);
+	previous.number = frame.number;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	GIF: a frame is only written when the next different frame arrives, so
+	a static screen results in a single image with a long delay.
+*/
+void Chip8Recorder::write_gif(Chip8Frame const& frame)
+{
+	if(!started){
+		static const unsigned char netscape[] = {0x21, 0xff, 0x0b, 'N','E','T','S','C','A','P','E','2','.','0', 0x03, 0x01, 0x00, 0x00, 0x00};
+		fputs("GIF89a", out);
+		put_u16(outWidth);
+		put_u16(outHeight);
+		fputc(0x80, out);										// global color table with 2 entries
+		fputc(0x00, out);										// background color
+		fputc(0x00, out);										// pixel aspect ratio
+		fwrite("\xff\xff\xff\x00\x00\x00", 1, 6, out);			// color 0 = white, color 1 = black
+		fwrite(netscape, 1, sizeof(netscape), out);				// loop forever
+	} else if(frame == previous){
+		return;													// still the same image -> just extend its delay
+	} else {
+		write_gif_image(frame.number - pendingNumber);
+	}
+	previous		= frame;
+	pendingNumber	= frame.number;
+	render(frame);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Writes the pending GIF image (stored in \ref pixels) LZW compressed.
+
+	\param	[in]	duration	Display time of the image in 60Hz frames.
+*/
+void Chip8Recorder::write_gif_image(uint64_t duration)
+{
+	std::vector<int16_t>	dict(4096*4, -1);					// (prefix code, pixel) -> code
+	std::vector<uint8_t>	data;
+	unsigned int			codeSize	= 3;
+	int						nextCode	= 6;
+	uint32_t				bits		= 0;
+	unsigned int			bitCount	= 0;
+	auto emit_code = [&](int code){
+		bits		|= static_cast<uint32_t>(code) << bitCount;
+		bitCount	+= codeSize;
+		while(bitCount >= 8){
+			data.push_back(bits & 0xff);
+			bits		>>= 8;
+			bitCount	-= 8;
+		}
+	};
+	unsigned int delay = static_cast<unsigned int>(((pendingNumber + duration) * 100 / 60) - (pendingNumber * 100 / 60));
+
+	fwrite("\x21\xf9\x04\x00", 1, 4, out);						// graphic control extension
+	put_u16(delay ? delay : 1);									// delay in 1/100 s
+	fwrite("\x00\x00", 1, 2, out);
+	fputc(0x2c, out);											// image descriptor
+	put_u16(0);
+	put_u16(0);
+	put_u16(outWidth);
+	put_u16(outHeight);
+	fputc(0x00, out);
+	fputc(0x02, out);											// LZW minimum code size
+
+	emit_code(4);												// clear code
+	int prefix = pixels[0];
+	for(size_t i = 1; i < pixels.size(); ++i){
+		int k		= pixels[i];
+		int code	= dict[prefix*4 + k];
+		if(code >= 0){
+			prefix = code;
+			continue;
+		}
+		emit_code(prefix);
+		if((nextCode >= (1 << codeSize)) && (codeSize < 12)){
+			++codeSize;
+		}
+		if(nextCode < 4096){
+			dict[prefix*4 + k] = static_cast<int16_t>(nextCode++);
+		} else {												// dictionary full -> start over
+			emit_code(4);
+			std::fill(dict.begin(), dict.end(), -1);
+			nextCode	= 6;
+			codeSize	= 3;
+		}
+		prefix = k;
+	}
+	emit_code(prefix);
+	if((nextCode >= (1 << codeSize)) && (codeSize < 12)){
+		++codeSize;
+	}
+	emit_code(5);												// end of information
+	if(bitCount){
+		data.push_back(bits & 0xff);
+	}
+	for(size_t pos = 0; pos < data.size(); pos += 255){			// data sub-blocks
+		size_t len = std::min<size_t>(255, data.size() - pos);
+		fputc(static_cast<int>(len), out);
+		fwrite(data.data() + pos, 1, len, out);
+	}
+	fputc(0x00, out);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	RLE: the own compact format. The file starts with "C8RL" and a version byte,
+	followed by records:
+	- 0x01 width height				Resolution (varints), resets the reference frame to blank.
+	- 0x02 delta length payload		Frame: number delta to the previous frame and
+									payload length (varints), followed by the payload.
+
+	The payload is the XOR of the packed frame rows (width/8 bytes per row, MSB
+	is the leftmost pixel) with the previous frame, coded as pairs of
+	(varint skip, varint count, count literal bytes). Unchanged bytes at the
+	end are omitted, so an unchanged frame has an empty payload.
+*/
+void Chip8Recorder::write_rle(Chip8Frame const& frame)
+{
+	std::vector<uint8_t> buf;
+
+	if(!started){
+		fwrite("C8RL\x01", 1, 5, out);
+	}
+	if(!started || (frame.width != previous.width) || (frame.height != previous.height)){
+		buf.push_back(0x01);
+		put_varint(frame.width, buf);
+		put_varint(frame.height, buf);
+		uint64_t number	= previous.number;
+		previous		= Chip8Frame(frame.width, frame.height);
+		previous.number	= started ? number : frame.number;
+	}
+
+	std::vector<uint8_t>	payload;
+	std::vector<uint8_t>	delta;
+	unsigned int			bytesPerRow = frame.width / 8;
+	for(unsigned int y = 0; y < frame.height; ++y){
+		for(unsigned int b = 0; b < bytesPerRow; ++b){
+			unsigned int shift = 56 - 8*(b & 7);
+			delta.push_back(((frame.rows[y][b >> 3] ^ previous.rows[y][b >> 3]) >> shift) & 0xff);
+		}
+	}
+	size_t pos = 0;
+	while(pos < delta.size()){
+		size_t skip = 0;
+		while((pos + skip < delta.size()) && (0 == delta[pos + skip])){
+			++skip;
+		}
+		if(pos + skip == delta.size()){
+			break;												// nothing changed anymore
+		}
+		size_t count = 0;
+		while((pos + skip + count < delta.size()) && (0 != delta[pos + skip + count])){
+			++count;
+		}
+		put_varint(skip, payload);
+		put_varint(count, payload);
+		payload.insert(payload.end(), delta.begin() + pos + skip, delta.begin() + pos + skip + count);
+		pos += skip + count;
+	}
+
+	buf.push_back(0x02);
+	put_varint(frame.number - previous.number, buf);
+	put_varint(payload.size(), buf);
+	buf.insert(buf.end(), payload.begin(), payload.end());
+	fwrite(buf.data(), 1, buf.size(), out);
+	previous = frame;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Completes the file after the last frame.
+*/
+void Chip8Recorder::finish(void)
+{
+	if(started && (FORMAT_GIF == format)){
+		write_gif_image(1);										// the last image is shown for one frame
+		fputc(0x3b, out);										// trailer
+	}
+	fflush(out);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Writes a 16-bit value little endian (GIF byte order).
+*/
+void Chip8Recorder::put_u16(unsigned int value)
+{
+	fputc(value & 0xff, out);
+	fputc((value >> 8) & 0xff, out);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Appends an unsigned LEB128 varint to a buffer.
+*/
+void Chip8Recorder::put_varint(uint64_t value, std::vector<uint8_t>& buf)
+{
+	while(value >= 0x80){
+		buf.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	buf.push_back(static_cast<uint8_t>(value));
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,72 @@
+#ifndef CHIP8RECORDER_H
+#define CHIP8RECORDER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "chip8frame.h"
+#include "chip8spscqueue.h"
+
+/**
+	Records completed frames of the emulator display to a file.
+
+	The emulator thread hands every frame to \ref push(), which only copies it
+	into a lock-free queue. A separate writer thread encodes and writes the
+	frames, so the emulation never waits for the disk. If the writer falls behind
+	and the queue is full, the frame is dropped and counted, unless the
+	recorder is \ref set_lossless() (headless runs that are faster than the
+	writer wait for it instead).
+*/
+class Chip8Recorder
+{
+	public:
+		enum FORMAT {
+			FORMAT_Y4M	= 0,		///< Raw YUV4MPEG2 video (grey), can be piped into ffmpeg.
+			FORMAT_GIF	= 1,		///< Animated GIF, identical frames are merged.
+			FORMAT_RLE	= 2			///< Own compact format: XOR delta to the previous frame, run-length coded.
+		};
+
+		Chip8Recorder(std::string const& filename, FORMAT aFormat, unsigned int aScale = 4, size_t queueSize = 256);	///< Constructor, "-" writes to stdout.
+		~Chip8Recorder();																								///< Writes all queued frames and closes the file.
+		bool		ok(void) const			{return nullptr != out;}								///< Output could be opened.
+		void		push(Chip8Frame const& frame);													///< Queue a frame for writing (blocks only if lossless).
+		void		set_lossless(bool on)	{lossless = on;}										///< \ref push() waits for the writer instead of dropping.
+		uint64_t	written(void) const		{return framesWritten.load(std::memory_order_relaxed);}	///< Number of frames written.
+		uint64_t	dropped(void) const		{return framesDropped.load(std::memory_order_relaxed);}	///< Number of frames lost because the queue was full.
+
+		static bool	parse_format(std::string const& name, FORMAT& format);		///< Translate "y4m", "gif" or "rle".
+		static FORMAT format_from_filename(std::string const& filename);		///< Guess the format from the file extension.
+
+	private:
+		void writer(void);
+		void write_frame(Chip8Frame const& frame);
+		void write_y4m(Chip8Frame const& frame);
+		void write_gif(Chip8Frame const& frame);
+		void write_gif_image(uint64_t duration);
+		void write_rle(Chip8Frame const& frame);
+		void finish(void);
+		void render(Chip8Frame const& frame);
+		void put_u16(unsigned int value);
+		void put_varint(uint64_t value, std::vector<uint8_t>& buf);
+
+		FILE*						out;				///< Output file.
+		FORMAT						format;				///< Output format.
+		unsigned int				scale;				///< Size of one CHIP8 pixel in the video (Y4M and GIF).
+		unsigned int				outWidth;			///< Width of the video, fixed by the first frame.
+		unsigned int				outHeight;			///< Height of the video, fixed by the first frame.
+		bool						started;			///< The header has been written.
+		bool						lossless;			///< See \ref set_lossless().
+		Chip8Frame					previous;			///< The frame written last (RLE delta reference, pending GIF image).
+		uint64_t					pendingNumber;		///< Frame number when the pending GIF image was first shown.
+		std::vector<uint8_t>		pixels;				///< Scaled image, one byte per pixel (1 = on).
+		Chip8SpscQueue<Chip8Frame>	queue;				///< Frames waiting for the writer thread.
+		std::atomic<bool>			running;			///< Cleared to make the writer finish.
+		std::atomic<uint64_t>		framesWritten;		///< Statistics: frames written.
+		std::atomic<uint64_t>		framesDropped;		///< Statistics: frames dropped.
+		std::thread					writerThread;		///< The writer thread.
+};
+
+#endif // CHIP8RECORDER_H
@@ -0,0 +1,78 @@
+#ifndef CHIP8SEQLOCK_H
+#define CHIP8SEQLOCK_H
+
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+
+/**
+	Sequence lock for one writer and any number of readers.
+
+	The writer never waits. A reader copies the value and retries if the writer
+	was active in the meantime (odd or changed sequence number). The value is
+	kept in atomic words, so a torn copy is never undefined behaviour, it's
+	only thrown away. T must be trivially copyable.
+*/
+template<class T>
+class Chip8SeqLock
+{
+	public:
+		Chip8SeqLock() : seq(0)
+		{
+			T	value = T();
+			store(value);
+		}
+
+		/**
+			Publishes a new value. Must only be called from one thread.
+		*/
+		void store(T const& value)
+		{
+			uint64_t	buf[WORDS] = {0};
+			unsigned	s = seq.load(std::memory_order_relaxed);
+
+			memcpy(buf, &value, sizeof(T));
+			seq.store(s + 1, std::memory_order_relaxed);				// odd: write in progress
+			std::atomic_thread_fence(std::memory_order_release);
+			for(unsigned int i = 0; i < WORDS; ++i){
+				data[i].store(buf[i], std::memory_order_relaxed);
+			}
+			seq.store(s + 2, std::memory_order_release);
+		}
+
+		/**
+			Reads a consistent copy of the last published value.
+
+			\param	[out]	value	The copy.
+			\param	[in]	retries	Number of attempts before giving up.
+			\return false if the writer was busy during all attempts.
+		*/
+		bool load(T& value, unsigned int retries = 16) const
+		{
+			uint64_t	buf[WORDS];
+
+			while(retries--){
+				unsigned s1 = seq.load(std::memory_order_acquire);
+				if(s1 & 1){
+					continue;
+				}
+				for(unsigned int i = 0; i < WORDS; ++i){
+					buf[i] = data[i].load(std::memory_order_relaxed);
+				}
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if(s1 == seq.load(std::memory_order_relaxed)){
+					memcpy(&value, buf, sizeof(T));
+					return true;
+				}
+			}
+			return false;
+		}
+
+	private:
+		enum {WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t)};
+
+		std::atomic<unsigned>	seq;				///< Sequence number, odd while a write is in progress.
+		std::atomic<uint64_t>	data[WORDS];		///< The value.
+};
+
+#endif // CHIP8SEQLOCK_H
@@ -0,0 +1,69 @@
+#ifndef CHIP8SNAPSHOT_H
+#define CHIP8SNAPSHOT_H
+
+#include <cstdint>
+
+#include "chip8frame.h"
+
+#define SNAPSHOT_VM_SIZE	8192		///< Same as VM_SIZE of chip8.h.
+#define SNAPSHOT_ADDR_SPACE	0x1000		///< Range of M (MSK_ADDR of chip8.h + 1).
+
+/**
+	Complete machine state of a session as written to disk by
+	\ref CHIP8::save_snapshot(). The file is exactly one instance of this
+	struct, so \ref CHIP8::restore_snapshot() maps it and copies the parts
+	back without any parsing.
+
+	The snapshot is only restored if magic, version and size match, if it
+	belongs to the same program (FNV-1a hash of the program file, see
+	\ref CHIP8::program_hash()) and if its addresses are \ref consistent().
+	Increment SNAPSHOT_VERSION whenever the layout changes.
+*/
+struct Chip8Snapshot
+{
+	enum SNAPSHOT_ID {
+		SNAPSHOT_MAGIC		= 0x4e533843,	///< "C8SN" (little endian).
+		SNAPSHOT_VERSION	= 2				///< Layout version.
+	};
+
+	uint32_t	magic;						///< \ref SNAPSHOT_MAGIC.
+	uint32_t	version;					///< \ref SNAPSHOT_VERSION.
+	uint64_t	romHash;					///< Hash of the program file.
+	uint32_t	mode;						///< CHIP8::EMULATION_MODE.
+	uint16_t	loadAddress;				///< Address the program was loaded to.
+	uint16_t	programSize;				///< Size of the program in byte.
+	uint16_t	PC;							///< Program counter.
+	uint16_t	I;							///< Instruction register.
+	uint16_t	M;							///< Memory register.
+	uint16_t	SP;							///< Stack pointer.
+	uint32_t	rng;						///< State of the random generator (Cxnn).
+	uint16_t	Stack[16];					///< The stack.
+	uint8_t		V[16];						///< Registers V0 - Vf.
+	uint8_t		TD;							///< Delay timer.
+	uint8_t		TS;							///< Sound timer.
+	uint8_t		running;					///< The program was running (not halted or stopped).
+	uint8_t		pad;
+	char		keyMap[16];					///< Host key of every CHIP8 key.
+	Chip8Frame	frame;						///< The display.
+	uint8_t		ram[SNAPSHOT_VM_SIZE];		///< The memory.
+
+	/**
+		\return true if all addresses of the snapshot lie in the memory, so a
+		corrupt or edited file can't make the emulator read past it.
+	*/
+	bool consistent(void) const
+	{
+		if((PC > SNAPSHOT_VM_SIZE - 2) || (M >= SNAPSHOT_ADDR_SPACE) || (SP > 0x0f)
+			|| (static_cast<uint32_t>(loadAddress) + programSize > SNAPSHOT_VM_SIZE)){
+			return false;
+		}
+		for(unsigned int i = 0; i < 16; ++i){
+			if(Stack[i] > SNAPSHOT_VM_SIZE - 2){
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+#endif // CHIP8SNAPSHOT_H
@@ -0,0 +1,85 @@
+#ifndef CHIP8SPSCQUEUE_H
+#define CHIP8SPSCQUEUE_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+/**
+	Bounded lock-free queue for exactly one producer and one consumer thread.
+
+	All storage is allocated in the constructor, \ref push() and \ref pop() never
+	allocate, block or take a lock. The capacity is rounded up to a power of two.
+	Head and tail are padded onto separate cache lines so producer and consumer
+	don't invalidate each other's line on every operation.
+*/
+template<class T>
+class Chip8SpscQueue
+{
+	public:
+		explicit Chip8SpscQueue(size_t aCapacity)
+		: mask(round_up(aCapacity) - 1), buffer(mask + 1), head(0), tail(0)
+		{
+		}
+
+		/**
+			Appends an element (producer side).
+			\return false if the queue is full, the element is not stored.
+		*/
+		bool push(T const& value)
+		{
+			size_t t = tail.load(std::memory_order_relaxed);
+			if((t - head.load(std::memory_order_acquire)) > mask){
+				return false;
+			}
+			buffer[t & mask] = value;
+			tail.store(t + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+			Removes the oldest element (consumer side).
+			\return false if the queue is empty.
+		*/
+		bool pop(T& value)
+		{
+			size_t h = head.load(std::memory_order_relaxed);
+			if(h == tail.load(std::memory_order_acquire)){
+				return false;
+			}
+			value = buffer[h & mask];
+			head.store(h + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+			Current fill level. Exact only if neither side is active, but can be
+			read from any thread (e.g. for statistics).
+		*/
+		size_t size(void) const
+		{
+			size_t h = head.load(std::memory_order_acquire);		// read head first, so tail can't be older than head
+			return tail.load(std::memory_order_acquire) - h;
+		}
+
+		size_t capacity(void) const	{return mask + 1;}			///< Maximum number of elements.
+
+	private:
+		static size_t round_up(size_t n)
+		{
+			size_t c = 1;
+			while(c < n){
+				c <<= 1;
+			}
+			return c;
+		}
+
+		size_t						mask;			///< capacity - 1
+		std::vector<T>				buffer;			///< The elements.
+		char						pad0[64];		///< Keep head and tail on separate cache lines.
+		std::atomic<size_t>			head;			///< Next element to read (written by the consumer only).
+		char						pad1[64];
+		std::atomic<size_t>			tail;			///< Next element to write (written by the producer only).
+};
+
+#endif // CHIP8SPSCQUEUE_H
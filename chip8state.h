@@ -0,0 +1,25 @@
+#ifndef CHIP8STATE_H
+#define CHIP8STATE_H
+
+#include <sys/types.h>
+
+/**
+	Snapshot of the CPU state that the emulator publishes for the user interface
+	(see \ref CHIP8::state()).
+*/
+struct Chip8State
+{
+	u_int64_t	serial;				///< Incremented with every snapshot, unchanged means nothing to redraw.
+	u_int64_t	frame;				///< Number of 60Hz frames since the program was started.
+	u_int16_t	PC;					///< Program counter.
+	u_int16_t	I;					///< Current instruction.
+	u_int16_t	M;					///< Memory register.
+	u_int16_t	SP;					///< Stack pointer.
+	u_int16_t	Stack[16];			///< Stack contents.
+	u_int8_t	V[16];				///< Registers V0 - Vf.
+	u_int8_t	TD;					///< Delay timer.
+	u_int8_t	TS;					///< Sound timer.
+	bool		halted;				///< The program is stopped (single-step mode).
+};
+
+#endif // CHIP8STATE_H
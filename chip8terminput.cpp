@@ -0,0 +1,141 @@
+#include <chrono>
+#include <cctype>
+
+#include <unistd.h>			// read(), isatty()
+
+#include "chip8terminput.h"
+
+/**
+	Constructor of the terminal key source. It switches stdin into raw mode
+	(no line buffering, no echo, no signal keys) and watches it for input.
+
+	A terminal only delivers characters, but no key-release events. A key
+	therefore counts as pressed for \ref holdTime ms after its last character
+	arrived. The auto-repeat of the terminal keeps a held key alive. The same
+	rule drives the key mask of the keyboard: a key is reported down with its
+	first character and up when \ref releaseTimer expires or another key
+	arrives (a terminal repeats only one key).
+
+	\param	[in]	aHoldTime	Time in ms a key stays pressed after the last character.
+	\param	[in]	parent		Parent object.
+*/
+Chip8TermInput::Chip8TermInput(int aHoldTime, QObject* parent)
+: QObject(parent), notifier(nullptr), rawMode(false), holdTime(aHoldTime)
+, currentKey(KEY_SOURCE_NO_KEY), pressTime(0), pressCount(0), closed(false)
+{
+	if(isatty(STDIN_FILENO) && (0 == tcgetattr(STDIN_FILENO, &savedTermios))){
+		struct termios raw = savedTermios;
+		raw.c_lflag &= ~(ICANON | ECHO | ISIG);			// we handle Ctrl-C ourselves to restore the terminal
+		raw.c_cc[VMIN]	= 0;
+		raw.c_cc[VTIME]	= 0;
+		rawMode = (0 == tcsetattr(STDIN_FILENO, TCSANOW, &raw));
+	}
+	notifier = new QSocketNotifier(STDIN_FILENO, QSocketNotifier::Read, this);
+	connect(notifier, &QSocketNotifier::activated, this, &Chip8TermInput::HandleInput);
+	releaseTimer.setSingleShot(true);
+	connect(&releaseTimer, &QTimer::timeout, this, [this]{AllKeysUp();});
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Destructor, restores the original terminal settings.
+*/
+Chip8TermInput::~Chip8TermInput()
+{
+	Close();
+	if(rawMode){
+		tcsetattr(STDIN_FILENO, TCSANOW, &savedTermios);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Returns a monotonic time stamp in ms.
+*/
+long long Chip8TermInput::now_ms(void)
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	This method implements the non-blocking read function.
+
+	\return	The last key if it was pressed within the last \ref holdTime ms or
+			\ref KEY_SOURCE_NO_KEY otherwise.
+*/
+int Chip8TermInput::ReadKey(void)
+{
+	if((now_ms() - pressTime.load(std::memory_order_acquire)) < holdTime){
+		return currentKey.load(std::memory_order_relaxed);
+	}
+	return KEY_SOURCE_NO_KEY;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	This method implements the blocking read function. It waits for the next
+	key press or until the input is closed.
+
+	\return The pressed key or \ref KEY_SOURCE_NO_KEY if the input was closed.
+*/
+int Chip8TermInput::GetKey(void)
+{
+	std::unique_lock<std::mutex> mlock(mtx);
+	unsigned long count = pressCount;
+	cond_var.wait(mlock, [this, count]{return closed || (pressCount != count);});
+
+	return closed ? static_cast<int>(KEY_SOURCE_NO_KEY) : currentKey.load(std::memory_order_relaxed);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Releases all threads that are blocked in \ref GetKey(). Must be called
+	before the emulator thread is joined.
+*/
+void Chip8TermInput::Close(void)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	closed = true;
+	cond_var.notify_all();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Reads all pending characters from stdin. Letters are translated to upper case,
+	which is what Qt reports as key code and what \ref Chip8Keyboard expects.
+	Escape sequences (cursor keys etc.) are ignored, Ctrl-C emits \ref Quit.
+
+	\param	[in]	fd	The file descriptor that has data (stdin).
+*/
+void Chip8TermInput::HandleInput(int fd)
+{
+	unsigned char	buf[64];
+	ssize_t			len = read(fd, buf, sizeof(buf));
+
+	if(len <= 0){
+		notifier->setEnabled(false);					// EOF: stdin is not a terminal anymore
+		return;
+	}
+	for(ssize_t i = 0; i < len; ++i){
+		if(0x03 == buf[i]){								// Ctrl-C
+			emit Quit();
+			return;
+		} else if(0x1b == buf[i]){						// skip the rest of an escape sequence
+			break;
+		} else if(isprint(buf[i])){
+			int key = toupper(buf[i]);
+			if(key != currentKey.load(std::memory_order_relaxed)){
+				AllKeysUp();
+			}
+			KeyDown(key);
+			releaseTimer.start(holdTime);
+			currentKey.store(key, std::memory_order_relaxed);
+			pressTime.store(now_ms(), std::memory_order_release);
+			std::lock_guard<std::mutex> guard(mtx);
+			++pressCount;
+			cond_var.notify_all();
+		}
+	}
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,49 @@
+#ifndef CHIP8TERMINPUT_H
+#define CHIP8TERMINPUT_H
+
+#include <QObject>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <termios.h>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "chip8keysource.h"
+
+class Chip8TermInput : public QObject, public Chip8KeySource
+{
+	Q_OBJECT
+
+	public:
+		explicit Chip8TermInput(int aHoldTime = 150, QObject* parent = nullptr);	///< Constructor, puts stdin into raw mode.
+		~Chip8TermInput() override;													///< Destructor, restores the terminal settings.
+		int ReadKey(void) override;													///< Non-blocking read (called from the emulator thread).
+		int GetKey(void) override;													///< Blocking read (called from the emulator thread).
+
+	signals:
+		void Quit(void);															///< The user pressed Ctrl-C.
+
+	public slots:
+		void Close(void);															///< Release all readers blocked in \ref GetKey().
+
+	private slots:
+		void HandleInput(int fd);													///< Read pending bytes from stdin.
+
+	private:
+		static long long now_ms(void);
+
+		QSocketNotifier*		notifier;		///< Notifies us about new bytes on stdin.
+		QTimer					releaseTimer;	///< Releases the key \ref holdTime ms after its last byte.
+		struct termios			savedTermios;	///< Terminal settings to restore on exit.
+		bool					rawMode;		///< Indicates whether we changed the terminal settings.
+		int						holdTime;		///< Time in ms a key counts as pressed after its last byte arrived.
+		std::atomic<int>		currentKey;		///< Last key that was pressed.
+		std::atomic<long long>	pressTime;		///< Time stamp (ms) of the last key press.
+		std::mutex				mtx;			///< Protects \ref pressCount for the blocking read.
+		std::condition_variable	cond_var;		///< Wakes up blocking readers on a key press.
+		unsigned long			pressCount;		///< Number of key presses seen so far.
+		bool					closed;			///< Blocking reads return immediately once set.
+};
+
+#endif // CHIP8TERMINPUT_H
@@ -0,0 +1,205 @@
+#include <unistd.h>			// write()
+
+#include "chip8termview.h"
+#include "chip8display.h"
+
+/**
+	The constructor of the terminal frontend. It switches the terminal to the
+	alternate screen, hides the cursor and reacts to the signals of the emulator
+	display the same way \ref Chip8GraphicsView does.
+
+	The terminal is refreshed with 60Hz. Only cells that changed since the last
+	refresh are sent, so a static screen costs no bandwidth at all.
+
+	\param	[in]	aDsp	The emulator display to show.
+	\param	[in]	aMode	Use half blocks (1x2 pixel per cell) or braille (2x4 pixel per cell).
+	\param	[in]	parent	Parent object.
+*/
+Chip8TermView::Chip8TermView(Chip8Display* aDsp, RENDER_MODE aMode, QObject* parent)
+: QObject(parent), dsp(aDsp), mode(aMode), width(0), height(0), cellWidth(1), cellHeight(2), cols(0), rows(0), dirty(false), received(0)
+{
+	if(RENDER_BRAILLE == mode){
+		cellWidth	= 2;
+		cellHeight	= 4;
+	}
+	write_out("\x1b[?1049h\x1b[?25l\x1b[2J");		// alternate screen, hide cursor, clear
+	Resize(CHIP8::WIN_COLS, CHIP8::WIN_ROWS);
+
+	connect(aDsp, &Chip8Display::DrawSprite,	this, &Chip8TermView::DrawSprite);	// receive signal from emulator display to draw a sprite
+	connect(aDsp, &Chip8Display::Clear,			this, &Chip8TermView::Clear);		// receive signal from emulator display to clear the screen
+	connect(aDsp, &Chip8Display::Resize,		this, &Chip8TermView::Resize);		// receive signal from emulator display to switch the display resolution
+
+	refresh = new QTimer(this);
+	connect(refresh, &QTimer::timeout, this, &Chip8TermView::Render);
+	refresh->start(16);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Destructor, gives the terminal back in its original state.
+*/
+Chip8TermView::~Chip8TermView()
+{
+	refresh->stop();
+	write_out("\x1b[0m\x1b[?25h\x1b[?1049l");		// reset attributes, show cursor, leave alternate screen
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Public slot that receives the \ref Resize signal from the emulator display class.
+
+	\param	[in]	aWidth	New X-resolution of the CHIP8 display.
+	\param	[in]	aHeight	New Y-resolution of the CHIP8 display.
+*/
+void Chip8TermView::Resize(unsigned int aWidth, unsigned int aHeight)
+{
+	width	= aWidth;
+	height	= aHeight;
+	cols	= (width + cellWidth - 1) / cellWidth;
+	rows	= (height + cellHeight - 1) / cellHeight;
+
+	display.width	= width;
+	display.height	= height;
+	display.clear();
+	cells.assign(cols * rows, -1);				// force a full redraw
+	write_out("\x1b[2J");
+	dirty = true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Public slot that receives the \ref Clear signal from the emulator display class.
+*/
+void Chip8TermView::Clear(void)
+{
+	dsp->delivered();
+	++received;
+	display.clear();
+	dirty = true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Public slot that receives the \ref DrawSprite signal from the emulator display class.
+	We only keep the display contents, drawing happens in \ref Render().
+
+	\param	[in]	frame	The display that is to be drawn.
+	\param	[in]	x		Not used.
+	\param	[in]	y		Not used.
+	\param	[in]	size	Not used.
+*/
+void Chip8TermView::DrawSprite(Chip8Frame const& frame, unsigned int x, unsigned int y, unsigned int size)
+{
+	Q_UNUSED(x)
+	Q_UNUSED(y)
+	Q_UNUSED(size)
+
+	dsp->delivered();
+	++received;
+	if(frame.width == width){
+		display = frame;
+		dirty = true;
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Computes the code of one terminal cell from the pixels it covers.
+	For half blocks bit 0 is the upper and bit 1 the lower pixel, for braille
+	the bits follow the unicode dot numbering (U+2800 + code).
+
+	\param	[in]	col	Terminal column.
+	\param	[in]	row	Terminal row.
+	\return	The cell code.
+*/
+unsigned int Chip8TermView::cell_code(unsigned int col, unsigned int row) const
+{
+	static const unsigned int braille_bit[4][2] = {{0x01, 0x08}, {0x02, 0x10}, {0x04, 0x20}, {0x40, 0x80}};
+	unsigned int code = 0;
+
+	for(unsigned int dy = 0; dy < cellHeight; ++dy){
+		unsigned int y = row*cellHeight + dy;
+		for(unsigned int dx = 0; dx < cellWidth; ++dx){
+			unsigned int x = col*cellWidth + dx;
+			if((x < width) && (y < height) && display.pixel(x, y)){
+				code |= (RENDER_BRAILLE == mode) ? braille_bit[dy][dx] : (1u << dy);
+			}
+		}
+	}
+	return code;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Appends the UTF-8 glyph of a cell code to the output buffer.
+*/
+void Chip8TermView::append_cell(std::string& out, unsigned int code) const
+{
+	static const char* half_block[4] = {" ", "\xe2\x96\x80", "\xe2\x96\x84", "\xe2\x96\x88"};
+
+	if(RENDER_BRAILLE == mode){
+		out += static_cast<char>(0xe2);
+		out += static_cast<char>(0xa0 | (code >> 6));
+		out += static_cast<char>(0x80 | (code & 0x3f));
+	} else {
+		out += half_block[code & 0x03];
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Timer slot that sends all cells that changed since the last refresh.
+	Runs of adjacent changed cells share one cursor positioning sequence and
+	the whole update is written with a single system call.
+*/
+void Chip8TermView::Render(void)
+{
+	if(!dirty){
+		return;
+	}
+	dirty = false;
+
+	std::string		out;
+	unsigned int	cursor = cols * rows;					// position of the terminal cursor (unknown)
+	char			pos[32];
+
+	for(unsigned int row = 0; row < rows; ++row){
+		for(unsigned int col = 0; col < cols; ++col){
+			unsigned int	idx		= row*cols + col;
+			int				code	= static_cast<int>(cell_code(col, row));
+			if(code == cells[idx]){
+				continue;									// cell didn't change -> don't bother
+			}
+			if(cursor != idx){								// move cursor only if we are not already there
+				snprintf(pos, sizeof(pos), "\x1b[%u;%uH", row+1, col+1);
+				out += pos;
+			}
+			append_cell(out, static_cast<unsigned int>(code));
+			cells[idx]	= code;
+			cursor		= idx + 1;
+		}
+		cursor = cols * rows;								// the cursor doesn't wrap into the next row
+	}
+	if(!out.empty()){
+		write_out(out);
+	}
+	dsp->latency().presented(received);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Writes a buffer completely to stdout.
+*/
+void Chip8TermView::write_out(std::string const& out)
+{
+	size_t done = 0;
+
+	while(done < out.size()){
+		ssize_t len = write(STDOUT_FILENO, out.data() + done, out.size() - done);
+		if(len <= 0){
+			break;
+		}
+		done += static_cast<size_t>(len);
+	}
+}
+//-----------------------------------------------------------------------------
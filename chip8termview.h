@@ -0,0 +1,54 @@
+#ifndef CHIP8TERMVIEW_H
+#define CHIP8TERMVIEW_H
+
+#include <QObject>
+#include <QTimer>
+#include <string>
+#include <vector>
+
+#include "chip8frame.h"
+
+class Chip8Display;
+
+class Chip8TermView : public QObject
+{
+	Q_OBJECT
+
+	public:
+		enum RENDER_MODE {
+			RENDER_HALF_BLOCK	= 0,	///< One cell covers 1x2 pixels (upper/lower half block).
+			RENDER_BRAILLE		= 1		///< One cell covers 2x4 pixels (braille dots).
+		};
+
+		explicit Chip8TermView(Chip8Display* aDsp, RENDER_MODE aMode = RENDER_HALF_BLOCK, QObject* parent = nullptr);	///< Constructor
+		~Chip8TermView() override;																						///< Destructor
+
+	public slots:
+		void Resize(unsigned int aWidth, unsigned int aHeight);														///< Changed display resolution.
+		void Clear(void);																							///< Clear the display.
+		void DrawSprite(Chip8Frame const& frame, unsigned int x, unsigned int y, unsigned int size);					///< Take over the new display contents.
+
+	private slots:
+		void Render(void);																							///< Send all changed cells to the terminal.
+
+	private:
+		unsigned int cell_code(unsigned int col, unsigned int row) const;
+		void append_cell(std::string& out, unsigned int code) const;
+		static void write_out(std::string const& out);
+
+		Chip8Display*					dsp;		///< The emulator display we show.
+		RENDER_MODE						mode;		///< Half blocks or braille.
+		QTimer*							refresh;	///< 60Hz refresh timer.
+		unsigned int					width;		///< Logical X-resolution of the CHIP8 display.
+		unsigned int					height;		///< Logical Y-resolution of the CHIP8 display.
+		unsigned int					cellWidth;	///< Pixels per terminal cell in X-direction.
+		unsigned int					cellHeight;	///< Pixels per terminal cell in Y-direction.
+		unsigned int					cols;		///< Number of terminal columns in use.
+		unsigned int					rows;		///< Number of terminal rows in use.
+		bool							dirty;		///< The display changed since the last \ref Render().
+		uint64_t						received;	///< DrawSprite/Clear signals handled so far (key latency).
+		Chip8Frame						display;	///< Latest copy of the emulator display.
+		std::vector<int>				cells;		///< Cell codes currently shown on the terminal (-1 = unknown).
+};
+
+#endif // CHIP8TERMVIEW_H
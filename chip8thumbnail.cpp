@@ -0,0 +1,72 @@
+#include <fstream>
+#include <sstream>
+#include <cstdio>			// rename()
+#include <atomic>
+
+#include <QString>
+
+#include "chip8thumbnail.h"
+#include "chip8display.h"
+
+/**
+	Converts a display into an image with one pixel per CHIP8 pixel.
+*/
+QImage Chip8Thumbnail::to_image(Chip8Frame const& frame)
+{
+	QImage image(static_cast<int>(frame.width), static_cast<int>(frame.height), QImage::Format_Grayscale8);
+
+	for(unsigned int y = 0; y < frame.height; ++y){
+		uchar* line = image.scanLine(static_cast<int>(y));
+		for(unsigned int x = 0; x < frame.width; ++x){
+			line[x] = frame.pixel(x, y) ? 0xff : 0x00;
+		}
+	}
+	return image;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Returns the thumbnail of a program. A cached thumbnail is read from
+	cacheDir, otherwise the program is run headless for \ref FRAMES frames and
+	the resulting display is stored in the cache (written to a temporary file
+	and renamed, so concurrent scans never see half a file).
+
+	\param	[in]	filename	The program file.
+	\param	[in]	mode		Emulation mode to run the program in.
+	\param	[in]	cacheDir	Directory of the thumbnail cache (must exist).
+	\return	The thumbnail, a null image if the file couldn't be read.
+*/
+QImage Chip8Thumbnail::render(std::string const& filename, CHIP8::EMULATION_MODE mode, std::string const& cacheDir)
+{
+	std::ifstream		file(filename, std::ios::in|std::ios::binary);
+	std::ostringstream	content;
+	char				name[48];
+
+	if(!file.is_open()){
+		return QImage();
+	}
+	content << file.rdbuf();
+	std::string program = content.str();
+
+	snprintf(name, sizeof(name), "/%016llx-%d.png", static_cast<unsigned long long>(CHIP8::program_hash(program)), static_cast<int>(mode));
+	QString cached = QString::fromStdString(cacheDir + name);
+	QImage	image;
+	if(image.load(cached)){
+		return image;
+	}
+
+	CHIP8 emu(nullptr);											// private, headless emulator: no keyboard, no timers, no thread
+	emu.mode(mode);
+	emu.display()->frames_only(true);							// no receiver for the draws
+	emu.load(program, CHIP8::MAP_RAM_START);
+	emu.run_frames(CHIP8::MAP_RAM_START, FRAMES, PER_FRAME);
+	image = to_image(emu.display()->frame());
+
+	static std::atomic<unsigned int> tmpSerial(0);
+	QString tmp = cached + QString(".tmp%1").arg(tmpSerial.fetch_add(1));			// unique per call
+	if(image.save(tmp, "PNG")){
+		std::rename(tmp.toStdString().c_str(), cached.toStdString().c_str());
+	}
+	return image;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,33 @@
+#ifndef CHIP8THUMBNAIL_H
+#define CHIP8THUMBNAIL_H
+
+#include <QImage>
+#include <string>
+
+#include "chip8.h"
+#include "chip8frame.h"
+
+/**
+	Renders the display of a program after it ran headless for a few seconds
+	(\ref CHIP8::run_frames()) and caches the result on disk.
+
+	The cache file is named after \ref CHIP8::program_hash() and the
+	emulation mode, so renamed or copied programs share their thumbnail and a
+	changed program gets a new one. \ref render() only uses a private
+	emulator object and can run in any thread.
+*/
+class Chip8Thumbnail
+{
+	public:
+		enum THUMBNAIL_RUN {
+			FRAMES		= 180,		///< Emulated frames (3s at 60Hz).
+			PER_FRAME	= 16		///< Instructions per frame (the default speed of the emulator).
+		};
+
+		static QImage render(std::string const& filename, CHIP8::EMULATION_MODE mode, std::string const& cacheDir);	///< Thumbnail of a program file (cached).
+
+	private:
+		static QImage to_image(Chip8Frame const& frame);
+};
+
+#endif // CHIP8THUMBNAIL_H
@@ -0,0 +1,139 @@
+#include <iostream>
+#include <algorithm>
+#include <fcntl.h>			// open()
+#include <unistd.h>			// ftruncate(), close()
+#include <sys/mman.h>		// mmap()
+
+#include "chip8trace.h"
+
+/**
+	Constructor, no segment is open.
+*/
+Chip8Trace::Chip8Trace(void)
+: segmentSize(DEFAULT_SEGMENT), keep(0), segment(0), fd(-1), data(nullptr), header(nullptr), capacity(0), used(0), total(0), totalBytes(0), prevPc(0)
+{
+	memset(&prev, 0, sizeof(prev));
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Destructor, closes the current segment.
+*/
+Chip8Trace::~Chip8Trace()
+{
+	close();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Starts a trace: the segments are written to aBase.0, aBase.1, ...
+
+	\param	[in]	aBase			Base name of the segment files.
+	\param	[in]	aSegmentSize	Size of a segment file in byte.
+	\param	[in]	aKeep			Number of segments to keep, older ones are deleted (0: keep all).
+	\return false if the first segment couldn't be created.
+*/
+bool Chip8Trace::open(std::string const& aBase, uint64_t aSegmentSize, unsigned int aKeep)
+{
+	close();
+	base		= aBase;
+	segmentSize	= std::max<uint64_t>(aSegmentSize, 4096);
+	keep		= aKeep;
+	segment		= 0;
+	total		= 0;
+	totalBytes	= 0;
+	return map_segment();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Ends the trace, the current segment is cut to its used length.
+*/
+void Chip8Trace::close(void)
+{
+	unmap_segment();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	\return Name of segment file n.
+*/
+std::string Chip8Trace::segment_name(uint64_t n) const
+{
+	return base + "." + std::to_string(n);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Creates segment file \ref segment with its full size and maps it.
+	\return false on error (the trace stops).
+*/
+bool Chip8Trace::map_segment(void)
+{
+	std::string name = segment_name(segment);
+
+	fd = ::open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0){
+		std::cerr << "-E- Chip8Trace: couldn't create <" << name << ">" << std::endl;
+		return false;
+	}
+	if(ftruncate(fd, static_cast<off_t>(segmentSize)) != 0){
+		std::cerr << "-E- Chip8Trace: couldn't size <" << name << ">" << std::endl;
+		::close(fd);
+		fd = -1;
+		return false;
+	}
+	void* addr = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if(MAP_FAILED == addr){
+		std::cerr << "-E- Chip8Trace: couldn't map <" << name << ">" << std::endl;
+		::close(fd);
+		fd = -1;
+		return false;
+	}
+	data				= static_cast<uint8_t*>(addr);
+	header				= reinterpret_cast<Chip8TraceHeader*>(data);
+	memset(header, 0, sizeof(Chip8TraceHeader));
+	header->magic		= Chip8TraceHeader::TRACE_MAGIC;
+	header->version		= Chip8TraceHeader::TRACE_VERSION;
+	header->segment		= segment;
+	capacity			= segmentSize - sizeof(Chip8TraceHeader);
+	used				= 0;
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Unmaps the current segment and cuts the file to header and records.
+*/
+void Chip8Trace::unmap_segment(void)
+{
+	if(!data){
+		return;
+	}
+	munmap(data, segmentSize);
+	if(ftruncate(fd, static_cast<off_t>(sizeof(Chip8TraceHeader) + used)) != 0){
+		std::cerr << "-W- Chip8Trace: couldn't truncate <" << segment_name(segment) << ">" << std::endl;
+	}
+	::close(fd);
+	fd			= -1;
+	data		= nullptr;
+	header		= nullptr;
+	totalBytes	+= used;
+	used		= 0;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Closes the full segment, starts the next one and deletes the segment that
+	fell out of the kept range.
+*/
+void Chip8Trace::rotate(void)
+{
+	unmap_segment();
+	++segment;
+	if(keep && (segment >= keep)){
+		unlink(segment_name(segment - keep).c_str());
+	}
+	map_segment();
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,215 @@
+#ifndef CHIP8TRACE_H
+#define CHIP8TRACE_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sys/types.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+	Registers of the CHIP8 as seen by the binary instruction trace.
+*/
+struct Chip8TraceState
+{
+	enum TRACE_REG {
+		REG_M		= 16,			///< Bit of M in the change mask (V0-VF are bits 0-15).
+		REG_SP		= 17,			///< Bit of SP.
+		REG_TD		= 18,			///< Bit of the delay timer.
+		REG_TS		= 19,			///< Bit of the sound timer.
+		REG_ALL		= 0xfffff		///< All registers (first record of a segment).
+	};
+
+	uint8_t		V[16];				///< Registers V0 - Vf.
+	uint16_t	M;					///< Memory register.
+	uint8_t		SP;					///< Stack pointer.
+	uint8_t		TD;					///< Delay timer.
+	uint8_t		TS;					///< Sound timer.
+};
+
+/**
+	Header of one segment file of the binary trace. The records follow
+	directly. The counts are updated after every record, so a segment of a
+	crashed run is readable up to the last instruction.
+
+	One record per executed instruction, all numbers are LEB128 varints:
+	- zigzag(PC - (previous PC + 2)), 0 for straight-line code
+	- the instruction, 2 byte big endian
+	- mask of the changed registers (\ref Chip8TraceState::TRACE_REG)
+	- the new values in bit order: V0-VF one byte each, M as varint, SP, TD
+	  and TS one byte each
+
+	The first record of every segment has all bits set, so each segment
+	decodes on its own. A typical instruction takes 4-5 byte.
+*/
+struct Chip8TraceHeader
+{
+	enum TRACE_ID {
+		TRACE_MAGIC		= 0x52543843,	///< "C8TR" (little endian).
+		TRACE_VERSION	= 1				///< Layout version.
+	};
+
+	uint32_t	magic;					///< \ref TRACE_MAGIC.
+	uint32_t	version;				///< \ref TRACE_VERSION.
+	uint64_t	segment;				///< Number of the segment (0, 1, ...).
+	uint64_t	firstInstr;				///< Instruction count of the first record.
+	uint64_t	records;				///< Records in this segment.
+	uint64_t	length;					///< Bytes of record data after the header.
+	uint16_t	firstPc;				///< PC of the first record (its delta is 0).
+	uint16_t	pad[3];
+};
+
+/**
+	Writes the binary instruction trace (\ref Chip8TraceHeader) into
+	memory-mapped segment files <base>.0, <base>.1, ... A segment is closed
+	when it reaches the segment size; only the last keep segments are kept,
+	so a run of many hours needs bounded disk space.
+
+	\ref record() is called by the emulator thread after every instruction.
+	It only compares the registers with the previous ones and stores a few
+	bytes into the mapping, no system call is made outside the rotation.
+*/
+class Chip8Trace
+{
+	public:
+		enum TRACE_LIMITS {
+			MAX_RECORD		= 32,					///< Upper bound of one record in byte.
+			DEFAULT_SEGMENT	= 64 * 1024 * 1024		///< Default segment size in byte.
+		};
+
+		Chip8Trace(void);																		///< Constructor, not open.
+		~Chip8Trace();																			///< Closes the current segment.
+		bool		open(std::string const& aBase, uint64_t aSegmentSize = DEFAULT_SEGMENT, unsigned int aKeep = 0);	///< Start tracing (keep: segments to keep, 0: all).
+		void		close(void);																///< Truncate and close the current segment.
+		bool		active(void) const {return nullptr != data;}								///< A segment is open.
+		uint64_t	records(void) const {return total;}											///< Records written since \ref open().
+		uint64_t	bytes(void) const {return totalBytes + used;}								///< Bytes written since \ref open().
+
+		/**
+			Appends the record of one executed instruction (emulator thread).
+
+			\param	[in]	instr	Instruction count (only used for the segment header).
+			\param	[in]	pc		Address of the instruction.
+			\param	[in]	op		The instruction.
+			\param	[in]	s		The registers after the instruction.
+		*/
+		void record(uint64_t instr, uint16_t pc, uint16_t op, Chip8TraceState const& s)
+		{
+			if(!data){
+				return;
+			}
+			if(used + MAX_RECORD > capacity){
+				rotate();
+				if(!data){
+					return;
+				}
+			}
+
+			uint8_t*	p		= data + sizeof(Chip8TraceHeader) + used;
+			uint8_t*	start	= p;
+			uint32_t	mask	= 0;
+
+			if(0 == header->records){										// self-contained segment
+				header->firstInstr	= instr;
+				header->firstPc		= pc;
+				prevPc				= static_cast<uint16_t>(pc - 2);
+				mask				= Chip8TraceState::REG_ALL;
+			} else {
+				mask = changed_v(s.V, prev.V);
+				mask |= static_cast<uint32_t>(s.M  != prev.M)  << Chip8TraceState::REG_M;
+				mask |= static_cast<uint32_t>(s.SP != prev.SP) << Chip8TraceState::REG_SP;
+				mask |= static_cast<uint32_t>(s.TD != prev.TD) << Chip8TraceState::REG_TD;
+				mask |= static_cast<uint32_t>(s.TS != prev.TS) << Chip8TraceState::REG_TS;
+			}
+
+			int32_t delta = static_cast<int16_t>(pc - static_cast<uint16_t>(prevPc + 2));
+			p		= put_varint(p, (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31));
+			*p++	= static_cast<uint8_t>(op >> 8);
+			*p++	= static_cast<uint8_t>(op);
+			p		= put_varint(p, mask);
+			for(uint32_t v = mask & 0xffff; v; v &= v - 1){				// only the set bits
+				*p++ = s.V[__builtin_ctz(v)];
+			}
+			if(mask & ~0xffffu){
+				if(mask & (1u << Chip8TraceState::REG_M)){
+					p = put_varint(p, s.M);
+				}
+				if(mask & (1u << Chip8TraceState::REG_SP)){
+					*p++ = s.SP;
+				}
+				if(mask & (1u << Chip8TraceState::REG_TD)){
+					*p++ = s.TD;
+				}
+				if(mask & (1u << Chip8TraceState::REG_TS)){
+					*p++ = s.TS;
+				}
+			}
+
+			used			+= static_cast<uint64_t>(p - start);
+			header->length	= used;
+			++header->records;
+			++total;
+			prev			= s;
+			prevPc			= pc;
+		}
+
+		/**
+			\return Mask of the bytes that differ between a and b (16 byte each).
+		*/
+		static uint32_t changed_v(uint8_t const* a, uint8_t const* b)
+		{
+#ifdef __SSE2__
+			__m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(a)), _mm_loadu_si128(reinterpret_cast<__m128i const*>(b)));
+			return static_cast<uint32_t>(~_mm_movemask_epi8(eq)) & 0xffff;
+#else
+			uint64_t	x[2], y[2];
+			uint32_t	mask = 0;
+			memcpy(x, a, 16);
+			memcpy(y, b, 16);
+			if((x[0] != y[0]) || (x[1] != y[1])){							// two compares if no V register changed
+				for(unsigned int r = 0; r < 16; ++r){
+					mask |= static_cast<uint32_t>(a[r] != b[r]) << r;
+				}
+			}
+			return mask;
+#endif
+		}
+
+		/**
+			Stores v as LEB128 varint.
+			\return The position after the varint.
+		*/
+		static uint8_t* put_varint(uint8_t* p, uint32_t v)
+		{
+			while(v >= 0x80){
+				*p++	= static_cast<uint8_t>(v | 0x80);
+				v		>>= 7;
+			}
+			*p++ = static_cast<uint8_t>(v);
+			return p;
+		}
+
+	private:
+		bool		map_segment(void);
+		void		unmap_segment(void);
+		void		rotate(void);
+		std::string	segment_name(uint64_t n) const;
+
+		std::string			base;				///< Base name of the segment files.
+		uint64_t			segmentSize;		///< Size of a segment file.
+		unsigned int		keep;				///< Segments to keep (0: all).
+		uint64_t			segment;			///< Number of the current segment.
+		int					fd;					///< Current segment file.
+		uint8_t*			data;				///< Mapping of the current segment.
+		Chip8TraceHeader*	header;				///< Its header.
+		uint64_t			capacity;			///< Bytes for records in the segment.
+		uint64_t			used;				///< Bytes of records in the segment.
+		uint64_t			total;				///< Records since \ref open().
+		uint64_t			totalBytes;			///< Bytes of closed segments.
+		Chip8TraceState		prev;				///< Registers after the last record.
+		uint16_t			prevPc;				///< Address of the last record.
+};
+
+#endif // CHIP8TRACE_H
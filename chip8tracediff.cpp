@@ -0,0 +1,451 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <iostream>
+#include <glob.h>
+#include <fcntl.h>			// open()
+#include <unistd.h>			// close()
+#include <sys/mman.h>		// mmap()
+#include <sys/stat.h>		// fstat()
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "chip8tracereader.h"
+
+/**
+	chip8-tracediff: finds the first instruction where two traces of the
+	emulator differ, either two binary traces (\ref Chip8Trace, the
+	segments of a run are found from the base name) or two text program
+	traces (log file of the emulator or output of chip8-trace).
+
+	Both traces are memory-mapped and compared with wide compares first;
+	only the segment (binary) or the line (text) with the first differing
+	byte is decoded, so traces of many GB are compared in about the time
+	it takes to read them. The instructions are aligned by instruction
+	count. The result is the first differing instruction, which register
+	differs and the instructions around it.
+
+	Exit code as cmp(1): 0 equal, 1 different, 2 error.
+*/
+
+namespace {
+
+/**
+	\return Offset of the first byte where a and b differ, n if none.
+*/
+size_t first_difference(uint8_t const* a, uint8_t const* b, size_t n)
+{
+	size_t i = 0;
+
+#ifdef __SSE2__
+	for(; i + 64 <= n; i += 64){											// 64 byte per step
+		__m128i e0	= _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(a+i)),    _mm_loadu_si128(reinterpret_cast<__m128i const*>(b+i)));
+		__m128i e1	= _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(a+i+16)), _mm_loadu_si128(reinterpret_cast<__m128i const*>(b+i+16)));
+		__m128i e2	= _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(a+i+32)), _mm_loadu_si128(reinterpret_cast<__m128i const*>(b+i+32)));
+		__m128i e3	= _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(a+i+48)), _mm_loadu_si128(reinterpret_cast<__m128i const*>(b+i+48)));
+		if(0xffff != _mm_movemask_epi8(_mm_and_si128(_mm_and_si128(e0, e1), _mm_and_si128(e2, e3)))){
+			break;
+		}
+	}
+#endif
+	for(; i + 8 <= n; i += 8){
+		uint64_t x, y;
+		memcpy(&x, a+i, 8);
+		memcpy(&y, b+i, 8);
+		if(x != y){
+			break;
+		}
+	}
+	for(; (i < n) && (a[i] == b[i]); ++i){
+	}
+	return i;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	A read-only mapping of a whole file (text traces).
+*/
+struct MappedFile {
+	char const*	data	= nullptr;
+	size_t		size	= 0;
+
+	bool open(std::string const& filename)
+	{
+		struct stat	st;
+		int			fd = ::open(filename.c_str(), O_RDONLY);
+		if(fd < 0){
+			return false;
+		}
+		if(fstat(fd, &st) != 0){
+			::close(fd);
+			return false;
+		}
+		size = static_cast<size_t>(st.st_size);
+		if(size){
+			void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(MAP_FAILED == addr){
+				::close(fd);
+				return false;
+			}
+			madvise(addr, size, MADV_SEQUENTIAL);
+			data = static_cast<char const*>(addr);
+		}
+		::close(fd);
+		return true;
+	}
+
+	~MappedFile()
+	{
+		if(data){
+			munmap(const_cast<char*>(data), size);
+		}
+	}
+};
+
+/**
+	Walks through the instruction lines (starting with '$') of a text trace.
+*/
+struct TextTrace {
+	MappedFile	file;
+	size_t		pos		= 0;				///< Start of the next line.
+	uint64_t	index	= 0;				///< Number of the last returned instruction line (1, 2, ...).
+
+	/**
+		Returns the next instruction line.
+		\return false at the end of the file.
+	*/
+	bool next(char const*& line, size_t& length)
+	{
+		while(pos < file.size){
+			char const* start	= file.data + pos;
+			char const* nl		= static_cast<char const*>(memchr(start, '\n', file.size - pos));
+			length	= nl ? static_cast<size_t>(nl - start) : file.size - pos;
+			pos		+= length + 1;
+			if('$' == *start){
+				line = start;
+				++index;
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+/**
+	The segments of one binary trace, read as one stream.
+*/
+struct BinaryTrace {
+	std::vector<Chip8TraceReader*>	segments;
+	size_t							current	= 0;
+
+	bool next(Chip8TraceReader::Record& r)
+	{
+		while(current < segments.size()){
+			if(segments[current]->next(r)){
+				return true;
+			}
+			if(!segments[current]->error().empty()){
+				std::cerr << "-W- " << segments[current]->error() << std::endl;
+			}
+			++current;
+		}
+		return false;
+	}
+
+	~BinaryTrace()
+	{
+		for(Chip8TraceReader* s : segments){
+			delete s;
+		}
+	}
+};
+
+/**
+	Collects the segment files of a binary trace: the file itself if it is
+	a segment, otherwise all files <name>.<number>.
+*/
+std::vector<std::string> segment_files(std::string const& name)
+{
+	std::vector<std::string>	files;
+	glob_t						g;
+
+	if(Chip8TraceReader::is_trace(name)){
+		files.push_back(name);
+		return files;
+	}
+	if(0 == glob((name + ".*").c_str(), 0, nullptr, &g)){
+		for(size_t i = 0; i < g.gl_pathc; ++i){
+			std::string	f		= g.gl_pathv[i];
+			std::string	suffix	= f.substr(name.size() + 1);
+			if(!suffix.empty() && (suffix.find_first_not_of("0123456789") == std::string::npos) && Chip8TraceReader::is_trace(f)){
+				files.push_back(f);
+			}
+		}
+		globfree(&g);
+	}
+	return files;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Describes how two records differ (empty if they are equal).
+*/
+std::string difference(Chip8TraceReader::Record const& a, Chip8TraceReader::Record const& b)
+{
+	std::string	text;
+	char		buf[64];
+
+	if(a.pc != b.pc){
+		snprintf(buf, sizeof(buf), " PC $%03X/$%03X", a.pc, b.pc);
+		text += buf;
+	}
+	if(a.op != b.op){
+		snprintf(buf, sizeof(buf), " opcode %04X/%04X", a.op, b.op);
+		text += buf;
+	}
+	for(unsigned int reg = 0; reg < 16; ++reg){
+		if(a.state.V[reg] != b.state.V[reg]){
+			snprintf(buf, sizeof(buf), " V%X $%02X/$%02X", reg, a.state.V[reg], b.state.V[reg]);
+			text += buf;
+		}
+	}
+	if(a.state.M != b.state.M){
+		snprintf(buf, sizeof(buf), " M $%03X/$%03X", a.state.M, b.state.M);
+		text += buf;
+	}
+	if(a.state.SP != b.state.SP){
+		snprintf(buf, sizeof(buf), " SP $%X/$%X", a.state.SP, b.state.SP);
+		text += buf;
+	}
+	if(a.state.TD != b.state.TD){
+		snprintf(buf, sizeof(buf), " TD $%02X/$%02X", a.state.TD, b.state.TD);
+		text += buf;
+	}
+	if(a.state.TS != b.state.TS){
+		snprintf(buf, sizeof(buf), " TS $%02X/$%02X", a.state.TS, b.state.TS);
+		text += buf;
+	}
+	return text;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Compares two binary traces. Segments that start at the same instruction
+	and whose records are byte-identical are skipped without decoding.
+
+	\return Exit code.
+*/
+int diff_binary(std::string const& nameA, std::string const& nameB, unsigned int context)
+{
+	BinaryTrace	a, b;
+	std::string	error;
+
+	if(!Chip8TraceReader::open_all(segment_files(nameA), a.segments, error) || !Chip8TraceReader::open_all(segment_files(nameB), b.segments, error)){
+		std::cerr << "-E- " << error << std::endl;
+		return 2;
+	}
+	if(a.segments.empty() || b.segments.empty()){
+		std::cerr << "-E- No trace segments for <" << (a.segments.empty() ? nameA : nameB) << ">" << std::endl;
+		return 2;
+	}
+
+	uint64_t	startA	= a.segments.front()->header().firstInstr;
+	uint64_t	startB	= b.segments.front()->header().firstInstr;
+	uint64_t	skipped = 0;
+	if(startA != startB){															// e.g. one trace has rotated its oldest segments away
+		std::cerr << "-W- The traces don't start at the same instruction (A: " << startA << ", B: " << startB
+			<< "), comparing from instruction " << std::max(startA, startB) << " on" << std::endl;
+	}
+	while((a.current < a.segments.size()) && (b.current < b.segments.size())){		// wide compare of whole segments
+		Chip8TraceReader const*	sa	= a.segments[a.current];
+		Chip8TraceReader const*	sb	= b.segments[b.current];
+		if((sa->header().firstInstr != sb->header().firstInstr) || (sa->header().records != sb->header().records)
+			|| (sa->raw_length() != sb->raw_length()) || (first_difference(sa->raw(), sb->raw(), sa->raw_length()) != sa->raw_length())){
+			break;
+		}
+		skipped += sa->header().records;
+		++a.current;
+		++b.current;
+	}
+
+	std::deque<Chip8TraceReader::Record>	before;
+	Chip8TraceReader::Record				ra, rb;
+	bool									haveA	= a.next(ra);
+	bool									haveB	= b.next(rb);
+	while(haveA && haveB && (ra.index != rb.index)){								// align by instruction count
+		if(ra.index < rb.index){
+			haveA = a.next(ra);
+		} else {
+			haveB = b.next(rb);
+		}
+	}
+	while(haveA && haveB && difference(ra, rb).empty()){
+		before.push_back(ra);
+		if(before.size() > context){
+			before.pop_front();
+		}
+		haveA = a.next(ra);
+		haveB = b.next(rb);
+	}
+	if(!haveA && !haveB){
+		if(startA != startB){
+			printf("Traces are equal from instruction %llu on, but A starts at %llu and B at %llu\n", static_cast<unsigned long long>(std::max(startA, startB)),
+				static_cast<unsigned long long>(startA), static_cast<unsigned long long>(startB));
+			return 1;
+		}
+		printf("Traces are equal (%llu instructions skipped by block compare)\n", static_cast<unsigned long long>(skipped));
+		return 0;
+	}
+
+	if(haveA && haveB){
+		printf("First difference at instruction %llu:%s\n", static_cast<unsigned long long>(ra.index), difference(ra, rb).c_str());
+	} else {
+		printf("%s ends before instruction %llu\n", haveA ? "B" : "A", static_cast<unsigned long long>(haveA ? ra.index : rb.index));
+	}
+	for(Chip8TraceReader::Record const& r : before){
+		printf("  %12llu  %s\n", static_cast<unsigned long long>(r.index), Chip8TraceReader::format(r).c_str());
+	}
+	for(unsigned int n = 0; n <= context / 2; ++n){
+		if(haveA){
+			printf("A %12llu  %s\n", static_cast<unsigned long long>(ra.index), Chip8TraceReader::format(ra).c_str());
+			haveA = a.next(ra);
+		}
+	}
+	for(unsigned int n = 0; n <= context / 2; ++n){
+		if(haveB){
+			printf("B %12llu  %s\n", static_cast<unsigned long long>(rb.index), Chip8TraceReader::format(rb).c_str());
+			haveB = b.next(rb);
+		}
+	}
+	return 1;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Compares two text traces. The files are compared with wide compares up
+	to the first differing byte, the instruction lines before it are only
+	counted. From that line on the instruction lines are compared one by
+	one (other log lines are ignored).
+
+	\return Exit code.
+*/
+int diff_text(std::string const& nameA, std::string const& nameB, unsigned int context)
+{
+	TextTrace a, b;
+
+	if(!a.file.open(nameA)){
+		std::cerr << "-E- Couldn't read <" << nameA << ">" << std::endl;
+		return 2;
+	}
+	if(!b.file.open(nameB)){
+		std::cerr << "-E- Couldn't read <" << nameB << ">" << std::endl;
+		return 2;
+	}
+
+	size_t			common	= std::min(a.file.size, b.file.size);
+	size_t			d		= first_difference(reinterpret_cast<uint8_t const*>(a.file.data), reinterpret_cast<uint8_t const*>(b.file.data), common);
+	if((d == common) && (a.file.size == b.file.size)){
+		printf("Traces are equal\n");
+		return 0;
+	}
+
+	std::deque<std::string>	before;
+	char const*				la		= nullptr;
+	char const*				lb		= nullptr;
+	size_t					na		= 0;
+	size_t					nb		= 0;
+	while(a.pos < d){															// identical part: count the instructions
+		char const* start	= a.file.data + a.pos;
+		char const* nl		= static_cast<char const*>(memchr(start, '\n', d - a.pos));
+		if(!nl){
+			break;																// the line with the difference
+		}
+		if('$' == *start){
+			++a.index;
+			if(context){
+				before.push_back(std::string(start, nl));
+				if(before.size() > context){
+					before.pop_front();
+				}
+			}
+		}
+		a.pos = static_cast<size_t>(nl - a.file.data) + 1;
+	}
+	b.pos	= a.pos;
+	b.index	= a.index;
+
+	bool haveA = a.next(la, na);
+	bool haveB = b.next(lb, nb);
+	while(haveA && haveB && (na == nb) && (0 == memcmp(la, lb, na))){
+		before.push_back(std::string(la, na));
+		if(before.size() > context){
+			before.pop_front();
+		}
+		haveA = a.next(la, na);
+		haveB = b.next(lb, nb);
+	}
+	if(!haveA && !haveB){
+		printf("Instruction lines are equal (%llu)\n", static_cast<unsigned long long>(a.index));
+		return 0;
+	}
+
+	if(haveA && haveB){
+		size_t column = first_difference(reinterpret_cast<uint8_t const*>(la), reinterpret_cast<uint8_t const*>(lb), std::min(na, nb));
+		printf("First difference at instruction %llu, column %zu\n", static_cast<unsigned long long>(a.index), column + 1);
+	} else {
+		printf("%s ends before instruction %llu\n", haveA ? "B" : "A", static_cast<unsigned long long>(haveA ? a.index : b.index));
+	}
+	for(std::string const& line : before){
+		printf("  %s\n", line.c_str());
+	}
+	for(unsigned int n = 0; haveA && (n <= context / 2); ++n){
+		printf("A %.*s\n", static_cast<int>(na), la);
+		haveA = a.next(la, na);
+	}
+	for(unsigned int n = 0; haveB && (n <= context / 2); ++n){
+		printf("B %.*s\n", static_cast<int>(nb), lb);
+		haveB = b.next(lb, nb);
+	}
+	return 1;
+}
+//-----------------------------------------------------------------------------
+
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int				context	= 5;
+	std::vector<std::string>	names;
+
+	for(int i = 1; i < argc; ++i){
+		std::string arg = argv[i];
+		if(("--context" == arg) && (i+1 < argc)){
+			context = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 0));
+		} else if('-' == arg[0]){
+			std::cerr << "Usage: " << argv[0] << " [--context n] traceA traceB\n"
+				"Reports the first instruction where two traces of Chip8Emu differ.\n"
+				"A trace is a binary trace (--trace base name or segment file) or a text program trace.\n";
+			return ("--help" == arg) || ("-h" == arg) ? 0 : 2;
+		} else {
+			names.push_back(arg);
+		}
+	}
+	if(names.size() != 2){
+		std::cerr << "-E- Two traces needed" << std::endl;
+		return 2;
+	}
+
+	bool binaryA = !segment_files(names[0]).empty();
+	bool binaryB = !segment_files(names[1]).empty();
+	if(binaryA != binaryB){
+		std::cerr << "-E- Can't compare a binary with a text trace (decode it with chip8-trace first)" << std::endl;
+		return 2;
+	}
+	return binaryA ? diff_binary(names[0], names[1], context) : diff_text(names[0], names[1], context);
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,280 @@
+#include <cstdio>
+#include <algorithm>
+#include <fcntl.h>			// open()
+#include <unistd.h>			// close()
+#include <sys/mman.h>		// mmap()
+#include <sys/stat.h>		// fstat()
+
+#include "chip8tracereader.h"
+#include "chip8disassembler.h"
+
+/**
+	Constructor, no file is mapped.
+*/
+Chip8TraceReader::Chip8TraceReader(void)
+: data(nullptr), size(0), head(nullptr), pos(nullptr), end(nullptr), count(0), prevPc(0)
+{
+	memset(&state, 0, sizeof(state));
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Destructor, unmaps the file.
+*/
+Chip8TraceReader::~Chip8TraceReader()
+{
+	close();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Maps a segment file and checks its header. The record length of the
+	header is trusted only as far as the file reaches (crashed run).
+
+	\param	[in]	filename	Name of the segment file.
+	\return false if the file is no readable trace (see \ref error()).
+*/
+bool Chip8TraceReader::open(std::string const& filename)
+{
+	struct stat	st;
+	int			fd;
+
+	close();
+	name = filename;
+	if((fd = ::open(filename.c_str(), O_RDONLY)) < 0){
+		message = "couldn't open <" + filename + ">";
+		return false;
+	}
+	if((fstat(fd, &st) != 0) || (static_cast<size_t>(st.st_size) < sizeof(Chip8TraceHeader))){
+		message = "<" + filename + "> is too short";
+		::close(fd);
+		return false;
+	}
+	size = static_cast<size_t>(st.st_size);
+	void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(MAP_FAILED == addr){
+		message = "couldn't map <" + filename + ">";
+		return false;
+	}
+	madvise(addr, size, MADV_SEQUENTIAL);
+	data = static_cast<uint8_t const*>(addr);
+	head = reinterpret_cast<Chip8TraceHeader const*>(data);
+	if((Chip8TraceHeader::TRACE_MAGIC != head->magic) || (Chip8TraceHeader::TRACE_VERSION != head->version)){
+		message = "<" + filename + "> is no trace of this version";
+		close();
+		return false;
+	}
+	rewind();
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Unmaps the file.
+*/
+void Chip8TraceReader::close(void)
+{
+	if(data){
+		munmap(const_cast<uint8_t*>(data), size);
+	}
+	data	= nullptr;
+	head	= nullptr;
+	pos		= nullptr;
+	end		= nullptr;
+	size	= 0;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Starts decoding at the first record again.
+*/
+void Chip8TraceReader::rewind(void)
+{
+	pos		= data + sizeof(Chip8TraceHeader);
+	end		= pos + std::min<uint64_t>(head->length, size - sizeof(Chip8TraceHeader));
+	count	= 0;
+	prevPc	= static_cast<uint16_t>(head->firstPc - 2);
+	memset(&state, 0, sizeof(state));
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Reads one LEB128 varint.
+	\return false if the records end inside the varint.
+*/
+bool Chip8TraceReader::get_varint(uint32_t& v)
+{
+	unsigned int shift = 0;
+
+	v = 0;
+	while(pos < end){
+		uint8_t b = *pos++;
+		v |= static_cast<uint32_t>(b & 0x7f) << shift;
+		if(!(b & 0x80)){
+			return true;
+		}
+		shift += 7;
+		if(shift > 28){
+			break;
+		}
+	}
+	return false;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Decodes the next record.
+
+	\param	[out]	r	The instruction and the registers after it.
+	\return false at the end of the segment or if a record is cut off
+			(\ref error() is set in that case).
+*/
+bool Chip8TraceReader::next(Record& r)
+{
+	uint32_t	zigzag;
+	uint32_t	mask;
+
+	if((count >= head->records) || (pos >= end)){
+		return false;
+	}
+	if(!get_varint(zigzag) || (end - pos < 2)){
+		message = "record cut off in <" + name + ">";
+		return false;
+	}
+	r.op	= static_cast<uint16_t>((pos[0] << 8) | pos[1]);
+	pos		+= 2;
+	if(!get_varint(mask)){
+		message = "record cut off in <" + name + ">";
+		return false;
+	}
+	int32_t delta = static_cast<int32_t>(zigzag >> 1) ^ -static_cast<int32_t>(zigzag & 1);
+	r.pc = static_cast<uint16_t>(prevPc + 2 + delta);
+	for(unsigned int reg = 0; reg < 16; ++reg){
+		if(mask & (1u << reg)){
+			if(pos >= end){
+				message = "record cut off in <" + name + ">";
+				return false;
+			}
+			state.V[reg] = *pos++;
+		}
+	}
+	if(mask & (1u << Chip8TraceState::REG_M)){
+		uint32_t m;
+		if(!get_varint(m)){
+			message = "record cut off in <" + name + ">";
+			return false;
+		}
+		state.M = static_cast<uint16_t>(m);
+	}
+	uint8_t* bytes[3] = {&state.SP, &state.TD, &state.TS};
+	for(unsigned int b = 0; b < 3; ++b){
+		if(mask & (1u << (Chip8TraceState::REG_SP + b))){
+			if(pos >= end){
+				message = "record cut off in <" + name + ">";
+				return false;
+			}
+			*bytes[b] = *pos++;
+		}
+	}
+	r.index		= head->firstInstr + count;
+	r.changed	= (0 == count) ? 0 : mask;				// the first record repeats all registers
+	r.state		= state;
+	prevPc		= r.pc;
+	++count;
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	\return true if the file starts with the magic of a binary trace.
+*/
+bool Chip8TraceReader::is_trace(std::string const& filename)
+{
+	uint32_t	magic	= 0;
+	int			fd		= ::open(filename.c_str(), O_RDONLY);
+
+	if(fd < 0){
+		return false;
+	}
+	bool ok = (read(fd, &magic, sizeof(magic)) == sizeof(magic)) && (Chip8TraceHeader::TRACE_MAGIC == magic);
+	::close(fd);
+	return ok;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Opens the segments of a trace and sorts them by segment number, so the
+	files can be given in any order (e.g. by a shell glob, where run.10
+	comes before run.2).
+
+	\param	[in]	files		Names of the segment files.
+	\param	[out]	readers		The opened segments in order (owned by the caller).
+	\param	[out]	error		The reason if a file couldn't be opened.
+	\return false if a file couldn't be opened (readers is empty then).
+*/
+bool Chip8TraceReader::open_all(std::vector<std::string> const& files, std::vector<Chip8TraceReader*>& readers, std::string& error)
+{
+	readers.clear();
+	for(std::string const& f : files){
+		Chip8TraceReader* reader = new Chip8TraceReader();
+		if(!reader->open(f)){
+			error = reader->error();
+			delete reader;
+			for(Chip8TraceReader* r : readers){
+				delete r;
+			}
+			readers.clear();
+			return false;
+		}
+		readers.push_back(reader);
+	}
+	std::sort(readers.begin(), readers.end(), [](Chip8TraceReader const* a, Chip8TraceReader const* b){
+		return a->header().segment < b->header().segment;
+	});
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Formats one instruction like the program trace of the emulator:
+	address, disassembly and the registers the instruction changed.
+
+	\param	[in]	r	A decoded record.
+	\return The text line without newline.
+*/
+std::string Chip8TraceReader::format(Record const& r)
+{
+	std::string	line	= Chip8Disassembler::format(r.op, r.pc);
+	char		buf[32];
+
+	if(line.size() < 26){
+		line.resize(26, ' ');
+	}
+	snprintf(buf, sizeof(buf), " (I=%04X:", r.op);
+	line += buf;
+	for(unsigned int reg = 0; reg < 16; ++reg){
+		if(r.changed & (1u << reg)){
+			snprintf(buf, sizeof(buf), " V%X=$%02X", reg, r.state.V[reg]);
+			line += buf;
+		}
+	}
+	if(r.changed & (1u << Chip8TraceState::REG_M)){
+		snprintf(buf, sizeof(buf), " M=$%03X", r.state.M);
+		line += buf;
+	}
+	if(r.changed & (1u << Chip8TraceState::REG_SP)){
+		snprintf(buf, sizeof(buf), " SP=$%X", r.state.SP);
+		line += buf;
+	}
+	if(r.changed & (1u << Chip8TraceState::REG_TD)){
+		snprintf(buf, sizeof(buf), " TD=$%02X", r.state.TD);
+		line += buf;
+	}
+	if(r.changed & (1u << Chip8TraceState::REG_TS)){
+		snprintf(buf, sizeof(buf), " TS=$%02X", r.state.TS);
+		line += buf;
+	}
+	return line + ")";
+}
+//-----------------------------------------------------------------------------
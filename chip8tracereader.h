@@ -0,0 +1,58 @@
+#ifndef CHIP8TRACEREADER_H
+#define CHIP8TRACEREADER_H
+
+#include <string>
+#include <vector>
+
+#include "chip8trace.h"
+
+/**
+	Decodes one segment file of the binary instruction trace
+	(\ref Chip8TraceHeader). The file is memory-mapped read only and decoded
+	record by record with \ref next(), so files of any size need no memory.
+*/
+class Chip8TraceReader
+{
+	public:
+		/// One decoded instruction.
+		struct Record {
+			uint64_t		index;			///< Instruction count (\ref Chip8TraceHeader::firstInstr + n).
+			uint16_t		pc;				///< Address of the instruction.
+			uint16_t		op;				///< The instruction.
+			uint32_t		changed;		///< Mask of the registers the instruction changed.
+			Chip8TraceState	state;			///< All registers after the instruction.
+		};
+
+		Chip8TraceReader(void);								///< Constructor, no file.
+		~Chip8TraceReader();								///< Unmaps the file.
+		bool		open(std::string const& filename);		///< Map a segment file.
+		void		close(void);							///< Unmap it.
+		bool		next(Record& r);						///< Decode the next record.
+		void		rewind(void);							///< Back to the first record.
+
+		std::string const&		error(void) const		{return message;}		///< Reason why \ref open() or \ref next() failed.
+		Chip8TraceHeader const&	header(void) const		{return *head;}			///< Header of the segment (only after a successful \ref open()).
+		std::string const&		filename(void) const	{return name;}			///< Name of the mapped file.
+		uint8_t const*			raw(void) const			{return data + sizeof(Chip8TraceHeader);}		///< The encoded records.
+		uint64_t				raw_length(void) const	{return static_cast<uint64_t>(end - raw());}	///< Bytes of encoded records (after \ref rewind()).
+
+		static std::string	format(Record const& r);										///< Program trace text of a record.
+		static bool	is_trace(std::string const& filename);							///< The file starts with \ref Chip8TraceHeader::TRACE_MAGIC.
+		static bool	open_all(std::vector<std::string> const& files, std::vector<Chip8TraceReader*>& readers, std::string& error);	///< Open segments and sort them.
+
+	private:
+		bool		get_varint(uint32_t& v);
+
+		std::string					name;			///< Name of the file.
+		std::string					message;		///< Last error.
+		uint8_t const*				data;			///< The mapping.
+		size_t						size;			///< Size of the mapping.
+		Chip8TraceHeader const*		head;			///< Header of the segment.
+		uint8_t const*				pos;			///< Next record.
+		uint8_t const*				end;			///< End of the records.
+		uint64_t					count;			///< Records decoded.
+		uint16_t					prevPc;			///< Address of the last record.
+		Chip8TraceState				state;			///< Registers after the last record.
+};
+
+#endif // CHIP8TRACEREADER_H
@@ -0,0 +1,282 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iostream>
+
+#include "chip8tracereader.h"
+
+/**
+	chip8-trace: decodes the binary instruction trace of the emulator
+	(\ref Chip8Trace) into the text format of the program trace, optionally
+	filtered by address range, instruction range and opcode, or prints
+	statistics of the run.
+*/
+
+namespace {
+
+/**
+	Filter of the listing, all conditions must hold.
+*/
+struct Filter {
+	uint16_t	from		= 0x000;		///< Lowest address.
+	uint16_t	to			= 0xffff;		///< Highest address.
+	uint16_t	opMask		= 0;			///< Bits of the opcode that must match ...
+	uint16_t	opValue		= 0;			///< ... these.
+	uint64_t	first		= 0;			///< First instruction count.
+	uint64_t	last		= UINT64_MAX;	///< Last instruction count.
+
+	bool match(Chip8TraceReader::Record const& r) const
+	{
+		return (r.pc >= from) && (r.pc <= to) && ((r.op & opMask) == opValue) && (r.index >= first) && (r.index <= last);
+	}
+};
+
+/**
+	Prints the usage to stderr.
+*/
+void usage(char const* prog)
+{
+	std::cerr << "Usage: " << prog << " [options] segment...\n"
+		"Decodes the binary instruction trace of Chip8Emu (--trace) into the program trace text.\n"
+		"  --from <addr>     only instructions at or above addr\n"
+		"  --to <addr>       only instructions at or below addr\n"
+		"  --op <pattern>    only matching opcodes, hex digits match, other characters don't care (e.g. 8xy4, Dxyn, F?1E)\n"
+		"  --first <n>       start at instruction count n\n"
+		"  --count <n>       at most n instructions\n"
+		"  --stats           print statistics instead of the listing\n";
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Parses an address or count: decimal, 0x-hex or $-hex.
+	\return false if text is no number.
+*/
+bool parse_number(char const* text, uint64_t& value)
+{
+	char*	endp	= nullptr;
+	bool	dollar	= ('$' == text[0]);
+
+	value = strtoull(dollar ? text + 1 : text, &endp, dollar ? 16 : 0);
+	return endp && (*endp == '\0') && (endp != text);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Parses an opcode pattern of four characters into mask and value. Hex
+	digits must match, any other character (x, y, n, k, ?) doesn't care.
+	\return false if the pattern doesn't have four characters.
+*/
+bool parse_op(char const* text, uint16_t& mask, uint16_t& value)
+{
+	if(strlen(text) != 4){
+		return false;
+	}
+	mask	= 0;
+	value	= 0;
+	for(unsigned int i = 0; i < 4; ++i){
+		char	c		= text[i];
+		int		nibble	= -1;
+		if((c >= '0') && (c <= '9')){
+			nibble = c - '0';
+		} else if((c >= 'A') && (c <= 'F')){
+			nibble = c - 'A' + 10;
+		} else if((c >= 'a') && (c <= 'f')){
+			nibble = c - 'a' + 10;
+		}
+		if(nibble >= 0){
+			unsigned int shift = 12 - 4*i;
+			mask	|= 0xf << shift;
+			value	|= nibble << shift;
+		}
+	}
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	\return The opcode family of op, e.g. "8xy4" or "Fx1E".
+*/
+std::string family(uint16_t op)
+{
+	char	buf[8];
+	switch(op >> 12){
+		case 0x0:	if((0x00e0 == op) || (0x00ee == op)){
+						snprintf(buf, sizeof(buf), "%04X", op);
+					} else {
+						snprintf(buf, sizeof(buf), "0nnn");
+					}
+					break;
+		case 0x1: case 0x2: case 0xa: case 0xb:
+					snprintf(buf, sizeof(buf), "%Xnnn", op >> 12);
+					break;
+		case 0x3: case 0x4: case 0x6: case 0x7: case 0xc:
+					snprintf(buf, sizeof(buf), "%Xxkk", op >> 12);
+					break;
+		case 0x5: case 0x9:
+					snprintf(buf, sizeof(buf), "%Xxy0", op >> 12);
+					break;
+		case 0x8:	snprintf(buf, sizeof(buf), "8xy%X", op & 0xf);
+					break;
+		case 0xd:	snprintf(buf, sizeof(buf), "Dxyn");
+					break;
+		default:	snprintf(buf, sizeof(buf), "%Xx%02X", op >> 12, op & 0xff);
+					break;
+	}
+	return buf;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Statistics of the decoded instructions.
+*/
+struct Stats {
+	uint64_t							instructions	= 0;
+	uint64_t							bytes			= 0;
+	uint64_t							firstIndex		= 0;
+	uint64_t							lastIndex		= 0;
+	std::map<std::string, uint64_t>		families;			///< Executions per opcode family.
+	std::vector<uint64_t>				hits				= std::vector<uint64_t>(0x10000, 0);	///< Executions per address.
+	uint64_t							regWrites[20]		= {0};	///< Changes per register (\ref Chip8TraceState::TRACE_REG).
+
+	void add(Chip8TraceReader::Record const& r)
+	{
+		if(0 == instructions){
+			firstIndex = r.index;
+		}
+		lastIndex = r.index;
+		++instructions;
+		++families[family(r.op)];
+		++hits[r.pc];
+		for(unsigned int reg = 0; reg < 20; ++reg){
+			regWrites[reg] += (r.changed >> reg) & 1;
+		}
+	}
+
+	void print(void) const
+	{
+		static char const* const names[4] = {"M", "SP", "TD", "TS"};
+
+		printf("instructions      %llu (count %llu - %llu)\n", static_cast<unsigned long long>(instructions),
+			static_cast<unsigned long long>(firstIndex), static_cast<unsigned long long>(lastIndex));
+		printf("trace size        %llu byte, %.2f byte per instruction\n", static_cast<unsigned long long>(bytes),
+			instructions ? static_cast<double>(bytes) / instructions : 0.0);
+
+		std::vector<std::pair<uint64_t, std::string>> byCount;
+		for(auto const& f : families){
+			byCount.push_back(std::make_pair(f.second, f.first));
+		}
+		std::sort(byCount.rbegin(), byCount.rend());
+		printf("\nopcode      count       share\n");
+		for(auto const& f : byCount){
+			printf("%-6s %12llu  %6.2f%%\n", f.second.c_str(), static_cast<unsigned long long>(f.first), 100.0 * f.first / instructions);
+		}
+
+		std::vector<std::pair<uint64_t, uint16_t>> hot;
+		for(uint32_t pc = 0; pc < hits.size(); ++pc){
+			if(hits[pc]){
+				hot.push_back(std::make_pair(hits[pc], static_cast<uint16_t>(pc)));
+			}
+		}
+		std::sort(hot.rbegin(), hot.rend());
+		printf("\nhottest addresses (%zu executed)\n", hot.size());
+		for(size_t i = 0; (i < hot.size()) && (i < 10); ++i){
+			printf("$%03X %12llu  %6.2f%%\n", hot[i].second, static_cast<unsigned long long>(hot[i].first), 100.0 * hot[i].first / instructions);
+		}
+
+		printf("\nregister changes\n");
+		for(unsigned int reg = 0; reg < 20; ++reg){
+			if(regWrites[reg]){
+				if(reg < 16){
+					printf("V%X   %12llu\n", reg, static_cast<unsigned long long>(regWrites[reg]));
+				} else {
+					printf("%-4s %12llu\n", names[reg - 16], static_cast<unsigned long long>(regWrites[reg]));
+				}
+			}
+		}
+	}
+};
+
+}
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+	Filter						filter;
+	uint64_t					count	= UINT64_MAX;
+	bool						stats	= false;
+	std::vector<std::string>	files;
+
+	for(int i = 1; i < argc; ++i){
+		std::string	arg		= argv[i];
+		uint64_t	value	= 0;
+		bool		ok		= true;
+		if(("--from" == arg) && (i+1 < argc)){
+			ok = parse_number(argv[++i], value);
+			filter.from = static_cast<uint16_t>(value);
+		} else if(("--to" == arg) && (i+1 < argc)){
+			ok = parse_number(argv[++i], value);
+			filter.to = static_cast<uint16_t>(value);
+		} else if(("--op" == arg) && (i+1 < argc)){
+			ok = parse_op(argv[++i], filter.opMask, filter.opValue);
+		} else if(("--first" == arg) && (i+1 < argc)){
+			ok = parse_number(argv[++i], filter.first);
+		} else if(("--count" == arg) && (i+1 < argc)){
+			ok = parse_number(argv[++i], count);
+		} else if("--stats" == arg){
+			stats = true;
+		} else if(("--help" == arg) || ("-h" == arg) || ('-' == arg[0])){
+			usage(argv[0]);
+			return ("--help" == arg) || ("-h" == arg) ? 0 : 1;
+		} else {
+			files.push_back(arg);
+		}
+		if(!ok){
+			std::cerr << "-E- Invalid value <" << argv[i] << ">" << std::endl;
+			return 1;
+		}
+	}
+	if(files.empty()){
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<Chip8TraceReader*>	readers;
+	std::string						error;
+	if(!Chip8TraceReader::open_all(files, readers, error)){
+		std::cerr << "-E- " << error << std::endl;
+		return 1;
+	}
+
+	Stats						s;
+	Chip8TraceReader::Record	r;
+	uint64_t					shown	= 0;
+	int							result	= 0;
+	for(Chip8TraceReader* reader : readers){
+		s.bytes += sizeof(Chip8TraceHeader) + reader->header().length;
+		while((shown < count) && reader->next(r)){
+			if(!filter.match(r)){
+				continue;
+			}
+			++shown;
+			if(stats){
+				s.add(r);
+			} else {
+				puts(Chip8TraceReader::format(r).c_str());
+			}
+		}
+		if(!reader->error().empty()){
+			std::cerr << "-W- " << reader->error() << std::endl;
+			result = 1;
+		}
+		delete reader;
+	}
+	if(stats){
+		s.print();
+	}
+	return result;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,103 @@
+#include <chrono>
+#include <iostream>
+#include <cstring>
+
+#include "chip8wavsink.h"
+#include "chip8audio.h"
+
+/**
+	Constructor, opens the output file, writes a preliminary header and starts
+	the writer thread.
+
+	\param	[in]	aAudio		The sound of the emulator (this sink is its only reader).
+	\param	[in]	filename	Name of the WAV file.
+*/
+Chip8WavSink::Chip8WavSink(Chip8Audio* aAudio, std::string const& filename)
+: audio(aAudio), out(nullptr), buffer(Chip8Audio::SAMPLES_PER_FRAME * 4), running(true), samplesWritten(0)
+{
+	if((out = fopen(filename.c_str(), "wb")) == nullptr){
+		std::cerr << "-E- Chip8WavSink: couldn't open <" << filename << ">" << std::endl;
+		return;
+	}
+	write_header(0);
+	writerThread = std::thread(&Chip8WavSink::writer, this);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Destructor, writes the samples still in the ring, fills in the sizes of
+	the header and closes the file. The emulator must not render any more
+	samples at this point.
+*/
+Chip8WavSink::~Chip8WavSink()
+{
+	running.store(false);
+	if(writerThread.joinable()){
+		writerThread.join();
+	}
+	if(out){
+		fseek(out, 0, SEEK_SET);
+		write_header(static_cast<uint32_t>(samplesWritten.load()));
+		fclose(out);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Writes the 44 byte RIFF/WAVE header (little endian).
+
+	\param	[in]	samples	Number of samples in the file.
+*/
+void Chip8WavSink::write_header(uint32_t samples)
+{
+	uint32_t	dataSize	= samples * 2;
+	uint8_t		header[44];
+	auto		put32		= [&header](unsigned int pos, uint32_t v){for(unsigned int i = 0; i < 4; ++i){header[pos+i] = static_cast<uint8_t>(v >> (8*i));}};
+	auto		put16		= [&header](unsigned int pos, uint16_t v){header[pos] = static_cast<uint8_t>(v); header[pos+1] = static_cast<uint8_t>(v >> 8);};
+
+	memcpy(header, "RIFF", 4);
+	put32(4, 36 + dataSize);
+	memcpy(header+8, "WAVEfmt ", 8);
+	put32(16, 16);											// size of the fmt chunk
+	put16(20, 1);											// PCM
+	put16(22, 1);											// mono
+	put32(24, Chip8Audio::SAMPLE_RATE);
+	put32(28, Chip8Audio::SAMPLE_RATE * 2);					// byte rate
+	put16(32, 2);											// block align
+	put16(34, 16);											// bits per sample
+	memcpy(header+36, "data", 4);
+	put32(40, dataSize);
+	fwrite(header, 1, sizeof(header), out);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Writes all samples that are in the ring.
+*/
+void Chip8WavSink::drain(void)
+{
+	size_t n;
+
+	while((n = audio->read_available(buffer.data(), buffer.size())) > 0){
+		for(size_t i = 0; i < n; ++i){						// WAV is little endian
+			fputc(buffer[i] & 0xff, out);
+			fputc((buffer[i] >> 8) & 0xff, out);
+		}
+		samplesWritten.store(samplesWritten.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	The writer thread. Polls the ring every few ms, after the sink was told to
+	stop it drains the ring once more.
+*/
+void Chip8WavSink::writer(void)
+{
+	while(running.load()){
+		drain();
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	drain();
+}
+//-----------------------------------------------------------------------------
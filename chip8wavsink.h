@@ -0,0 +1,44 @@
+#ifndef CHIP8WAVSINK_H
+#define CHIP8WAVSINK_H
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+class Chip8Audio;
+
+/**
+	Writes the sound of the emulator into a WAV file (16-bit mono PCM), for
+	machines without a sound device (headless runs, CI).
+
+	A writer thread drains the ring of \ref Chip8Audio like the recorder
+	drains its frame queue. It is not bound to real time: with
+	\ref Chip8Audio::set_lossless() (the headless --frames run) the file holds
+	exactly the samples the emulator rendered, otherwise an emulator that
+	runs faster than the writer loses samples. The header is completed when
+	the sink is destroyed.
+*/
+class Chip8WavSink
+{
+	public:
+		Chip8WavSink(Chip8Audio* aAudio, std::string const& filename);		///< Constructor, starts the writer thread.
+		~Chip8WavSink();														///< Writes the rest and completes the file.
+		bool		ok(void) const		{return nullptr != out;}				///< Output could be opened.
+		uint64_t	written(void) const	{return samplesWritten.load(std::memory_order_relaxed);}	///< Samples in the file.
+
+	private:
+		void writer(void);
+		void drain(void);
+		void write_header(uint32_t samples);
+
+		Chip8Audio*				audio;				///< Source of the samples.
+		FILE*					out;				///< Output file.
+		std::vector<int16_t>	buffer;				///< Samples read from the ring.
+		std::atomic<bool>		running;			///< Cleared to make the writer finish.
+		std::atomic<uint64_t>	samplesWritten;		///< Statistics: samples written.
+		std::thread				writerThread;		///< The writer thread.
+};
+
+#endif // CHIP8WAVSINK_H
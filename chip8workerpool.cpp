@@ -0,0 +1,68 @@
+#include "chip8workerpool.h"
+
+/**
+	Constructor, starts the worker threads.
+
+	\param	[in]	aThreads	Number of workers, 0 for one per core.
+*/
+Chip8WorkerPool::Chip8WorkerPool(unsigned int aThreads)
+: stopping(false)
+{
+	if(0 == aThreads){
+		aThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for(unsigned int i = 0; i < aThreads; ++i){
+		workers.emplace_back(&Chip8WorkerPool::work, this);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Destructor, runs the queued jobs to the end and joins the workers.
+*/
+Chip8WorkerPool::~Chip8WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		stopping = true;
+	}
+	cond_var.notify_all();
+	for(std::thread& t : workers){
+		t.join();
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Queues a job, it runs in one of the worker threads.
+*/
+void Chip8WorkerPool::submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		jobs.push_back(std::move(job));
+	}
+	cond_var.notify_one();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Main loop of a worker thread.
+*/
+void Chip8WorkerPool::work(void)
+{
+	for(;;){
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> mlock(mtx);
+			cond_var.wait(mlock, [this]{return stopping || !jobs.empty();});
+			if(jobs.empty()){
+				return;								// stopping and nothing left to do
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
+//-----------------------------------------------------------------------------
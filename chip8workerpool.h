@@ -0,0 +1,37 @@
+#ifndef CHIP8WORKERPOOL_H
+#define CHIP8WORKERPOOL_H
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+/**
+	Fixed set of worker threads (one per core) that run submitted jobs.
+
+	Used by the grid view to emulate many \ref CHIP8 instances with
+	\ref CHIP8::run_frame() instead of one thread per instance. Jobs are run in
+	submission order by whichever worker is free.
+*/
+class Chip8WorkerPool
+{
+	public:
+		explicit Chip8WorkerPool(unsigned int aThreads = 0);		///< Constructor (0: one thread per core).
+		~Chip8WorkerPool();											///< Destructor, finishes the queued jobs.
+		void			submit(std::function<void()> job);			///< Queue a job.
+		unsigned int	size(void) const {return static_cast<unsigned int>(workers.size());}	///< Number of worker threads.
+
+	private:
+		void work(void);
+
+		std::vector<std::thread>			workers;		///< The worker threads.
+		std::deque<std::function<void()>>	jobs;			///< Queued jobs.
+		std::mutex							mtx;			///< Protects jobs and stopping.
+		std::condition_variable				cond_var;		///< Signals new jobs and stopping.
+		bool								stopping;		///< The destructor is waiting for the workers.
+};
+
+#endif // CHIP8WORKERPOOL_H
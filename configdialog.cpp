@@ -34,6 +34,7 @@ void ConfigDialog::open()
 	ui->debugCheckBox->setChecked(emu->log());
 	ui->traceCheckBox->setChecked(emu->trace());
 	ui->ptraceCheckBox->setChecked(emu->ptrace());
+	ui->blockCheckBox->setChecked(Chip8Logger::OVERFLOW_BLOCK == emu->logger().overflow());
 	if(CHIP8::MODE_CLASSIC == emu->mode()){
 		ui->classicRadioButton->setChecked(true);
 	} else {
@@ -66,6 +67,7 @@ void ConfigDialog::on_buttonBox_accepted()
 	} else {
 		emu->ptrace_of();
 	}
+	emu->logger().set_overflow(ui->blockCheckBox->isChecked() ? Chip8Logger::OVERFLOW_BLOCK : Chip8Logger::OVERFLOW_DROP);
 	if(ui->classicRadioButton->isChecked()){
 		emu->mode(CHIP8::MODE_CLASSIC);
 	} else {
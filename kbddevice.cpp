@@ -1,12 +1,13 @@
 #include <QKeyEvent>
 
 #include "kbddevice.h"
+#include "chip8latency.h"
 
 /**
 	Constructor.
 */
 KbdDevice::KbdDevice(QWidget *parent)
-: QWidget(parent), keyPressed(false), currentKey(0), keyCount(0)
+: QWidget(parent), keyPressed(false), currentKey(0), keyCount(0), closed(false)
 {
 
 }
@@ -29,8 +30,8 @@ KbdDevice::~KbdDevice()
 */
 int KbdDevice::ReadKey(void)
 {
-	if(keyPressed){
-		return currentKey;
+	if(keyPressed.load(std::memory_order_acquire)){
+		return currentKey.load(std::memory_order_relaxed);
 	} else {
 		return KBD_DEVICE_NO_KEY;
 	}
@@ -41,14 +42,27 @@ int KbdDevice::ReadKey(void)
 	This method implements the blocking read function.
 
 	The event filter will block access until the next key-press event occurrs.
+
+	\return The pressed key or \ref KEY_SOURCE_NO_KEY if the device was closed.
 */
 int KbdDevice::GetKey(void)
 {
 	access.acquire();
-	int key = currentKey;
+	int key = currentKey.load(std::memory_order_relaxed);
 	access.release();
 
-	return key;
+	return closed.load(std::memory_order_acquire) ? static_cast<int>(KEY_SOURCE_NO_KEY) : key;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Releases the thread that is blocked in \ref GetKey(), later reads return
+	at once. Must be called before the emulator thread is joined.
+*/
+void KbdDevice::Close(void)
+{
+	closed.store(true, std::memory_order_release);
+	access.release();
 }
 //-----------------------------------------------------------------------------
 
@@ -64,6 +78,12 @@ int KbdDevice::GetKey(void)
 	When the CHIP8 emulator calls the non-blocking read function we simply check the
 	state of the \ref keyPressed member and return the proper kay value.
 
+	Every press and release is also reported to the attached \ref Chip8Keyboard
+	(\ref KeyDown(), \ref KeyUp()), which keeps the state of all keys, so
+	several keys can be held at once. Auto-repeated events are only counted
+	as one press. Presses carry the time the filter saw the event, the start
+	of the key latency measurement (\ref Chip8Latency).
+
 	The blocking read  uses a semaphore to block access to the keyboard device after the
 	last key has been released (keyCount = 0). The blocking read will now block until
 	the next key-press event arrives and releases the semaphore.
@@ -80,20 +100,30 @@ int KbdDevice::GetKey(void)
 bool KbdDevice::eventFilter(QObject *obj, QEvent *event)
 {
 	if (event->type() == QEvent::KeyPress) {
+		int64_t stamp = Chip8Latency::now_ns();					// start of the input-to-photon latency
 		QKeyEvent *keyEvent = static_cast<QKeyEvent *>(event);
 //		qDebug("KbdDevice::eventFilter(): key press %d", keyEvent->key());
+		if(keyEvent->isAutoRepeat()){							// the key is still held
+			return true;
+		}
 		++keyCount;												// increase reference count for pressed keys
-		keyPressed = true;										// once we receive a kepress-event at least one key
+		currentKey.store(keyEvent->key(), std::memory_order_relaxed);
+		keyPressed.store(true, std::memory_order_release);		// once we receive a kepress-event at least one key
 																// ... is pressed until we receive the same amount of
 																// ... key-release events
-		currentKey = keyEvent->key();
+		KeyDown(keyEvent->key(), stamp);
 		access.release();
 		return true;
 	} else if(event->type() == QEvent::KeyRelease) {
+		QKeyEvent *keyEvent = static_cast<QKeyEvent *>(event);
+		if(keyEvent->isAutoRepeat() || (0 == keyCount)){
+			return true;
+		}
 		--keyCount;
 		if(0 == keyCount){
-			keyPressed = false;
+			keyPressed.store(false, std::memory_order_release);
 		}
+		KeyUp(keyEvent->key());
 		access.acquire();
 
 		return true;
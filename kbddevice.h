@@ -4,8 +4,11 @@
 #include <QObject>
 #include <QWidget>
 #include <QSemaphore>
+#include <atomic>
 
-class KbdDevice : public QWidget
+#include "chip8keysource.h"
+
+class KbdDevice : public QWidget, public Chip8KeySource
 {
 	Q_OBJECT
 public:
@@ -16,8 +19,9 @@ public:
 
 	explicit KbdDevice(QWidget *parent = nullptr);
 	~KbdDevice();
-	int ReadKey(void);								// non-blocking keboard read
-	int GetKey(void);								// blocking keyboard read
+	int ReadKey(void) override;						// non-blocking keboard read
+	int GetKey(void) override;						// blocking keyboard read
+	void Close(void);								///< Release the reader blocked in \ref GetKey().
 
 signals:
 
@@ -29,10 +33,11 @@ public slots:
 private:
 	void HandleWaitTimer(void);
 
-	bool		keyPressed;
-	int 		currentKey;
-	int 		keyCount;
-	QSemaphore	access;
+	std::atomic<bool>	keyPressed;		///< At least one key is pressed (read by the emulator thread).
+	std::atomic<int>	currentKey;		///< Last pressed key (read by the emulator thread).
+	int 				keyCount;		///< Number of pressed keys (UI thread only).
+	std::atomic<bool>	closed;			///< Blocking reads return immediately once set.
+	QSemaphore			access;
 };
 
 #endif // KBDDEVICE_H
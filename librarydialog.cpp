@@ -0,0 +1,169 @@
+#include <QVBoxLayout>
+#include <QFileDialog>
+#include <QDirIterator>
+#include <QStandardPaths>
+#include <QRunnable>
+#include <QPixmap>
+#include <QIcon>
+#include <QDir>
+
+#include "librarydialog.h"
+#include "chip8thumbnail.h"
+
+/**
+	One thumbnail of a scan, run by the thread pool of the dialog.
+*/
+class LibraryThumbnailTask : public QRunnable
+{
+	public:
+		LibraryThumbnailTask(LibraryDialog* aDialog, std::atomic<int> const& aScanId, int aScan, int aRow, std::string const& aFile, CHIP8::EMULATION_MODE aMode, std::string const& aCacheDir)
+		: dialog(aDialog), scanId(aScanId), scan(aScan), row(aRow), file(aFile), mode(aMode), cacheDir(aCacheDir) {}
+
+		void run() override
+		{
+			if(scan != scanId.load(std::memory_order_relaxed)){		// a newer scan started
+				return;
+			}
+			QImage image = Chip8Thumbnail::render(file, mode, cacheDir);
+			QMetaObject::invokeMethod(dialog, "ThumbnailReady", Qt::QueuedConnection, Q_ARG(int, scan), Q_ARG(int, row), Q_ARG(QImage, image));
+		}
+
+	private:
+		LibraryDialog*				dialog;
+		std::atomic<int> const&		scanId;
+		int							scan;
+		int							row;
+		std::string					file;
+		CHIP8::EMULATION_MODE		mode;
+		std::string					cacheDir;
+};
+
+/**
+	Constructor, the dialog is empty until a folder is chosen.
+
+	\param	[in]	aEmu	The emulator, thumbnails are rendered in its emulation mode.
+	\param	[in]	parent	Parent widget.
+*/
+LibraryDialog::LibraryDialog(CHIP8* aEmu, QWidget *parent)
+: QDialog(parent)
+, emu(aEmu)
+, scanId(0)
+, pending(0)
+{
+	setWindowTitle(tr("Program library"));
+	resize(720, 480);
+
+	folderButton	= new QPushButton(tr("Folder..."), this);
+	statusLabel		= new QLabel(this);
+	romList			= new QListWidget(this);
+	romList->setViewMode(QListView::IconMode);
+	romList->setResizeMode(QListView::Adjust);
+	romList->setIconSize(QSize(128, 64));
+	romList->setGridSize(QSize(150, 96));
+	romList->setUniformItemSizes(true);
+
+	QVBoxLayout* layout = new QVBoxLayout(this);
+	layout->addWidget(folderButton);
+	layout->addWidget(romList);
+	layout->addWidget(statusLabel);
+
+	connect(folderButton,	&QPushButton::clicked,				this, &LibraryDialog::ChooseFolder);
+	connect(romList,		&QListWidget::itemActivated,		this, &LibraryDialog::Pick);
+
+	pool.setMaxThreadCount(QThread::idealThreadCount());
+	cacheDir = (QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/thumbnails").toStdString();
+	QDir().mkpath(QString::fromStdString(cacheDir));
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Destructor, waits for the running thumbnail tasks. Their queued results are
+	discarded with the dialog.
+*/
+LibraryDialog::~LibraryDialog()
+{
+	cancel();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Drops the queued tasks of the current scan and waits for the running ones.
+*/
+void LibraryDialog::cancel(void)
+{
+	scanId.fetch_add(1, std::memory_order_relaxed);
+	pool.clear();
+	pool.waitForDone();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Private slot of the folder button.
+*/
+void LibraryDialog::ChooseFolder(void)
+{
+	QString folder = QFileDialog::getExistingDirectory(this, tr("Program folder"), QDir::homePath());
+	if(!folder.isEmpty()){
+		scan(folder);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Lists all programs (*.ch8) below folder and queues one thumbnail task per
+	program. Only the file names are read here, the programs themselves are
+	read by the tasks.
+*/
+void LibraryDialog::scan(QString const& folder)
+{
+	cancel();
+	romList->clear();
+	pending = 0;
+
+	int						scan	= scanId.load(std::memory_order_relaxed);
+	CHIP8::EMULATION_MODE	mode	= emu->mode();
+	QDirIterator			it(folder, QStringList() << "*.ch8", QDir::Files, QDirIterator::Subdirectories);
+	while(it.hasNext()){
+		QString				file	= it.next();
+		QListWidgetItem*	item	= new QListWidgetItem(QFileInfo(file).completeBaseName(), romList);
+		item->setData(Qt::UserRole, file);
+		item->setToolTip(file);
+		pool.start(new LibraryThumbnailTask(this, scanId, scan, romList->count()-1, file.toStdString(), mode, cacheDir));
+		++pending;
+	}
+	statusLabel->setText(tr("%1 programs").arg(romList->count()));
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Private slot, called (queued) by the thumbnail tasks.
+
+	\param	[in]	scan	Number of the scan the task belongs to.
+	\param	[in]	row		Row of the program in the list.
+	\param	[in]	image	The thumbnail (null if the program couldn't be read).
+*/
+void LibraryDialog::ThumbnailReady(int scan, int row, QImage image)
+{
+	if((scan != scanId.load(std::memory_order_relaxed)) || (row >= romList->count())){
+		return;
+	}
+	if(!image.isNull()){
+		romList->item(row)->setIcon(QIcon(QPixmap::fromImage(image.scaled(romList->iconSize(), Qt::KeepAspectRatio, Qt::FastTransformation))));
+	}
+	if(0 == --pending){
+		statusLabel->setText(tr("%1 programs").arg(romList->count()));
+	} else {
+		statusLabel->setText(tr("%1 programs, %2 thumbnails to go").arg(romList->count()).arg(pending));
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Private slot, remembers the activated program and closes the dialog.
+*/
+void LibraryDialog::Pick(QListWidgetItem* item)
+{
+	selectedFile = item->data(Qt::UserRole).toString();
+	accept();
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,53 @@
+#ifndef LIBRARYDIALOG_H
+#define LIBRARYDIALOG_H
+
+#include <QDialog>
+#include <QListWidget>
+#include <QLabel>
+#include <QPushButton>
+#include <QThreadPool>
+#include <QImage>
+#include <atomic>
+#include <string>
+
+#include "chip8.h"
+
+/**
+	Browser for a folder of CHIP8 programs that shows each program with a
+	thumbnail of its display (\ref Chip8Thumbnail).
+
+	The thumbnails are rendered by a private thread pool, one task per
+	program, and handed back to the dialog with queued calls of
+	\ref ThumbnailReady(), so a scan never blocks the user interface. A new
+	scan drops the tasks of the previous one.
+*/
+class LibraryDialog : public QDialog
+{
+	Q_OBJECT
+
+public:
+	explicit LibraryDialog(CHIP8* aEmu, QWidget *parent = nullptr);
+	~LibraryDialog() override;
+	QString selected(void) const {return selectedFile;}		///< The program the user picked.
+
+private slots:
+	void ChooseFolder(void);														///< Ask for a folder and scan it.
+	void ThumbnailReady(int scan, int row, QImage image);						///< A thumbnail was rendered (queued from the pool).
+	void Pick(QListWidgetItem* item);												///< The user activated a program.
+
+private:
+	void scan(QString const& folder);
+	void cancel(void);
+
+	CHIP8*					emu;				///< The emulator (for the emulation mode).
+	QPushButton*			folderButton;		///< Opens the folder chooser.
+	QLabel*					statusLabel;		///< Progress of the scan.
+	QListWidget*			romList;			///< One item per program.
+	QThreadPool				pool;				///< Renders the thumbnails.
+	std::atomic<int>		scanId;				///< Number of the current scan, older tasks give up.
+	int						pending;			///< Thumbnails of the current scan not yet shown.
+	std::string				cacheDir;			///< Directory of the thumbnail cache.
+	QString					selectedFile;		///< The program the user picked.
+};
+
+#endif // LIBRARYDIALOG_H
@@ -1,11 +1,381 @@
 #include "mainwindow.h"
+#include "chip8display.h"
+#include "chip8recorder.h"
+#include "chip8terminput.h"
+#include "chip8termview.h"
+#include "chip8keytape.h"
+#include "chip8audio.h"
+#include "chip8wavsink.h"
+#include "chip8profiler.h"
+#include "chip8metrics.h"
+#include "chip8metricsexporter.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <cstring>
+#include <chrono>
+#include <memory>
+
+/**
+	Installs the command line options that are common to all frontends and
+	parses the command line.
+*/
+static void parse_options(QCommandLineParser& parser, QCoreApplication const& app)
+{
+	parser.setApplicationDescription("CHIP8 emulator");
+	parser.addHelpOption();
+	parser.addOption(QCommandLineOption("term", "Run in the terminal instead of a window."));
+	parser.addOption(QCommandLineOption("braille", "Draw with braille cells (2x4 pixel) instead of half blocks (1x2 pixel)."));
+	parser.addOption(QCommandLineOption("keys", "Replay the key timeline <file> instead of reading the keyboard (terminal and --frames only).", "file"));
+	parser.addOption(QCommandLineOption("frames", "Run headless for <n> frames without speed limit and exit (deterministic replay with --keys).", "n"));
+	parser.addOption(QCommandLineOption("per-frame", "Instructions per frame with --frames (default: 16).", "n", "16"));
+	parser.addOption(QCommandLineOption("seed", "Seed of the random generator of Cxnn (default: fixed).", "n"));
+	parser.addOption(QCommandLineOption("save-state", "Write the machine state to <file> when --frames is done.", "file"));
+	parser.addOption(QCommandLineOption("record", "Record all frames to <file> (\"-\" for stdout).", "file"));
+	parser.addOption(QCommandLineOption("record-format", "Recording format: y4m, gif or rle (default: from file extension).", "format"));
+	parser.addOption(QCommandLineOption("record-scale", "Size of a CHIP8 pixel in y4m and gif recordings (default: 4).", "n", "4"));
+	parser.addOption(QCommandLineOption("wav", "Write the sound into the WAV file <file> instead of playing it.", "file"));
+	parser.addOption(QCommandLineOption("trace", "Write a binary instruction trace to <file>.0, <file>.1, ... (decode with chip8-trace).", "file"));
+	parser.addOption(QCommandLineOption("trace-keep", "Keep only the last <n> trace segments of 64 MB (default: 0, all).", "n", "0"));
+	parser.addOption(QCommandLineOption("log-overflow", "If a log queue is full: drop the message (default) or block the emulation.", "drop|block", "drop"));
+	parser.addOption(QCommandLineOption("profile", "Time the host threads and write them as Chrome trace JSON to <file> at exit (open in Perfetto).", "file"));
+	parser.addOption(QCommandLineOption("metrics-file", "Rewrite the Prometheus metrics into <file> periodically.", "file"));
+	parser.addOption(QCommandLineOption("metrics-interval", "Period of --metrics-file in ms (default: 1000).", "ms", "1000"));
+	parser.addOption(QCommandLineOption("metrics-port", "Serve the Prometheus metrics on http://127.0.0.1:<port>/metrics.", "port"));
+	parser.addOption(QCommandLineOption("rom", "Load the CHIP8 program <file> (same as the positional argument).", "file"));
+	parser.addOption(QCommandLineOption("mode", "Emulation mode: classic or super (default: classic).", "mode", "classic"));
+	parser.addOption(QCommandLineOption("address", "Load and start address, decimal or 0x-hex (default: 0x200).", "address", "0x200"));
+	parser.addOption(QCommandLineOption("run", "Start the program as soon as it is loaded (window only, the terminal always runs)."));
+	parser.addOption(QCommandLineOption("run-ahead", "Show the display <n> frames ahead to hide the input lag of the program (default: 0, off).", "n", "0"));
+	parser.addOption(QCommandLineOption("no-resume", "Start the program from scratch instead of restoring the last session (window only)."));
+	parser.addPositionalArgument("rom", "The CHIP8 program to run.", "[rom]");
+	parser.process(app);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Reads the program, mode and address options.
+	\return false if an option is invalid.
+*/
+static bool program_options(QCommandLineParser const& parser, QString& rom, CHIP8::EMULATION_MODE& mode, u_int16_t& address)
+{
+	bool ok = false;
+
+	rom = parser.value("rom");
+	if(rom.isEmpty() && !parser.positionalArguments().isEmpty()){
+		rom = parser.positionalArguments().first();
+	}
+	if(parser.value("mode") == "classic"){
+		mode = CHIP8::MODE_CLASSIC;
+	} else if(parser.value("mode") == "super"){
+		mode = CHIP8::MODE_SUPER;
+	} else {
+		std::cerr << "-E- Unknown mode <" << parser.value("mode").toStdString() << ">" << std::endl;
+		return false;
+	}
+	unsigned int value = parser.value("address").toUInt(&ok, 0);
+	if(!ok || (value >= CHIP8::MAP_RAM_END)){
+		std::cerr << "-E- Invalid address <" << parser.value("address").toStdString() << ">" << std::endl;
+		return false;
+	}
+	address = static_cast<u_int16_t>(value);
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Creates the recorder requested on the command line and hands it to the display.
+	A lossless recorder makes the emulator wait for the disk (headless runs).
+	\return false if the recording couldn't be set up.
+*/
+static bool setup_recorder(QCommandLineParser const& parser, Chip8Display* dsp, bool lossless = false)
+{
+	if(!parser.isSet("record")){
+		return true;
+	}
+	std::string				filename	= parser.value("record").toStdString();
+	Chip8Recorder::FORMAT	format		= Chip8Recorder::format_from_filename(filename);
+	if(parser.isSet("record-format") && !Chip8Recorder::parse_format(parser.value("record-format").toStdString(), format)){
+		std::cerr << "-E- Unknown recording format <" << parser.value("record-format").toStdString() << ">" << std::endl;
+		return false;
+	}
+	Chip8Recorder* recorder = new Chip8Recorder(filename, format, parser.value("record-scale").toUInt());
+	recorder->set_lossless(lossless);
+	dsp->record(recorder);
+	return recorder->ok();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Opens the binary instruction trace requested on the command line.
+	\return false if the trace couldn't be created.
+*/
+static bool setup_trace(QCommandLineParser const& parser, CHIP8* emu)
+{
+	if(!parser.isSet("trace")){
+		return true;
+	}
+	return emu->binary_trace().open(parser.value("trace").toStdString(), Chip8Trace::DEFAULT_SEGMENT, parser.value("trace-keep").toUInt());
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Seeds the random generator of Cxnn (--seed, default: fixed seed).
+	\return false if the seed is not a number.
+*/
+static bool setup_seed(QCommandLineParser const& parser, CHIP8* emu)
+{
+	bool			ok		= true;
+	unsigned int	seed	= parser.isSet("seed") ? parser.value("seed").toUInt(&ok, 0) : 0;
+	if(!ok){
+		std::cerr << "-E- Invalid seed <" << parser.value("seed").toStdString() << ">" << std::endl;
+		return false;
+	}
+	emu->seed(seed);
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Selects the overflow policy of the log file (--log-overflow).
+	\return false if the policy is unknown.
+*/
+static bool setup_log(QCommandLineParser const& parser, CHIP8* emu)
+{
+	if(parser.value("log-overflow") == "drop"){
+		emu->logger().set_overflow(Chip8Logger::OVERFLOW_DROP);
+	} else if(parser.value("log-overflow") == "block"){
+		emu->logger().set_overflow(Chip8Logger::OVERFLOW_BLOCK);
+	} else {
+		std::cerr << "-E- Unknown log overflow policy <" << parser.value("log-overflow").toStdString() << ">" << std::endl;
+		return false;
+	}
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Starts the metrics export requested on the command line. The metrics
+	must be registered already.
+	\return false if the file or the port couldn't be opened.
+*/
+static bool setup_metrics(QCommandLineParser const& parser, Chip8MetricsExporter& exporter)
+{
+	if(parser.isSet("metrics-file") && !exporter.write_file(parser.value("metrics-file").toStdString(), parser.value("metrics-interval").toUInt())){
+		std::cerr << "-E- Metrics: " << exporter.error() << std::endl;
+		return false;
+	}
+	if(parser.isSet("metrics-port")){
+		bool			ok		= false;
+		unsigned int	port	= parser.value("metrics-port").toUInt(&ok);
+		if(!ok || (port > 65535)){
+			std::cerr << "-E- Invalid port <" << parser.value("metrics-port").toStdString() << ">" << std::endl;
+			return false;
+		}
+		if(!exporter.listen(static_cast<uint16_t>(port))){
+			std::cerr << "-E- Metrics: " << exporter.error() << std::endl;
+			return false;
+		}
+		std::cerr << "-I- Metrics on http://127.0.0.1:" << exporter.port() << "/metrics" << std::endl;
+	}
+	exporter.start();
+	return true;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Writes the host profile requested on the command line (\ref Chip8Profiler),
+	called when the event loop has ended.
+
+	\param	[in]	result	Exit code of the event loop.
+	\return result, or 1 if the profile couldn't be written.
+*/
+static int finish_profile(QCommandLineParser const& parser, int result)
+{
+	if(parser.isSet("profile")){
+		Chip8Profiler::enable(false);
+		if(!Chip8Profiler::dump(parser.value("profile").toStdString())){
+			std::cerr << "-E- Can't write <" << parser.value("profile").toStdString() << ">" << std::endl;
+			return 1;
+		}
+	}
+	return result;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Runs a CHIP8 program headless for --frames frames with \ref CHIP8::run_frames():
+	no speed limit, the timers count down once per frame and the keys come
+	from the --keys timeline only. The same program, tape and seed give the
+	same final state every time (see --save-state).
+*/
+static int run_headless(QCommandLineParser const& parser, QString const& rom, CHIP8::EMULATION_MODE mode, u_int16_t address)
+{
+	bool			framesOk	= false;
+	bool			perFrameOk	= false;
+	unsigned int	frames		= parser.value("frames").toUInt(&framesOk, 0);
+	unsigned int	perFrame	= parser.value("per-frame").toUInt(&perFrameOk, 0);
+	if(!framesOk || !perFrameOk || (0 == perFrame)){
+		std::cerr << "-E- Invalid frame count <" << parser.value(framesOk ? "per-frame" : "frames").toStdString() << ">" << std::endl;
+		return 1;
+	}
+
+	Chip8KeyTape	tape;																// no keys without a timeline
+	if(parser.isSet("keys") && !tape.Load(parser.value("keys").toStdString())){
+		std::cerr << "-E- Key timeline: " << tape.Error() << std::endl;
+		return 1;
+	}
+	Chip8Keyboard	keyboard(&tape);
+	Chip8Audio		audio;
+	std::unique_ptr<Chip8WavSink>	wav;
+	CHIP8			emu(&keyboard);
+	emu.mode(mode);
+	if(!setup_seed(parser, &emu)){
+		return 1;
+	}
+	emu.display()->frames_only(true);													// no view, only the recorder gets the frames
+	if(emu.load_file(rom.toStdString(), address)){
+		return 1;
+	}
+	if(!setup_recorder(parser, emu.display(), true) || !setup_trace(parser, &emu) || !setup_log(parser, &emu)){
+		return 1;
+	}
+	if(parser.isSet("wav")){
+		wav.reset(new Chip8WavSink(&audio, parser.value("wav").toStdString()));
+		if(!wav->ok()){
+			std::cerr << "-E- Can't write <" << parser.value("wav").toStdString() << ">" << std::endl;
+			return 1;
+		}
+		audio.set_lossless(true);													// faster than real time: wait for the file
+		emu.set_audio(&audio);
+	}
+
+	emu.run_frames(address, frames, perFrame);
+	if(parser.isSet("save-state") && !emu.save_snapshot(parser.value("save-state").toStdString(), false)){
+		std::cerr << "-E- Can't write <" << parser.value("save-state").toStdString() << ">" << std::endl;
+		return 1;
+	}
+	return finish_profile(parser, 0);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Runs a CHIP8 program in the terminal. Only QtCore is used, so this works on
+	hosts without an X server (e.g. over SSH).
+*/
+static int run_terminal(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+	QCommandLineParser parser;
+	parse_options(parser, a);
+	Chip8Profiler::enable(parser.isSet("profile"));
+	Chip8Profiler::thread_name("main");													// view, input and the 60Hz timers
+
+	QString					rom;
+	CHIP8::EMULATION_MODE	mode;
+	u_int16_t				address;
+	if(!program_options(parser, rom, mode, address)){
+		return 1;
+	}
+	if(rom.isEmpty()){
+		std::cerr << "-E- No CHIP8 program given" << std::endl;
+		return 1;
+	}
+
+	if(parser.isSet("frames")){
+		return run_headless(parser, rom, mode, address);
+	}
+	if(parser.isSet("record") && (parser.value("record") == "-")){					// the frames would end up between the display lines
+		std::cerr << "-E- --record - needs stdout, which the terminal display uses: record to a file" << std::endl;
+		return 1;
+	}
+
+	Chip8TermInput	input;																// raw key presses from stdin
+	Chip8KeyTape	tape;																// ... or scripted ones
+	if(parser.isSet("keys") && !tape.Load(parser.value("keys").toStdString())){
+		std::cerr << "-E- Key timeline: " << tape.Error() << std::endl;
+		return 1;
+	}
+	Chip8Keyboard	keyboard(parser.isSet("keys") ? static_cast<Chip8KeySource*>(&tape) : &input);
+	Chip8Audio		audio;																// outlives the emulator thread
+	std::unique_ptr<Chip8WavSink>	wav;
+	CHIP8			emu(&keyboard);
+	emu.mode(mode);
+	if(!setup_seed(parser, &emu)){
+		return 1;
+	}
+	if(emu.load_file(rom.toStdString(), address)){
+		return 1;
+	}
+	if(!setup_recorder(parser, emu.display()) || !setup_trace(parser, &emu) || !setup_log(parser, &emu)){
+		return 1;
+	}
+	if(parser.isSet("wav")){															// no speaker in the terminal, only a file
+		wav.reset(new Chip8WavSink(&audio, parser.value("wav").toStdString()));
+		if(!wav->ok()){
+			std::cerr << "-E- Can't write <" << parser.value("wav").toStdString() << ">" << std::endl;
+			return 1;
+		}
+		emu.set_audio(&audio);
+	}
+	Chip8TermView	view(emu.display(), parser.isSet("braille") ? Chip8TermView::RENDER_BRAILLE : Chip8TermView::RENDER_HALF_BLOCK);
+	Chip8Metrics			metrics;
+	Chip8MetricsExporter	exporter(&metrics);
+	emu.register_metrics(metrics);
+	if(!setup_metrics(parser, exporter)){
+		return 1;
+	}
+
+	QObject::connect(&input,	&Chip8TermInput::Quit,				&a,		&QCoreApplication::quit);
+	QObject::connect(&a,		&QCoreApplication::aboutToQuit,		&input,	&Chip8TermInput::Close);	// don't leave the emulator blocked in a key read
+	emu.RunAhead(parser.value("run-ahead").toInt());
+	emu.Run(address);
+	return finish_profile(parser, a.exec());
+}
+//-----------------------------------------------------------------------------
 
 int main(int argc, char *argv[])
 {
+	std::chrono::steady_clock::time_point launch = std::chrono::steady_clock::now();		// reference for the time to first frame
+
+	for(int i = 1; i < argc; ++i){
+		if((0 == strcmp(argv[i], "--term")) || (0 == strcmp(argv[i], "--frames")) || (0 == strncmp(argv[i], "--frames=", 9))){	// no window
+			return run_terminal(argc, argv);
+		}
+	}
+
 	QApplication a(argc, argv);
+	QCommandLineParser parser;
+	parse_options(parser, a);
+	Chip8Profiler::enable(parser.isSet("profile"));
+
+	QString					rom;
+	CHIP8::EMULATION_MODE	mode;
+	u_int16_t				address;
+	if(!program_options(parser, rom, mode, address)){
+		return 1;
+	}
+
 	Chip8MainWindow w;
+	w.set_launch_time(launch);
+	if(!setup_recorder(parser, w.get_emu()->display()) || !setup_trace(parser, w.get_emu()) || !setup_log(parser, w.get_emu())
+		|| !setup_seed(parser, w.get_emu())){
+		return 1;
+	}
+	w.set_run_ahead(parser.value("run-ahead").toInt());
+	if(parser.isSet("wav") && !w.record_audio(parser.value("wav"))){
+		std::cerr << "-E- Can't write <" << parser.value("wav").toStdString() << ">" << std::endl;
+		return 1;
+	}
+	Chip8Metrics			metrics;
+	Chip8MetricsExporter	exporter(&metrics);
+	w.register_metrics(metrics);
+	if(!setup_metrics(parser, exporter)){
+		return 1;
+	}
 	w.show();
-	return a.exec();
+	if(!rom.isEmpty()){
+		w.autoload(rom, mode, address, parser.isSet("run"), !parser.isSet("no-resume"));
+	}
+	return finish_profile(parser, a.exec());
 }
@@ -1,18 +1,35 @@
 #include <QFileDialog>
+#include <QStandardPaths>
+#include <QDir>
+#include <QHeaderView>
+#include <QMenu>
+#include <QAction>
+#include <QActionGroup>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
 
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
 #include "configdialog.h"
 #include "keyboarddialog.h"
 #include "chip8display.h"
+#include "chip8audio.h"
+#include "chip8wavsink.h"
+#include "chip8profiler.h"
+#include "chip8metrics.h"
+#ifdef CHIP8_HAVE_QTAUDIO
+#include "chip8audiooutput.h"
+#endif
 
 /**
 	Constructor for the CHIP8 emulator main window
 	\param	[in]	parent	???
 */
 Chip8MainWindow::Chip8MainWindow(QWidget *parent)
-: QMainWindow(parent), ui(new Ui::Chip8MainWindow), rtTrace(true), address(0x200)
+: QMainWindow(parent), ui(new Ui::Chip8MainWindow), rtTrace(true), kbdDialog(nullptr), configDialog(nullptr), libraryDialog(nullptr), gridWindow(nullptr), shownRow(-1), runWhenLoaded(false), address(0x200), shownSerial(0), launchTime(std::chrono::steady_clock::now()), firstFrameMs(0), audio(nullptr), speaker(nullptr), wavSink(nullptr)
 {
+	Chip8Profiler::thread_name("ui");
 	ui->setupUi(this);
 
 	qRegisterMetaType<u_int16_t>("u_int16_t");
@@ -28,23 +45,87 @@ Chip8MainWindow::Chip8MainWindow(QWidget *parent)
 	emu->moveToThread(&emuThread);														// move emulator into thread
 
 	connect(&emuThread,	&QThread::finished, emu, &QObject::deleteLater);				// connect the destroy signal
+	connect(&emuThread,	&QThread::started,	emu, [](){Chip8Profiler::thread_name("timer");});	// the 60Hz timers tick in this thread
 	connect(this,		&Chip8MainWindow::Run,	emu, &CHIP8::Run);						// connect a signal to emulator to actually start emulating
-	connect(emu,		&CHIP8::UpdateI,		this, &Chip8MainWindow::UpdateI);
-	connect(emu,		&CHIP8::UpdateM,		this, &Chip8MainWindow::UpdateM);
-	connect(emu,		&CHIP8::UpdatePC,		this, &Chip8MainWindow::UpdatePC);
-	connect(emu,		&CHIP8::UpdateTd,		this, &Chip8MainWindow::UpdateTd);
-	connect(emu,		&CHIP8::UpdateTs,		this, &Chip8MainWindow::UpdateTs);
-	connect(emu,		&CHIP8::UpdateSP,		this, &Chip8MainWindow::UpdateSP);
-	connect(emu,		&CHIP8::UpdateV,		this, &Chip8MainWindow::UpdateV);
-	connect(emu,		&CHIP8::UpdateStack,	this, &Chip8MainWindow::UpdateStack);
-
-	configDialog	= new ConfigDialog(this);											// Create our configuration dialog. This MUST be done after creating the emulator object.
-	kbdDialog		= new KeyboardDialog(keyboard, this);								// This dialog MUST be created after the emulator object because it connects some signals to it
-	list_model		= new QStringListModel(this);										// create a list_model for our list-view that displays the source code
-
-	cgv = new Chip8GraphicsView(emu->width(), emu->height(), ui->graphicsView, this);	// install our api to draw on QtGraphicsView
-	cgv->Resize(emu->width(), emu->height());
-	cgv->Clear();
+	connect(this,		&Chip8MainWindow::Clock,	emu, &CHIP8::Clock);					// let the user change the emulation speed
+	connect(this,		&Chip8MainWindow::Stop,		emu, &CHIP8::Stop);						// interrupt the current program
+	connect(this,		&Chip8MainWindow::Step,		emu, &CHIP8::Step);						// single-step the current program
+	connect(this,		&Chip8MainWindow::Continue,	emu, &CHIP8::Continue);					// continue the current program
+	connect(this,		&Chip8MainWindow::Reset,	emu, &CHIP8::Reset);					// terminate the current program
+	connect(this,		&Chip8MainWindow::RunAhead,	emu, &CHIP8::RunAhead);					// show the display some frames ahead
+	connect(emu,		&CHIP8::Stepped,		this, &Chip8MainWindow::Stepped);				// show the state whenever the emulator halts ...
+	list_model		= new Chip8ListModel(emu, this);									// create a list_model for our list-view that displays the source code
+	ui->codeListView->setModel(list_model);
+	ui->codeListView->setUniformItemSizes(true);										// lets the view ask only for the visible rows
+	ui->codeListView->setSelectionRectVisible(true);
+	ui->codeListView->setSelectionMode(QAbstractItemView::SingleSelection);
+	memory_model	= new Chip8MemoryModel(emu, this);									// hex view of the emulator memory
+	ui->memoryTableView->setModel(memory_model);
+	ui->memoryTableView->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+	cgv = new Chip8GraphicsView(emu->width(), emu->height(), ui->graphicsView, emu->display(), this);	// install our api to draw on QtGraphicsView
+	connect(cgv,		&Chip8GraphicsView::FirstFrame,	this,	&Chip8MainWindow::FirstFrame);		// startup latency
+
+	connect(&stateTimer,	&QTimer::timeout,	this,		&Chip8MainWindow::PollState);		// poll the emulator state while running ...
+	connect(&stateTimer,	&QTimer::timeout,	list_model,	&Chip8ListModel::CheckWrites);		// ... and the memory writes into the listing ...
+	connect(&stateTimer,	&QTimer::timeout,	memory_model,	&Chip8MemoryModel::Refresh);	// ... and the memory view
+	stateTimer.start(33);																	// 30Hz is plenty for the register display
+
+	QMenu*		fileMenu	= ui->menubar->addMenu(tr("&File"));
+	fileMenu->addAction(tr("&Library..."), this, &Chip8MainWindow::ShowLibrary);			// browse a folder of programs with thumbnails
+	fileMenu->addAction(tr("&Grid..."), this, &Chip8MainWindow::ShowGrid);					// many emulators side by side
+
+	QMenu*		viewMenu	= ui->menubar->addMenu(tr("&View"));							// instrumentation of the display
+	QAction*	heatmapAct	= new QAction(tr("Draw &heatmap"), this);
+	heatmapAct->setCheckable(true);
+	viewMenu->addAction(heatmapAct);
+	viewMenu->addAction(tr("&Reset heatmap"), cgv, &Chip8GraphicsView::ResetHeatmap);
+	perfHud					= new Chip8PerfHud(emu, cgv, ui->graphicsView, this);			// IPS, frame time and backlog overlay
+	QAction*	perfHudAct	= new QAction(tr("&Performance HUD"), this);
+	perfHudAct->setCheckable(true);
+	viewMenu->addAction(perfHudAct);
+	connect(perfHudAct,	&QAction::toggled,				perfHud,	&Chip8PerfHud::Show);
+	QAction*	profileAct	= new QAction(tr("Host &profiling"), this);				// scoped timers of all threads
+	profileAct->setCheckable(true);
+	profileAct->setChecked(Chip8Profiler::on());										// --profile
+	viewMenu->addAction(profileAct);
+	viewMenu->addAction(tr("&Save host profile..."), this, &Chip8MainWindow::SaveProfile);
+	connect(profileAct,	&QAction::toggled,				this,	[](bool on){Chip8Profiler::enable(on);});
+	connect(heatmapAct,	&QAction::toggled,				cgv,	&Chip8GraphicsView::ShowHeatmap);
+	connect(heatmapAct,	&QAction::toggled,				ui->statusbar,	&QStatusBar::clearMessage);
+	connect(cgv,		&Chip8GraphicsView::FrameStats,	this,	[this](unsigned int draws, unsigned int pixels){
+		ui->statusbar->showMessage(tr("%1 sprite draws / %2 pixels per frame").arg(draws).arg(pixels));
+	});
+
+	historyList		= new QListWidget(this);											// history of executed instructions, filled when the program halts
+	historyDock		= new QDockWidget(tr("History"), this);
+	historyDock->setObjectName("historyDock");
+	historyDock->setWidget(historyList);
+	addDockWidget(Qt::RightDockWidgetArea, historyDock);
+	viewMenu->addAction(historyDock->toggleViewAction());
+	connect(historyDock,	&QDockWidget::visibilityChanged,	this,	[this](bool visible){	// opened after the program halted
+		Chip8State s;
+		if(visible && (!emu->state(s) || s.halted)){
+			show_history();
+		}
+	});
+
+	QMenu*			aheadMenu	= viewMenu->addMenu(tr("Run-&ahead"));					// hide the input lag of the program
+	QActionGroup*	aheadGroup	= new QActionGroup(this);
+	for(int frames = 0; frames <= RUN_AHEAD_MAX; ++frames){
+		aheadActs[frames] = new QAction(frames ? tr("%1 frame(s)").arg(frames) : tr("Off"), this);
+		aheadActs[frames]->setCheckable(true);
+		aheadActs[frames]->setActionGroup(aheadGroup);
+		aheadMenu->addAction(aheadActs[frames]);
+		connect(aheadActs[frames], &QAction::triggered, this, [this, frames]{emit RunAhead(frames);});
+	}
+	aheadActs[0]->setChecked(true);
+
+	audio = new Chip8Audio();															// sound timer -> PCM ring ...
+#ifdef CHIP8_HAVE_QTAUDIO
+	speaker = new Chip8AudioOutput(audio, this);										// ... -> speaker
+	emu->set_audio(audio);
+#endif
 
 	emuThread.start();																	// start the tread
 }
@@ -55,8 +136,24 @@ Chip8MainWindow::Chip8MainWindow(QWidget *parent)
 */
 Chip8MainWindow::~Chip8MainWindow()
 {
+	stateTimer.stop();
+	if(loader.valid()){
+		loader.wait();
+	}
+	bool running = false;															// keep the session for the next start
+	kbdDevice->Close();																// Fx0A may wait for a key, terminate() joins the thread
+	QMetaObject::invokeMethod(emu, [this, &running]{running = emu->terminate();}, Qt::BlockingQueuedConnection);
+	if(emu->program_length()){
+		QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+		emu->save_snapshot(session_file().toStdString(), running);
+	}
+	delete wavSink;																	// the emulator renders no more sound
+	delete speaker;
+	delete audio;
+	delete perfHud;
 	delete cgv;
 	delete list_model;
+	delete memory_model;
 	delete kbdDialog;
 	delete configDialog;
 	emuThread.quit();
@@ -90,20 +187,238 @@ void Chip8MainWindow::on_loadButton_clicked()
 {
 	QString filename =  QFileDialog::getOpenFileName(this, tr("Open Chip8 Program"),QDir::homePath(), tr("Chip8 Programs (*.ch8)"));	// open file-dialog in users home dir
 	if(! filename.isEmpty()){										// only do something if the user selected a file
-		emu->load_file(filename.toStdString(), address);			// load CHIP8 program into emulator at default address
-		std::vector<std::string> prog = emu->disassemble();			// try to disassemble the program ...
-		code_list.clear();											// ... and put the assembler text in out code-view
-		for(auto entry : prog){
-			code_list.append(entry.c_str());
+		load_program(filename);
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Name of the snapshot that keeps the session from one start to the next.
+*/
+QString Chip8MainWindow::session_file(void)
+{
+	return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/session.c8s";
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Loads a program given on the command line and optionally starts it as soon
+	as it is loaded.
+
+	If the last session ran the same program, its snapshot is restored instead
+	(see \ref CHIP8::restore_snapshot()): the display shows the saved frame
+	before the first paint and the program continues where it was left if it
+	was running then. Only the disassembly is still done in the background.
+
+	\param	[in]	filename	The program file.
+	\param	[in]	mode		Emulation mode.
+	\param	[in]	start		Load and start address.
+	\param	[in]	run			Start the program after loading.
+	\param	[in]	resume		Restore the last session of this program.
+*/
+void Chip8MainWindow::autoload(QString const& filename, CHIP8::EMULATION_MODE mode, u_int16_t start, bool run, bool resume)
+{
+	bool		running	= false;
+	std::string	program;
+
+	if(resume){
+		std::ifstream file(filename.toStdString(), std::ios::in|std::ios::binary);
+		program.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	if(!program.empty() && emu->restore_snapshot(session_file().toStdString(), CHIP8::program_hash(program), running)){
+		Chip8State s;
+		emu->state(s);
+		cgv->Present();												// show the saved frame right away
+		address = emu->program_address();
+		load_program(filename, std::string(reinterpret_cast<char const*>(emu->memory()) + address, emu->program_length()));
+		if(running || run){
+			emit Run(s.PC);
+		} else {
+			show_state(s);
+		}
+		ui->statusbar->showMessage(tr("Resumed session at $%1").arg(s.PC, 0, 16), 5000);
+		return;
+	}
+	if(mode != emu->mode()){
+		emu->mode(mode);
+		cgv->Resize(emu->width(), emu->height());
+	}
+	address			= start;
+	runWhenLoaded	= run;
+	load_program(filename);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Sets the number of frames the display runs ahead of the emulation (see
+	\ref CHIP8::RunAhead()), e.g. from the command line.
+
+	\param	[in]	frames	Run-ahead frames, 0 switches it off.
+*/
+void Chip8MainWindow::set_run_ahead(int frames)
+{
+	frames = std::max(0, std::min(frames, static_cast<int>(RUN_AHEAD_MAX)));
+	aheadActs[frames]->setChecked(true);
+	emit RunAhead(frames);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Writes the sound into a WAV file instead of playing it (the ring of
+	\ref Chip8Audio has only one reader). Must be called before a program
+	is started, e.g. from the command line.
+
+	\param	[in]	filename	Name of the WAV file.
+	\return false if the file couldn't be created.
+*/
+bool Chip8MainWindow::record_audio(QString const& filename)
+{
+	delete speaker;
+	speaker = nullptr;
+	delete wavSink;
+	wavSink = new Chip8WavSink(audio, filename.toStdString());
+	emu->set_audio(audio);
+	return wavSink->ok();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Registers the counters of the emulator and of the display view and the
+	time to first frame in a metrics registry (see \ref Chip8MetricsExporter).
+
+	\param	[in]	metrics	The registry, must not outlive the window.
+*/
+void Chip8MainWindow::register_metrics(Chip8Metrics& metrics)
+{
+	emu->register_metrics(metrics);
+	cgv->register_metrics(metrics);
+	metrics.gauge("chip8_first_frame_seconds", "Time from the process start to the first displayed frame (0: not yet).",
+		[this](){return first_frame_ms() / 1000.0;});
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Sets the time the process started, the reference of the time to first
+	frame (default: construction of the main window).
+*/
+void Chip8MainWindow::set_launch_time(std::chrono::steady_clock::time_point t)
+{
+	launchTime = t;
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Private slot, called when the display shows something for the first time.
+	Reports the time from the process start to the first frame on stderr and
+	in the status bar.
+*/
+void Chip8MainWindow::FirstFrame(void)
+{
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - launchTime).count();
+	firstFrameMs.store(ms, std::memory_order_relaxed);
+	std::cerr << "-I- Time to first frame: " << ms << " ms" << std::endl;
+	ui->statusbar->showMessage(tr("Time to first frame: %1 ms").arg(ms, 0, 'f', 1), 5000);
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Private slot of File > Library. Opens the program library and loads the
+	program the user picked.
+*/
+void Chip8MainWindow::ShowLibrary(void)
+{
+	if(nullptr == libraryDialog){									// the thread pool is only set up when needed
+		libraryDialog = new LibraryDialog(emu, this);
+	}
+	if((QDialog::Accepted == libraryDialog->exec()) && ui->loadButton->isEnabled()){
+		load_program(libraryDialog->selected());
+	}
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Private slot of File > Grid. Shows the grid window, its instances keep
+	running while it is hidden.
+*/
+void Chip8MainWindow::ShowGrid(void)
+{
+	if(nullptr == gridWindow){
+		gridWindow = new Chip8GridWindow(this);
+	}
+	gridWindow->show();
+	gridWindow->raise();
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Loads and disassembles a program in the background, \ref RomLoaded() is
+	called when it is done.
+
+	\param	[in]	filename	The program file.
+*/
+void Chip8MainWindow::load_program(QString const& filename, std::string const& image)
+{
+	ui->loadButton->setEnabled(false);							// one program at a time
+	std::string	file		= filename.toStdString();
+	std::string	cacheDir	= QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString();
+	u_int16_t	start		= address;
+	QDir().mkpath(QString::fromStdString(cacheDir));
+	loader = std::async(std::launch::async, [this, file, image, cacheDir, start]{	// read and analyse the program in the background ...
+		std::vector<Chip8Disassembler::Line> lines;
+		std::string	program;
+		if(image.empty()){												// the emulator may run: only RomLoaded() writes its memory
+			std::ifstream in(file, std::ios::in|std::ios::binary);
+			program.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		}
+		if(!image.empty() || !program.empty()){						// a restored session is already in memory (and may run): use the copy
+			std::string const&	code = image.empty() ? program : image;
+			Chip8Disassembler dis(reinterpret_cast<unsigned char const*>(code.data()), static_cast<u_int16_t>(std::min(code.size(), static_cast<size_t>(VM_SIZE - start))), start);
+			if(!dis.load(cacheDir)){										// unknown program: follow the control flow once
+				dis.analyse(start);
+				dis.save(cacheDir);
+			}
+			lines = dis.listing();
+		}
+		loadedProgram = std::move(program);											// read by RomLoaded() after loader.get()
+		QMetaObject::invokeMethod(this, "RomLoaded", Qt::QueuedConnection, Q_ARG(bool, !lines.empty()));	// ... and continue in the UI thread
+		return lines;
+	});
+}
+//-----------------------------------------------------------------------------
+
+/**
+	Private slot, called in the UI thread when the program loaded by
+	\ref on_loadButton_clicked() is read and disassembled. The emulator thread
+	stops the running program and writes the new one into its memory.
+	The code view formats the rows on demand, so this is fast for any program size.
+
+	\param	[in]	ok	The program could be loaded.
+*/
+void Chip8MainWindow::RomLoaded(bool ok)
+{
+	std::vector<Chip8Disassembler::Line> lines = loader.get();
+
+	ui->loadButton->setEnabled(true);
+	if(ok){
+		if(!loadedProgram.empty()){
+			std::string	program	= std::move(loadedProgram);
+			u_int16_t	start	= address;
+			QMetaObject::invokeMethod(emu, [this, program, start]{		// in the emulator thread, before a queued Run()
+				emu->terminate();
+				emu->load(program, start);
+			}, Qt::QueuedConnection);
+			loadedProgram.clear();
+		}
+		list_model->set_listing(lines);
+		shownRow = -1;
+		select_row(address);
+		if(runWhenLoaded){
+			emit Run(address);
 		}
-		list_model->setStringList(code_list);
-		ui->codeListView->setModel(list_model);
-		ui->codeListView->setSelectionRectVisible(true);
-		ui->codeListView->setSelectionMode(QAbstractItemView::SingleSelection);
-		QModelIndex index = ui->codeListView->model()->index(code_list.indexOf(QRegExp(QString().sprintf("\\$%X.*", address))),0);
-		ui->codeListView->setCurrentIndex(index);
-		ui->codeListView->selectionModel()->select(index,QItemSelectionModel::Select);
+	} else {
+		ui->statusbar->showMessage(tr("Couldn't load the program"), 5000);
 	}
+	runWhenLoaded = false;
 }
 //-----------------------------------------------------------------------------
 
@@ -121,20 +436,12 @@ void Chip8MainWindow::on_runButton_clicked()
 */
 void Chip8MainWindow::on_toolButton_clicked()
 {
-	if(configDialog){
-		configDialog->setModal(true);				// make sure we continue only when the dialog is closed again
-		configDialog->open();
-		ui->graphicsView->scene()->clear();			// since we may have changed the resolutions clear display
-		unsigned int pixel_width	= static_cast<unsigned int>(ui->graphicsView->width()) / emu->width();
-		unsigned int pixel_height	= static_cast<unsigned int>(ui->graphicsView->height()) / emu->height();
-		for(unsigned int x = 0; x < emu->width(); ++x){
-			for(unsigned int y = 0; y < emu->height(); ++y){
-				QRectF rec(x*pixel_width, y*pixel_height, pixel_width, pixel_height);
-				ui->graphicsView->scene()->addRect(rec, QPen(Qt::white), QBrush(Qt::white));
-
-			}
-		}
+	if(nullptr == configDialog){
+		configDialog = new ConfigDialog(this);		// created on first use, most sessions never configure anything
 	}
+	configDialog->setModal(true);					// make sure we continue only when the dialog is closed again
+	configDialog->open();
+	cgv->Resize(emu->width(), emu->height());		// since we may have changed the resolutions rebuild display
 }
 //-----------------------------------------------------------------------------
 
@@ -227,113 +534,133 @@ void Chip8MainWindow::ButtonRelease(int button)
 //-----------------------------------------------------------------------------
 
 /**
-
+	Public slot, called 30 times a second. The emulator publishes its state at
+	the end of every frame, we only redraw if it has changed.
 */
-void Chip8MainWindow::UpdateTs(u_int8_t const ts)
+void Chip8MainWindow::PollState(void)
 {
-	if(rtTrace){
-		ui->tsRegLabel->setText(QString().sprintf("0x%02X", ts));
+	Chip8State	s;
+
+	CHIP8_PROFILE("PollState");
+	if(rtTrace && emu->state(s) && (s.serial != shownSerial)){
+		show_state(s);
 	}
 }
 //-----------------------------------------------------------------------------
 
 /**
-
+	Public slot that receives the \ref CHIP8::Stepped signal. This is the only
+	signal the emulator sends while executing a program and only when it halts.
 */
-void Chip8MainWindow::UpdateTd(u_int8_t const td)
+void Chip8MainWindow::Stepped(void)
 {
-	if(rtTrace){
-		ui->tsRegLabel->setText(QString().sprintf("0x%02X", td));
-	}
-}
-//-----------------------------------------------------------------------------
-
-/**
+	Chip8State	s;
 
-*/
-void Chip8MainWindow::UpdateV(unsigned char const* regs)
-{
-	if(rtTrace){
-		ui->V0_Label->setText(QString().sprintf("0x%02X", regs[0]));
-		ui->V1_Label->setText(QString().sprintf("0x%02X", regs[1]));
-		ui->V2_Label->setText(QString().sprintf("0x%02X", regs[2]));
-		ui->V3_Label->setText(QString().sprintf("0x%02X", regs[3]));
-		ui->V4_Label->setText(QString().sprintf("0x%02X", regs[4]));
-		ui->V5_Label->setText(QString().sprintf("0x%02X", regs[5]));
-		ui->V6_Label->setText(QString().sprintf("0x%02X", regs[6]));
-		ui->V7_Label->setText(QString().sprintf("0x%02X", regs[7]));
-		ui->V7_Label->setText(QString().sprintf("0x%02X", regs[8]));
-		ui->V8_Label->setText(QString().sprintf("0x%02X", regs[9]));
-		ui->VA_Label->setText(QString().sprintf("0x%02X", regs[10]));
-		ui->VB_Label->setText(QString().sprintf("0x%02X", regs[11]));
-		ui->VC_Label->setText(QString().sprintf("0x%02X", regs[12]));
-		ui->VD_Label->setText(QString().sprintf("0x%02X", regs[13]));
-		ui->VE_Label->setText(QString().sprintf("0x%02X", regs[14]));
-		ui->VF_Label->setText(QString().sprintf("0x%02X", regs[15]));
+	CHIP8_PROFILE("Stepped");
+	if(emu->state(s)){
+		show_state(s);
 	}
+	show_history();
 }
 //-----------------------------------------------------------------------------
 
 /**
-
+	Private slot of the View menu: writes the host timings of the last
+	\ref PROFILE_WINDOW_MS as Chrome trace JSON (\ref Chip8Profiler).
 */
-void Chip8MainWindow::UpdateM(u_int16_t const M)
+void Chip8MainWindow::SaveProfile(void)
 {
-	if(rtTrace){
-		ui->memRegLabel->setText(QString().sprintf("0x%03X", M));
-	}
-}
-//-----------------------------------------------------------------------------
-
-/**
+	QString filename = QFileDialog::getSaveFileName(this, tr("Save host profile"),
+		QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/chip8-profile.json", tr("Trace JSON (*.json)"));
 
-*/
-void Chip8MainWindow::UpdateI(u_int16_t const I)
-{
-	if(rtTrace){
-		ui->InstructionLabel->setText(QString().sprintf("0x%04X", I));
+	if(filename.isEmpty()){
+		return;
+	}
+	if(Chip8Profiler::dump(filename.toStdString(), PROFILE_WINDOW_MS)){
+		ui->statusbar->showMessage(tr("Host profile saved, open it in ui.perfetto.dev"), 5000);
+	} else {
+		ui->statusbar->showMessage(tr("Can't write %1").arg(filename), 5000);
 	}
 }
 //-----------------------------------------------------------------------------
 
 /**
+	Shows a state snapshot of the emulator in the register widgets and selects
+	the current instruction in the code view.
 
+	\param	[in]	s	The state to show.
 */
-void Chip8MainWindow::UpdatePC(u_int16_t const pc)
+void Chip8MainWindow::show_state(Chip8State const& s)
 {
-	if(rtTrace){
-		QModelIndex index = ui->codeListView->model()->index(code_list.indexOf(QRegExp(QString().sprintf("\\$%X.*", pc))),0);	// update code view
-		ui->codeListView->setCurrentIndex(index);
-		ui->codeListView->selectionModel()->select(index,QItemSelectionModel::Select);
+	QLabel*	vLabels[16] = {	ui->V0_Label, ui->V1_Label, ui->V2_Label, ui->V3_Label, ui->V4_Label, ui->V5_Label, ui->V6_Label, ui->V7_Label,
+							ui->V8_Label, ui->V9_Label, ui->VA_Label, ui->VB_Label, ui->VC_Label, ui->VD_Label, ui->VE_Label, ui->VF_Label};
 
-		ui->pcRegLabel->setText(QString().sprintf("0x%03X", pc));																// update PC widget
+	shownSerial = s.serial;
+	for(unsigned int i = 0; i < 16; ++i){
+		vLabels[i]->setText(QString().sprintf("0x%02X", s.V[i]));
 	}
+	ui->tsRegLabel->setText(QString().sprintf("0x%02X", s.TS));
+	ui->tdRegLabel->setText(QString().sprintf("0x%02X", s.TD));
+	ui->memRegLabel->setText(QString().sprintf("0x%03X", s.M));
+	ui->InstructionLabel->setText(QString().sprintf("0x%04X", s.I));
+	ui->spRegLabel->setText(QString().sprintf("0x%03X", s.SP));
+	ui->pcRegLabel->setText(QString().sprintf("0x%03X", s.PC));
+
+	select_row(s.PC);
 }
 //-----------------------------------------------------------------------------
 
 /**
-
+	Fills the history dock with the last executed instructions, oldest first.
+	Only called while the emulator is halted (or when the dock is opened
+	while it is halted), so the ring buffer is stable.
 */
-void Chip8MainWindow::UpdateStack(u_int16_t const*  stack)
+void Chip8MainWindow::show_history(void)
 {
-	if(rtTrace){
-		// TBD
+	std::vector<Chip8History::Entry>	entries;
+
+	if(!historyDock->isVisible()){
+		return;
 	}
+	emu->history().read(entries);
+	historyList->clear();
+	for(Chip8History::Entry const& e : entries){
+		QString line = QString::fromStdString(Chip8Disassembler::format(e.op, e.pc));
+		if(Chip8History::NO_REG != e.reg){
+			line += QString().sprintf("\t; V%X=$%02X", e.reg, e.value);
+		}
+		line += QString().sprintf("\t; VF=$%02X", e.vf);
+		historyList->addItem(line);
+	}
+	historyList->scrollToBottom();
 }
 //-----------------------------------------------------------------------------
 
 /**
+	Selects the line of the code view that contains the instruction at pc. The
+	row is taken from the address table built by the disassembler, so this is
+	a constant time lookup.
 
+	\param	[in]	pc	Address of the instruction.
 */
-void Chip8MainWindow::UpdateSP(u_int16_t const sp)
+void Chip8MainWindow::select_row(u_int16_t pc)
 {
-	if(rtTrace){
-		ui->spRegLabel->setText(QString().sprintf("0x%03X", sp));
+	int row = list_model->row(pc);
+
+	if((row < 0) || (row == shownRow)){
+		return;														// not in the listing or already selected
 	}
+	shownRow = row;
+	QModelIndex index = list_model->index(row, 0);
+	ui->codeListView->setCurrentIndex(index);
+	ui->codeListView->selectionModel()->select(index,QItemSelectionModel::Select);
 }
 //-----------------------------------------------------------------------------
 
 void Chip8MainWindow::on_keyboardButton_clicked()
 {
+	if(nullptr == kbdDialog){
+		kbdDialog = new KeyboardDialog(keyboard, this);	// created on first use
+	}
 	kbdDialog->open();
 }
@@ -4,12 +4,27 @@
 #include <QMainWindow>
 #include <QThread>
 #include <QDialog>
-#include <QStringListModel>
+#include <QTimer>
+#include <QDockWidget>
+#include <QListWidget>
+#include <QAction>
+#include <QIODevice>
+#include <future>
+#include <chrono>
+#include <atomic>
 //#include <QGraphicsScene>
 
 #include "chip8.h"
 #include "kbddevice.h"
 #include "chip8graphicsview.h"
+#include "chip8listmodel.h"
+#include "chip8memorymodel.h"
+#include "chip8perfhud.h"
+#include "librarydialog.h"
+#include "chip8gridwindow.h"
+
+class Chip8Audio;
+class Chip8WavSink;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class Chip8MainWindow; }
@@ -26,6 +41,20 @@ class Chip8MainWindow : public QMainWindow
 		CHIP8* get_emu(void){return emu;}
 		u_int16_t get_address(void){return address;}
 		void update_display(std::vector<std::vector<bool>> dsp);
+		void autoload(QString const& filename, CHIP8::EMULATION_MODE mode, u_int16_t start, bool run, bool resume);	///< Load (and run) a program from the command line.
+		void set_launch_time(std::chrono::steady_clock::time_point t);									///< Reference time for the time to first frame.
+		double first_frame_ms(void) const {return firstFrameMs.load(std::memory_order_relaxed);}										///< Time from launch to the first frame (0: not yet).
+		void set_run_ahead(int frames);																	///< Run-ahead frames (0: off, up to \ref RUN_AHEAD_MAX).
+		bool record_audio(QString const& filename);														///< Write the sound into a WAV file instead of playing it.
+		void register_metrics(Chip8Metrics& metrics);													///< Export the counters of the emulator and the display.
+
+		enum RUN_AHEAD {
+			RUN_AHEAD_MAX	= 3			///< Most run-ahead frames offered in the menu.
+		};
+
+		enum PROFILE {
+			PROFILE_WINDOW_MS	= 10000		///< View > Save host profile writes the last 10 s.
+		};
 
 	signals:
 		void Run(u_int16_t address);
@@ -34,19 +63,14 @@ class Chip8MainWindow : public QMainWindow
 		void Continue(void);
 		void Clock(int freq);
 		void Reset(void);
+		void RunAhead(int frames);
 
 	public slots:
 //		void DrawScreen(std::vector<std::vector<bool>> dsp);
 		void ButtonPress(int button);
 		void ButtonRelease(int button);
-		void UpdateTs(u_int8_t const ts);
-		void UpdateTd(u_int8_t const td);
-		void UpdateV(unsigned char const* regs);
-		void UpdateM(u_int16_t const M);
-		void UpdateI(u_int16_t const I);
-		void UpdatePC(u_int16_t const pc);
-		void UpdateStack(u_int16_t const*  stack);
-		void UpdateSP(u_int16_t const sp);
+		void PollState(void);								///< Show the emulator state if it changed (timer, only with real time trace).
+		void Stepped(void);									///< Show the emulator state after a halt or single step.
 
 	private slots:
 		void on_clockFreqSlider_valueChanged(int value);
@@ -60,19 +84,47 @@ class Chip8MainWindow : public QMainWindow
 		void on_resetButton_clicked();
 
 		void on_keyboardButton_clicked();
+		void RomLoaded(bool ok);
+		void ShowLibrary(void);
+		void ShowGrid(void);
+		void FirstFrame(void);
+		void SaveProfile(void);								///< Write the host profile of the last seconds.
 
 private:
+		void show_state(Chip8State const& s);
+		void select_row(u_int16_t pc);
+		void show_history(void);
+		void load_program(QString const& filename, std::string const& image = std::string());
+		static QString session_file(void);
+
 		Ui::Chip8MainWindow *ui;
 		bool					rtTrace;
 		Chip8Keyboard*			keyboard;
 		KbdDevice*				kbdDevice;
 		QDialog*				kbdDialog;
 		QDialog*				configDialog;
-		QStringListModel*		list_model;
-		QStringList				code_list;
+		LibraryDialog*			libraryDialog;			///< Program library (created on first use).
+		Chip8GridWindow*		gridWindow;				///< Many emulators side by side (created on first use).
+		Chip8ListModel*			list_model;				///< Disassembly for the code view, made on demand from the emulator memory.
+		Chip8MemoryModel*		memory_model;			///< Contents of the memory view.
+		int						shownRow;				///< Row of the code view that is selected.
+		bool					runWhenLoaded;			///< Start the program when \ref RomLoaded() (command line).
+		std::future<std::vector<Chip8Disassembler::Line>>	loader;	///< Loads and disassembles a program without blocking the user interface.
+		std::string				loadedProgram;			///< Program read by \ref loader, written into the emulator by \ref RomLoaded().
 		CHIP8*                  emu;
 		u_int16_t				address;
 //		QGraphicsScene*			gs;
 		Chip8GraphicsView*		cgv;
+		Chip8PerfHud*			perfHud;				///< Performance overlay of the display.
+		QDockWidget*			historyDock;			///< Shows the last executed instructions when the program halts.
+		QListWidget*			historyList;			///< Contents of the history dock.
+		QTimer					stateTimer;				///< Polls the emulator state for the register display.
+		u_int64_t				shownSerial;			///< Serial of the state on display.
+		std::chrono::steady_clock::time_point	launchTime;	///< Start of the process (see \ref FirstFrame()).
+		std::atomic<double>		firstFrameMs;			///< Time to first frame, 0 until shown (read by the metrics exporter).
+		QAction*				aheadActs[RUN_AHEAD_MAX+1];	///< View > Run-ahead entries (index: frames).
+		Chip8Audio*				audio;					///< Sound of the emulator.
+		QIODevice*				speaker;				///< Plays \ref audio (Chip8AudioOutput, only with Qt Multimedia).
+		Chip8WavSink*			wavSink;				///< ... or writes it into a file (\ref record_audio()).
 };
 #endif // MAINWINDOW_H
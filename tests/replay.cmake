@@ -0,0 +1,36 @@
+# Replays tests/replay.ch8 with the timeline tests/replay.keys twice and
+# checks that both runs end in the same machine state. Two more runs make
+# sure the inputs matter: without the timeline (the program counts the
+# presses of key 5 in V1) and with another seed (Cxnn moves the sprite)
+# the state must differ.
+#
+#	cmake -DEMU=<Chip8Emu> -DTESTS=<this directory> -DOUT=<scratch directory> -P replay.cmake
+
+function(replay name)
+  execute_process(
+    COMMAND ${EMU} --frames 300 ${ARGN} --save-state ${OUT}/replay-${name}.c8s ${TESTS}/replay.ch8
+    RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "run ${name} failed: ${result}")
+  endif()
+endfunction()
+
+function(compare a b expected)
+  execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files ${OUT}/replay-${a}.c8s ${OUT}/replay-${b}.c8s
+    RESULT_VARIABLE result)
+  if(expected STREQUAL "same" AND NOT result EQUAL 0)
+    message(FATAL_ERROR "runs ${a} and ${b} end in different states")
+  elseif(expected STREQUAL "different" AND result EQUAL 0)
+    message(FATAL_ERROR "runs ${a} and ${b} end in the same state")
+  endif()
+endfunction()
+
+replay(tape1 --keys ${TESTS}/replay.keys)
+replay(tape2 --keys ${TESTS}/replay.keys)
+replay(nokeys)
+replay(seed --keys ${TESTS}/replay.keys --seed 12345)
+
+compare(tape1 tape2 same)
+compare(tape1 nokeys different)
+compare(tape1 seed different)